@@ -37,6 +37,11 @@ public:
     NBody*    nbody{};
     Surface*  surface{};
 
+
+    // 固定步长的模拟，与帧率无关；渲染时在最近的两个状态之间插值
+    Hiss::Simulation<Surface::SimState> sim{Hiss::SimulationConfig{.rate_hz = 120.0}, {}, &Surface::simulate};
+    double                              render_time = 0.0;    // 上一帧渲染的模拟时间
+
 #pragma region 特殊的接口
 public:
     void prepare() override
@@ -68,12 +73,19 @@ public:
     void resize() override { graphics->resize(); }
 
 
+    Hiss::ISimulation* simulation() override { return &sim; }
+
+
     void update() noexcept override
     {
+        auto   sample = sim.sample();
+        double time   = glm::mix(sample.prev.time, sample.curr.time, (double) sample.alpha);
+
         if (USE_SURFACE)
-            surface->update();
+            surface->update(sample);
         else
-            nbody->update();
+            nbody->update((float) (time - render_time));
+        render_time = time;
 
         graphics->update();
     }
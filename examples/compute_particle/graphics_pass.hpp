@@ -35,8 +35,8 @@ struct Graphics
 
     const std::filesystem::path vert_shader_path  = shader / "compute_particle/particle.vert";
     const std::filesystem::path frag_shader_path  = shader / "compute_particle/particle.frag";
-    const std::filesystem::path tex_particle_path = texture / "compute_particle/particle_rgba.png";
-    const std::filesystem::path tex_gradient_path = texture / "compute_particle/particle_gradient_rgba.png";
+    const std::filesystem::path tex_particle_path = texture / "compute_particle/particle_rgba.ktx";
+    const std::filesystem::path tex_gradient_path = texture / "compute_particle/particle_gradient_rgba.ktx";
 
 
     const std::vector<vk::DescriptorSetLayoutBinding> graphics_descriptor_bindings = {
@@ -154,7 +154,8 @@ public:
 
     void resize()
     {
-        delete depth_image;
+        // 之前的 frame 可能仍然在使用
+        engine.device().deletion_queue().retire(std::unique_ptr<Hiss::Image2D>(depth_image));
         depth_image = engine.create_depth_attach(vk::SampleCountFlagBits::e1);
     }
 #pragma endregion
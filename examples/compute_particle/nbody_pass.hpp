@@ -124,14 +124,15 @@ public:
     }
 
 
-    void update()
+    /**
+     * @param delta_time 这一帧推进的模拟时间，以秒为单位
+     */
+    void update(float delta_time)
     {
         auto& frame   = engine.current_frame();
         auto& payload = payloads[frame.frame_id()];
 
-
-        double delta_time = engine.timer().duration_ms() / 1000.0;    // 以秒为单位
-        update_uniform_buffer(*payload.uniform_buffer, (float) delta_time);
+        update_uniform_buffer(*payload.uniform_buffer, delta_time);
 
 
         // compute 阶段，不用重新录制 command buffer
@@ -77,11 +77,19 @@ struct Surface
     };
 
 
-    const uint32_t KERNEL_NUM                = 10;    // compute shader 中 kernel 的数量
-    uint32_t       kernel_id                 = 0;
-    const float    MAX_SURFACE_DURATION_TIME = 3.f;    // 一个曲面的持续时间
+    static constexpr uint32_t KERNEL_NUM                = 10;     // compute shader 中 kernel 的数量
+    static constexpr float    MAX_SURFACE_DURATION_TIME = 3.f;    // 一个曲面的持续时间
 
-    float surface_duration_time = 0.f;    // 当前曲面持续了多长时间
+
+    /**
+     * 模拟的状态，以固定的步长推进，参考 simulate
+     */
+    struct SimState
+    {
+        double   time                  = 0.0;    // 模拟的时间，单位是秒
+        uint32_t kernel_id             = 0;
+        float    surface_duration_time = 0.f;    // 当前曲面持续了多长时间
+    };
 
 
     Hiss::Buffer* storage_buffer = nullptr;
@@ -115,14 +123,41 @@ public:
     }
 
 
-    void update()
+    /**
+     * 在模拟线程上调用：推进时间，曲面持续 MAX_SURFACE_DURATION_TIME 之后切换到下一个 kernel
+     */
+    static void simulate(SimState& state, double step_seconds)
+    {
+        state.time += step_seconds;
+        state.surface_duration_time += (float) step_seconds;
+        if (state.surface_duration_time > MAX_SURFACE_DURATION_TIME)
+        {
+            state.surface_duration_time = 0.f;
+            state.kernel_id             = (state.kernel_id + 1) % KERNEL_NUM;
+        }
+    }
+
+
+    void update(const Hiss::Simulation<SimState>::Sample& sample)
     {
         auto& frame   = engine.current_frame();
         auto& payload = payloads[frame.frame_id()];
 
+        // 在最近的两个模拟状态之间插值；kernel 切换的那一步不插值
+        auto& prev     = sample.prev;
+        auto& curr     = sample.curr;
+        float duration = curr.surface_duration_time;
+        if (prev.kernel_id == curr.kernel_id)
+            duration = glm::mix(prev.surface_duration_time, curr.surface_duration_time, sample.alpha);
+        PushConstant data = {
+                .time           = (float) glm::mix(prev.time, curr.time, (double) sample.alpha),
+                .kernel_id      = curr.kernel_id,
+                .trans_progress = duration / MAX_SURFACE_DURATION_TIME,
+        };
+
         // 重新录制命令，为了传入 push constant
         payload.command_buffer.reset();
-        record_command(payload);
+        record_command(payload, data);
 
         // 同一个 queue，使用 pipeline barrier 同步，无需 semaphore
         engine.queue().submit_commands({}, {payload.command_buffer}, {}, frame.insert_fence());
@@ -214,7 +249,7 @@ private:
     }
 
     // 录制命令
-    void record_command(Payload& payload)
+    void record_command(Payload& payload, const PushConstant& data)
     {
         uint32_t group_num = (specialization.dim + specialization.group_size - 1) / specialization.group_size;
 
@@ -232,17 +267,6 @@ private:
         command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeline_layout, 0, {payload.descriptor_set},
                                           nullptr);
 
-        PushConstant data = {.time = (float) engine.timer().now_ms() / 1000.f};
-        {
-            if (surface_duration_time > MAX_SURFACE_DURATION_TIME)
-            {
-                surface_duration_time = 0.f;
-                kernel_id             = (kernel_id + 1) % KERNEL_NUM;
-            }
-            data.kernel_id = kernel_id;
-            surface_duration_time += (float) engine.timer().duration_ms() / 1000.f;
-            data.trans_progress = surface_duration_time / MAX_SURFACE_DURATION_TIME;
-        }
         command_buffer.pushConstants(pipeline_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(data), &data);
         command_buffer.dispatch(group_num, group_num, 1);
 
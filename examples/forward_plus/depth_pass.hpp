@@ -142,14 +142,14 @@ struct DepthPass : public Hiss::IPass
                 command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline_layout, 0,
                                                   {payloads[frame.frame_id()].descriptor_set}, {});
 
-                command_buffer.bindVertexBuffers(0, {cube_mesh.vertex_buffer().vkbuffer()}, {0});
-                command_buffer.bindIndexBuffer(cube_mesh.index_buffer().vkbuffer(), 0, vk::IndexType::eUint32);
+                Hiss::GeometryBinding binding;
+                cube_mesh.bind(command_buffer, binding);
 
                 for (auto& mat: obj_matrix)
                 {
                     command_buffer.pushConstants(pipeline_layout, vk::ShaderStageFlagBits::eVertex, 0,
                                                  sizeof(glm::mat4), &mat);
-                    command_buffer.drawIndexed((uint32_t) cube_mesh.index_buffer().index_num, 1, 0, 0, 0);
+                    cube_mesh.draw(command_buffer);
                 }
             }
             command_buffer.endRendering();
@@ -133,26 +133,31 @@ public:
         {
             auto command_buffer = Hiss::Frame::FrameCommandBuffer(frame, "pre final pass");
 
+            // 4 个 barrier 合并为一次 pipeline barrier
+            Hiss::BarrierBatch barriers{engine.device()};
+
             // depth attache layout transfer：等待 light cull pass 完成深度的读取
             payload.depth_attach->memory_barrier(
-                    {vk::PipelineStageFlagBits::eComputeShader},
+                    barriers, {vk::PipelineStageFlagBits::eComputeShader},
                     {vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
                      vk::AccessFlagBits::eDepthStencilAttachmentRead},
-                    vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthStencilAttachmentOptimal, command_buffer());
+                    vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthStencilAttachmentOptimal);
 
-            Hiss::Engine::color_attach_layout_trans_1(command_buffer(), frame.image());
+            Hiss::Engine::color_attach_layout_trans_1(barriers, frame.image());
 
             // 等待 light cull pass 写入 light index list
             payload.light_index_ssbo->memory_barrier(
-                    command_buffer(), {vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderWrite},
+                    barriers, {vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderWrite},
                     {vk::PipelineStageFlagBits::eFragmentShader, vk::AccessFlagBits::eShaderRead});
 
 
             // 等待 light cull pass 写入 light index grid
             payload.light_grid_ssio->memory_barrier(
-                    {vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderWrite},
+                    barriers, {vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderWrite},
                     {vk::PipelineStageFlagBits::eFragmentShader, vk::AccessFlagBits::eShaderRead},
-                    vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral, command_buffer());
+                    vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral);
+
+            barriers.flush(command_buffer());
         }
 
         final_pass.update(resource.cube_matrix, resource.mesh_cube);
@@ -19,8 +19,6 @@ public:
         {
             payload.depth_attach = Hiss::Image2D::create_depth_attach(engine.allocator, engine.device(),
                                                                       engine.depth_format(), engine.extent());
-            payload.frame_ubo =
-                    Hiss::Buffer::create_ubo_device(engine.device(), engine.allocator, sizeof(frame_data), "frame ubo");
         }
 
         init_light();
@@ -33,7 +31,6 @@ public:
         {
             color_pass_resources[i] = {
                     .depth_attach = payloads[i].depth_attach,
-                    .frame_ubo    = payloads[i].frame_ubo,
                     .scene_ubo    = scene_ubo,
                     .light_ssbo   = light_ssbo,
             };
@@ -49,10 +46,10 @@ public:
 
     void update() override
     {
-        auto& frame   = engine.current_frame();
-        auto& payload = payloads[frame.frame_id()];
+        auto& frame = engine.current_frame();
 
-        update_frame_ubo(frame);
+        // 每一帧的数据写入 uniform ring，不需要 transfer 以及 barrier
+        uint32_t frame_offset = update_frame_data();
 
         if (need_update_lights)
         {
@@ -68,7 +65,7 @@ public:
                     vk::ImageLayout::eUndefined, vk::ImageLayout::eColorAttachmentOptimal, command_buffer());
         }
 
-        color_pass->update(*viking.root_node);
+        color_pass->update(*viking.root_node, frame_offset);
 
         {
             // color attach: layout trans
@@ -85,7 +82,6 @@ private:
     struct Payload
     {
         std::shared_ptr<Hiss::Image2D> depth_attach;
-        std::shared_ptr<Hiss::Buffer>  frame_ubo;
     };
 
     std::vector<Payload> payloads{engine.frame_manager().frames_number()};
@@ -98,7 +94,7 @@ private:
     std::shared_ptr<Hiss::Buffer> light_ssbo;
     std::shared_ptr<Hiss::Buffer> scene_ubo;
 
-    Hiss::MeshLoader viking{engine, model / "cube" / "cube.obj"};
+    Hiss::MeshLoader viking{engine, model / "cube" / "cube.obj", Hiss::VertexFormat::Quantized};
 
 
     void init_light()
@@ -136,43 +132,29 @@ private:
 
 
     /**
-     * TODO 这个似乎可以独立出去
+     * 将每一帧的数据写入 uniform ring
+     * @return 绑定时使用的 dynamic offset
      */
-    void update_frame_ubo(Hiss::Frame& frame)
+    uint32_t update_frame_data()
     {
-        auto& payload = payloads[frame.frame_id()];
-
         frame_data = Shader::Frame{
                 .view_matrix = glm::lookAtRH(glm::vec3{5.f, 5.f, 5.f}, glm::vec3{0.f}, glm::vec3{0.f, 1.f, 0.f}),
         };
 
-
-        Hiss::Frame::FrameCommandBuffer command_buffer{frame, "update frame ubo"};
-        payload.frame_ubo->mem_update(&frame_data, sizeof(frame_data));
-
-        // 插入合适的 barrier
-        payload.frame_ubo->memory_barrier(
-                command_buffer(), {vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite},
-                {vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader,
-                 vk::AccessFlagBits::eShaderRead});
+        return engine.uniform_ring().push(frame_data);
     }
 
 
     void update_lights(Hiss::Frame& frame)
     {
-        Hiss::Frame::FrameCommandBuffer command_buffer{frame, "update light"};
-
         for (auto& light: lights)
         {
             light.pos_view = frame_data.view_matrix * light.pos_world;
         }
 
-        light_ssbo->memory_barrier(command_buffer(), {vk::PipelineStageFlagBits::eFragmentShader},
-                                   {vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite});
-        command_buffer().updateBuffer(light_ssbo->vkbuffer(), 0, light_ssbo->size(), lights.data());
-        light_ssbo->memory_barrier(command_buffer(),
-                                   {vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite},
-                                   {vk::PipelineStageFlagBits::eFragmentShader, vk::AccessFlagBits::eShaderRead});
+        // 记录到 frame 的 upload command buffer 中，在 color pass 之前提交
+        frame.update_buffer(*light_ssbo, lights.data(), sizeof(Shader::Light) * lights.size(),
+                            {vk::PipelineStageFlagBits::eFragmentShader, vk::AccessFlagBits::eShaderRead});
     }
 };
 }    // namespace Material
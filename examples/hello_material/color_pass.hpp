@@ -16,7 +16,6 @@ public:
     {
         std::shared_ptr<Hiss::Image2D> depth_attach;
 
-        std::shared_ptr<Hiss::Buffer> frame_ubo;
         std::shared_ptr<Hiss::Buffer> scene_ubo;
 
         std::shared_ptr<Hiss::Buffer> light_ssbo;
@@ -38,12 +37,15 @@ public:
     }
 
 
-    void update(Hiss::ModelNode& model_node)
+    /**
+     * @param frame_offset Shader::Frame 在 uniform ring 中的 dynamic offset
+     */
+    void update(Hiss::ModelNode& model_node, uint32_t frame_offset)
     {
         auto& frame   = engine.current_frame();
         auto& payload = payloads[frame.frame_id()];
 
-        record_command(payload, model_node);
+        record_command(payload, model_node, frame_offset);
         frame.submit_command(payload.command_buffer);
     }
 
@@ -56,6 +58,14 @@ public:
 
 
 private:
+    // 与 shader 中的 push constant 对应
+    struct PushConstant
+    {
+        glm::mat4 model;
+        glm::vec4 aabb_min;
+        glm::vec4 aabb_extent;
+    };
+
     struct Payload
     {
         Resource resource;
@@ -65,7 +75,6 @@ private:
         vk::RenderingInfo           rendering_info;
         vk::CommandBuffer           command_buffer;
 
-        std::shared_ptr<Hiss::DescriptorSet> set_0;
         std::shared_ptr<Hiss::DescriptorSet> set_2;
     };
 
@@ -76,35 +85,28 @@ private:
 
     vk::Pipeline                            pipeline;
     vk::PipelineLayout                      pipeline_layout;
-    std::shared_ptr<Hiss::DescriptorLayout> layout_0;
     std::shared_ptr<Hiss::DescriptorLayout> layout_2;
 
 
+    /**
+     * set 0 是 engine 的 uniform ring，其中是每一帧的数据
+     */
     void create_descriptor()
     {
-        layout_0 = std::make_shared<Hiss::DescriptorLayout>(
+        layout_2 = std::make_shared<Hiss::DescriptorLayout>(
                 engine.device(), std::vector<Hiss::Initial::BindingInfo>{
-                                         {vk::DescriptorType::eUniformBuffer, vk::ShaderStageFlagBits::eVertex},
+                                         {vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eFragment},
                                          {vk::DescriptorType::eUniformBuffer,
                                           vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment}});
 
-        layout_2 = std::make_shared<Hiss::DescriptorLayout>(
-                engine.device(), std::vector<Hiss::Initial::BindingInfo>{
-                                         {vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eFragment}});
-
 
         for (auto& payload: payloads)
         {
-            payload.set_0 = std::make_shared<Hiss::DescriptorSet>(engine, layout_0, "layout set 0");
             payload.set_2 = std::make_shared<Hiss::DescriptorSet>(engine, layout_2, "layout set 2");
 
-            payload.set_0->write({
-                    {.buffer = payload.resource.frame_ubo.get()},
-                    {.buffer = payload.resource.scene_ubo.get()},
-            });
-
             payload.set_2->write({
                     {.buffer = payload.resource.light_ssbo.get()},
+                    {.buffer = payload.resource.scene_ubo.get()},
             });
         }
     }
@@ -113,16 +115,17 @@ private:
     {
         pipeline_layout = Hiss::Initial::pipeline_layout(
                 engine.vkdevice(),
-                {layout_0->layout, Hiss::Matt::get_material_descriptor(engine.device())->layout, layout_2->layout},
-                {vk::PushConstantRange{vk::ShaderStageFlagBits::eVertex, 0, sizeof(glm::mat4)}});
+                {engine.uniform_ring().layout(), Hiss::Matt::get_material_descriptor(engine.device())->layout,
+                 layout_2->layout},
+                {vk::PushConstantRange{vk::ShaderStageFlagBits::eVertex, 0, sizeof(PushConstant)}});
 
         auto vert_shader_stage = engine.shader_loader().load(vert_path, vk::ShaderStageFlagBits::eVertex);
         auto frag_shader_stage = engine.shader_loader().load(frag_path, vk::ShaderStageFlagBits::eFragment);
 
         Hiss::PipelineTemplate pipeline_template = {
                 .shader_stages        = {vert_shader_stage, frag_shader_stage},
-                .vertex_bindings      = Hiss::Vertex3D::binding_description(0),
-                .vertex_attributes    = Hiss::Vertex3D::attribute_description(0),
+                .vertex_bindings      = Hiss::Vertex3DQuantized::binding_description(0),
+                .vertex_attributes    = Hiss::Vertex3DQuantized::attribute_description(0),
                 .color_attach_formats = {engine.color_format()},
                 .depth_attach_format  = payloads.front().resource.depth_attach->format(),
                 .pipeline_layout      = pipeline_layout,
@@ -147,7 +150,7 @@ private:
         }
     }
 
-    void record_command(Payload& payload, Hiss::ModelNode& model_node)
+    void record_command(Payload& payload, Hiss::ModelNode& model_node, uint32_t frame_offset)
     {
         auto& command_buffer = payload.command_buffer;
 
@@ -156,26 +159,32 @@ private:
             command_buffer.beginRendering(payload.rendering_info);
             {
                 command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
-                command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline_layout, 0,
-                                                  payload.set_0->vk_descriptor_set, {});
+                engine.uniform_ring().bind(command_buffer, vk::PipelineBindPoint::eGraphics, pipeline_layout, 0,
+                                           frame_offset);
                 command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline_layout, 2,
                                                   payload.set_2->vk_descriptor_set, {});
 
+                Hiss::GeometryBinding binding;
                 model_node.draw([&](const Hiss::MatMesh& mat_mesh, const glm::mat4& matrix) {
                     // 绑定纹理
                     command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline_layout, 1,
                                                       mat_mesh.mat->descriptor_set->vk_descriptor_set, {});
 
                     // 绑定顶点属性
-                    command_buffer.bindVertexBuffers(0, {mat_mesh.mesh->vertex_buffer->vkbuffer()}, {0});
-                    command_buffer.bindIndexBuffer(mat_mesh.mesh->index_buffer->vkbuffer(), 0, vk::IndexType::eUint32);
+                    mat_mesh.mesh->bind(command_buffer, binding);
 
                     // 传入 push constant
-                    command_buffer.pushConstants(pipeline_layout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(matrix),
-                                                 &matrix);
+                    auto&        quantization = mat_mesh.mesh->quantization;
+                    PushConstant push_constant{
+                            .model       = matrix,
+                            .aabb_min    = glm::vec4(quantization.aabb_min, 0.f),
+                            .aabb_extent = glm::vec4(quantization.aabb_extent, 0.f),
+                    };
+                    command_buffer.pushConstants(pipeline_layout, vk::ShaderStageFlagBits::eVertex, 0,
+                                                 sizeof(push_constant), &push_constant);
 
                     // 绘制
-                    command_buffer.drawIndexed((uint32_t) mat_mesh.mesh->index_buffer->index_num, 1, 0, 0, 0);
+                    mat_mesh.mesh->draw(command_buffer);
                 });
             }
             command_buffer.endRendering();
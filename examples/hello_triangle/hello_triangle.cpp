@@ -73,7 +73,7 @@ void Hello::App::record_command(vk::CommandBuffer command_buffer, const FramePay
         command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, _pipeline);
 
         command_buffer.bindVertexBuffers(0, {_vertex_buffer->vkbuffer()}, {0});
-        command_buffer.bindIndexBuffer(_index_buffer->vkbuffer(), 0, vk::IndexType::eUint32);
+        command_buffer.bindIndexBuffer(_index_buffer->vkbuffer(), 0, _index_buffer->index_type);
         command_buffer.setViewport(0, engine.viewport());
         command_buffer.setScissor(0, engine.scissor());
         command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, _pipeline_layout, 0, {_descriptor_set}, {});
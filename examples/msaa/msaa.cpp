@@ -134,15 +134,15 @@ void MSAA::App::record_command(vk::CommandBuffer command_buffer, const MSAA::Pay
         command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline_layout, 0,
                                           {payload.descriptor_set}, {});
 
-        mesh2.root_node->draw([this, command_buffer](const Hiss::MatMesh& mesh, const glm::mat4& matrix) {
+        Hiss::GeometryBinding binding;
+        mesh2.root_node->draw([this, command_buffer, &binding](const Hiss::MatMesh& mesh, const glm::mat4& matrix) {
             // 绑定纹理
             command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline_layout, 1,
                                               {mesh.mat->descriptor_set->vk_descriptor_set}, {});
 
 
-            command_buffer.bindVertexBuffers(0, {mesh.mesh->vertex_buffer->vkbuffer()}, {0});
-            command_buffer.bindIndexBuffer(mesh.mesh->index_buffer->vkbuffer(), 0, vk::IndexType::eUint32);
-            command_buffer.drawIndexed((uint32_t) mesh.mesh->index_buffer->index_num, 1, 0, 0, 0);
+            mesh.mesh->bind(command_buffer, binding);
+            mesh.mesh->draw(command_buffer);
         });
 
         // 绘制立方体
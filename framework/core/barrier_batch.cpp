@@ -0,0 +1,214 @@
+#include "core/barrier_batch.hpp"
+#include "core/device.hpp"
+
+
+namespace
+{
+
+// 旧的 stage/access 的 bit 在 synchronization2 中的值不变，只是扩展为 64 位
+vk::PipelineStageFlags2KHR to_stage2(vk::PipelineStageFlags stage)
+{
+    return vk::PipelineStageFlags2KHR((VkPipelineStageFlags2KHR) (VkPipelineStageFlags) stage);
+}
+
+vk::AccessFlags2KHR to_access2(vk::AccessFlags access)
+{
+    return vk::AccessFlags2KHR((VkAccessFlags2KHR) (VkAccessFlags) access);
+}
+
+// 只会出现从 StageAccess 转换来的 bit，因此截断是安全的
+vk::PipelineStageFlags to_stage(vk::PipelineStageFlags2KHR stage)
+{
+    return vk::PipelineStageFlags((VkPipelineStageFlags) (VkPipelineStageFlags2KHR) stage);
+}
+
+vk::AccessFlags to_access(vk::AccessFlags2KHR access)
+{
+    return vk::AccessFlags((VkAccessFlags) (VkAccessFlags2KHR) access);
+}
+
+}    // namespace
+
+
+Hiss::BarrierBatch::BarrierBatch(const Device& device)
+    : _device(device)
+{}
+
+
+Hiss::BarrierBatch::~BarrierBatch()
+{
+    assert(empty() && "barrier batch destroyed without flush");
+}
+
+
+Hiss::BarrierBatch& Hiss::BarrierBatch::memory(const StageAccess& src, const StageAccess& dst)
+{
+    _memory.srcStageMask |= to_stage2(src.stage);
+    _memory.srcAccessMask |= to_access2(src.access);
+    _memory.dstStageMask |= to_stage2(dst.stage);
+    _memory.dstAccessMask |= to_access2(dst.access);
+    _has_memory = true;
+    return *this;
+}
+
+
+Hiss::BarrierBatch& Hiss::BarrierBatch::buffer(vk::Buffer buffer, const StageAccess& src, const StageAccess& dst,
+                                               vk::DeviceSize offset, vk::DeviceSize size)
+{
+    for (auto& barrier: _buffers)
+    {
+        if (barrier.buffer != buffer || barrier.offset != offset || barrier.size != size)
+            continue;
+
+        barrier.srcStageMask |= to_stage2(src.stage);
+        barrier.srcAccessMask |= to_access2(src.access);
+        barrier.dstStageMask |= to_stage2(dst.stage);
+        barrier.dstAccessMask |= to_access2(dst.access);
+        return *this;
+    }
+
+    _buffers.push_back(vk::BufferMemoryBarrier2KHR{
+            .srcStageMask        = to_stage2(src.stage),
+            .srcAccessMask       = to_access2(src.access),
+            .dstStageMask        = to_stage2(dst.stage),
+            .dstAccessMask       = to_access2(dst.access),
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .buffer              = buffer,
+            .offset              = offset,
+            .size                = size,
+    });
+    return *this;
+}
+
+
+Hiss::BarrierBatch& Hiss::BarrierBatch::image(vk::Image image, const vk::ImageSubresourceRange& range,
+                                              const StageAccess& src, const StageAccess& dst,
+                                              vk::ImageLayout old_layout, vk::ImageLayout new_layout)
+{
+    // 同一个 image 在一次 barrier 中只能有一次 layout 转换，因此只合并完全相同的转换
+    for (auto& barrier: _images)
+    {
+        if (barrier.image != image || barrier.subresourceRange != range || barrier.oldLayout != old_layout
+            || barrier.newLayout != new_layout)
+            continue;
+
+        barrier.srcStageMask |= to_stage2(src.stage);
+        barrier.srcAccessMask |= to_access2(src.access);
+        barrier.dstStageMask |= to_stage2(dst.stage);
+        barrier.dstAccessMask |= to_access2(dst.access);
+        return *this;
+    }
+
+    _images.push_back(vk::ImageMemoryBarrier2KHR{
+            .srcStageMask        = to_stage2(src.stage),
+            .srcAccessMask       = to_access2(src.access),
+            .dstStageMask        = to_stage2(dst.stage),
+            .dstAccessMask       = to_access2(dst.access),
+            .oldLayout           = old_layout,
+            .newLayout           = new_layout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image               = image,
+            .subresourceRange    = range,
+    });
+    return *this;
+}
+
+
+void Hiss::BarrierBatch::flush(vk::CommandBuffer command_buffer)
+{
+    if (empty())
+        return;
+
+    if (_device.synchronization2())
+        _flush_sync2(command_buffer);
+    else
+        _flush_legacy(command_buffer);
+
+    _barrier_count += (_has_memory ? 1 : 0) + _buffers.size() + _images.size();
+    _call_count++;
+    _clear();
+}
+
+
+void Hiss::BarrierBatch::_flush_sync2(vk::CommandBuffer command_buffer)
+{
+    command_buffer.pipelineBarrier2KHR(vk::DependencyInfoKHR{
+            .memoryBarrierCount       = _has_memory ? 1u : 0u,
+            .pMemoryBarriers          = &_memory,
+            .bufferMemoryBarrierCount = (uint32_t) _buffers.size(),
+            .pBufferMemoryBarriers    = _buffers.data(),
+            .imageMemoryBarrierCount  = (uint32_t) _images.size(),
+            .pImageMemoryBarriers     = _images.data(),
+    });
+}
+
+
+void Hiss::BarrierBatch::_flush_legacy(vk::CommandBuffer command_buffer)
+{
+    // 旧的接口只有一组 stage mask，合并所有 barrier 的 stage
+    vk::PipelineStageFlags src_stage;
+    vk::PipelineStageFlags dst_stage;
+
+    vk::MemoryBarrier memory_barrier;
+    if (_has_memory)
+    {
+        src_stage |= to_stage(_memory.srcStageMask);
+        dst_stage |= to_stage(_memory.dstStageMask);
+        memory_barrier.srcAccessMask = to_access(_memory.srcAccessMask);
+        memory_barrier.dstAccessMask = to_access(_memory.dstAccessMask);
+    }
+
+    SmallVector<vk::BufferMemoryBarrier, 4> buffer_barriers;
+    for (auto& barrier: _buffers)
+    {
+        src_stage |= to_stage(barrier.srcStageMask);
+        dst_stage |= to_stage(barrier.dstStageMask);
+        buffer_barriers.push_back(vk::BufferMemoryBarrier{
+                .srcAccessMask       = to_access(barrier.srcAccessMask),
+                .dstAccessMask       = to_access(barrier.dstAccessMask),
+                .srcQueueFamilyIndex = barrier.srcQueueFamilyIndex,
+                .dstQueueFamilyIndex = barrier.dstQueueFamilyIndex,
+                .buffer              = barrier.buffer,
+                .offset              = barrier.offset,
+                .size                = barrier.size,
+        });
+    }
+
+    SmallVector<vk::ImageMemoryBarrier, 4> image_barriers;
+    for (auto& barrier: _images)
+    {
+        src_stage |= to_stage(barrier.srcStageMask);
+        dst_stage |= to_stage(barrier.dstStageMask);
+        image_barriers.push_back(vk::ImageMemoryBarrier{
+                .srcAccessMask       = to_access(barrier.srcAccessMask),
+                .dstAccessMask       = to_access(barrier.dstAccessMask),
+                .oldLayout           = barrier.oldLayout,
+                .newLayout           = barrier.newLayout,
+                .srcQueueFamilyIndex = barrier.srcQueueFamilyIndex,
+                .dstQueueFamilyIndex = barrier.dstQueueFamilyIndex,
+                .image               = barrier.image,
+                .subresourceRange    = barrier.subresourceRange,
+        });
+    }
+
+    // 旧的接口中 stage mask 不能为 0
+    if (!src_stage)
+        src_stage = vk::PipelineStageFlagBits::eTopOfPipe;
+    if (!dst_stage)
+        dst_stage = vk::PipelineStageFlagBits::eBottomOfPipe;
+
+    command_buffer.pipelineBarrier(src_stage, dst_stage, {}, {_has_memory ? 1u : 0u, &memory_barrier},
+                                   {(uint32_t) buffer_barriers.size(), buffer_barriers.data()},
+                                   {(uint32_t) image_barriers.size(), image_barriers.data()});
+}
+
+
+void Hiss::BarrierBatch::_clear()
+{
+    _has_memory = false;
+    _memory     = vk::MemoryBarrier2KHR{};
+    _buffers.clear();
+    _images.clear();
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include "vk_common.hpp"
+#include "utils/arena.hpp"
+
+
+namespace Hiss
+{
+
+class Device;
+
+
+/**
+ * 收集 image、buffer 以及全局的 barrier，flush 时用一次 pipeline barrier 提交
+ * @details 启用了 VK_KHR_synchronization2 时使用 vkCmdPipelineBarrier2，每个 barrier 保留自己的 stage mask；
+ *  否则回退到 vkCmdPipelineBarrier，所有 barrier 的 stage mask 合并在一起
+ * @details 合并：全局 barrier 只保留一个；同一个 buffer 的同一个区间，同一个 image 的同一个 range 以及
+ *  相同的 layout 变化，access mask 和 stage mask 会合并为一个 barrier
+ * @details 不是线程安全的，通常在栈上创建，录制完一组 barrier 之后立即 flush
+ * @example
+ * \n - BarrierBatch barriers{device};
+ * \n - image.memory_barrier(barriers, ...); buffer.memory_barrier(barriers, ...);
+ * \n - barriers.flush(command_buffer);
+ */
+class BarrierBatch
+{
+public:
+    // 进程启动以来 flush 的统计，Engine 用于计算每一帧的数量
+    struct Stats
+    {
+        uint64_t barrier_num = 0;    // 合并之后的 barrier 数量
+        uint64_t call_num    = 0;    // vkCmdPipelineBarrier(2) 的调用次数
+    };
+
+
+    explicit BarrierBatch(const Device& device);
+
+    // 没有 flush 的 barrier 会被丢弃，debug 模式下会断言
+    ~BarrierBatch();
+
+    BarrierBatch(const BarrierBatch&)            = delete;
+    BarrierBatch& operator=(const BarrierBatch&) = delete;
+
+
+    /**
+     * 全局的 memory barrier，作用于所有的资源
+     */
+    BarrierBatch& memory(const StageAccess& src, const StageAccess& dst);
+
+
+    BarrierBatch& buffer(vk::Buffer buffer, const StageAccess& src, const StageAccess& dst,
+                         vk::DeviceSize offset = 0, vk::DeviceSize size = VK_WHOLE_SIZE);
+
+
+    /**
+     * old_layout 和 new_layout 相同时，只是 memory barrier
+     */
+    BarrierBatch& image(vk::Image image, const vk::ImageSubresourceRange& range, const StageAccess& src,
+                        const StageAccess& dst, vk::ImageLayout old_layout, vk::ImageLayout new_layout);
+
+
+    /**
+     * 将收集到的 barrier 录制到 command buffer 中，之后 batch 为空，可以继续使用
+     */
+    void flush(vk::CommandBuffer command_buffer);
+
+    bool empty() const { return !_has_memory && _buffers.empty() && _images.empty(); }
+
+
+    static Stats stats() { return Stats{.barrier_num = _barrier_count, .call_num = _call_count}; }
+
+
+private:
+    void _flush_sync2(vk::CommandBuffer command_buffer);
+    void _flush_legacy(vk::CommandBuffer command_buffer);
+    void _clear();
+
+
+    inline static std::atomic<uint64_t> _barrier_count{0};
+    inline static std::atomic<uint64_t> _call_count{0};
+
+    const Device& _device;
+
+    bool                                        _has_memory = false;
+    vk::MemoryBarrier2KHR                       _memory;
+    SmallVector<vk::BufferMemoryBarrier2KHR, 4> _buffers;
+    SmallVector<vk::ImageMemoryBarrier2KHR, 4>  _images;
+};
+
+}    // namespace Hiss
@@ -60,14 +60,11 @@ void Hiss::OneTimeCommand::exec()
     vk::Fence fence = _device.fence_pool().acquire(false);
 
     _command_buffer.end();
-    _pool.queue().vkqueue().submit({vk::SubmitInfo{
-                                           .commandBufferCount = 1,
-                                           .pCommandBuffers    = &_command_buffer,
-                                   }},
-                                   fence);
+    _pool.queue().submit_commands({}, {_command_buffer}, {}, fence);
 
     (void) _device.vkdevice().waitForFences({fence}, VK_TRUE, UINT64_MAX);
     _device.fence_pool().revert(fence);
 
     _used = true;
+    _sync_submit_count++;
 }
\ No newline at end of file
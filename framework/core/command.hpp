@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include "vk_common.hpp"
 
 
@@ -52,7 +53,15 @@ public:
     vk::CommandBuffer& operator()() { return _command_buffer; }
     void               exec();
 
+    /**
+     * 进程启动以来 exec 的总次数，每次 exec 都会让 CPU 等待 GPU
+     * @details 用于检查渲染循环中是否还有同步的上传
+     */
+    static uint64_t sync_submit_count() { return _sync_submit_count; }
+
 private:
+    inline static std::atomic<uint64_t> _sync_submit_count{0};
+
     const Device&     _device;
     CommandPool&      _pool;
     vk::CommandBuffer _command_buffer;
@@ -2,6 +2,7 @@
 #include "core/window.hpp"
 #include "utils/tools.hpp"
 #include "vk_config.hpp"
+#include <algorithm>
 #include <set>
 
 
@@ -10,7 +11,8 @@ Hiss::Device::Device(GPU& physical_device_)
 {
     create_logical_device();
     create_command_pool();
-    _fence_pool = new FencePool(*this);
+    _fence_pool     = new FencePool(*this);
+    _deletion_queue = new DeletionQueue(*this);
 }
 
 
@@ -27,13 +29,81 @@ void Hiss::Device::create_logical_device()
 
     /* extensions */
     std::vector<const char*> device_ext_list = get_device_extensions();
+    for (auto ext: get_optional_device_extensions())
+    {
+        if (_gpu.is_support_extension(ext))
+            device_ext_list.push_back(ext);
+        else
+            spdlog::info("[device] optional extension not supported: {}", ext);
+    }
+
+
+    /* present wait 还需要 GPU 支持对应的 feature，否则这两个 extension 都不启用 */
+    auto has_extension = [&device_ext_list](const char* name) {
+        return std::any_of(device_ext_list.begin(), device_ext_list.end(),
+                           [name](const char* ext) { return std::string(ext) == name; });
+    };
+    vk::PhysicalDevicePresentIdFeaturesKHR   present_id_feature;
+    vk::PhysicalDevicePresentWaitFeaturesKHR present_wait_feature;
+    if (has_extension(VK_KHR_PRESENT_ID_EXTENSION_NAME) && has_extension(VK_KHR_PRESENT_WAIT_EXTENSION_NAME))
+    {
+        auto features = _gpu.vkgpu().getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDevicePresentIdFeaturesKHR,
+                                                  vk::PhysicalDevicePresentWaitFeaturesKHR>();
+        present_id_feature.presentId     = features.get<vk::PhysicalDevicePresentIdFeaturesKHR>().presentId;
+        present_wait_feature.presentWait = features.get<vk::PhysicalDevicePresentWaitFeaturesKHR>().presentWait;
+    }
+    bool present_wait = present_id_feature.presentId && present_wait_feature.presentWait;
+    if (!present_wait)
+    {
+        device_ext_list.erase(std::remove_if(device_ext_list.begin(), device_ext_list.end(),
+                                             [](const char* ext) {
+                                                 return std::string(ext) == VK_KHR_PRESENT_ID_EXTENSION_NAME
+                                                     || std::string(ext) == VK_KHR_PRESENT_WAIT_EXTENSION_NAME;
+                                             }),
+                              device_ext_list.end());
+    }
+
+
+    /* synchronization2 同样需要 GPU 支持对应的 feature */
+    vk::PhysicalDeviceSynchronization2FeaturesKHR sync2_feature;
+    if (has_extension(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME))
+    {
+        auto features = _gpu.vkgpu().getFeatures2<vk::PhysicalDeviceFeatures2,
+                                                  vk::PhysicalDeviceSynchronization2FeaturesKHR>();
+        sync2_feature.synchronization2 =
+                features.get<vk::PhysicalDeviceSynchronization2FeaturesKHR>().synchronization2;
+    }
+    _synchronization2 = sync2_feature.synchronization2;
+    if (!_synchronization2)
+    {
+        device_ext_list.erase(std::remove_if(device_ext_list.begin(), device_ext_list.end(),
+                                             [](const char* ext) {
+                                                 return std::string(ext) == VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME;
+                                             }),
+                              device_ext_list.end());
+    }
+    spdlog::info("[device] synchronization2: {}", _synchronization2);
+    _enabled_extensions.insert(device_ext_list.begin(), device_ext_list.end());
 
 
     /* feature */
     vk::PhysicalDeviceFeatures device_feature = get_device_features();
 
-    // dynamic rendering 需要在 .pNext 字段添加
+    // dynamic rendering 需要在 .pNext 字段添加，可选的 feature 依次追加到链表的末尾
     vk::PhysicalDeviceDynamicRenderingFeatures feature = {.dynamicRendering = VK_TRUE};
+    void**                                     tail    = &feature.pNext;
+    if (present_wait)
+    {
+        *tail = &present_id_feature;
+        tail  = &present_id_feature.pNext;
+        *tail = &present_wait_feature;
+        tail  = &present_wait_feature.pNext;
+    }
+    if (_synchronization2)
+    {
+        *tail = &sync2_feature;
+        tail  = &sync2_feature.pNext;
+    }
 
     vkdevice = _gpu.vkgpu().createDevice(vk::DeviceCreateInfo{
             .pNext                   = &feature,
@@ -67,6 +137,7 @@ void Hiss::Device::create_command_pool()
 
 Hiss::Device::~Device()
 {
+    DELETE(_deletion_queue);
     DELETE(_fence_pool);
     DELETE(_command_pool);
     DELETE(_queue);
@@ -115,7 +186,7 @@ vk::Semaphore Hiss::Device::create_semaphore(const std::string& debug_name, bool
 
     /* 提交一个空命令，并通知刚创建的 semaphore，这样来创建 signaled 状态的 semphore */
     vk::Fence temp_fence = fence_pool().acquire(false);
-    queue().vkqueue().submit(vk::SubmitInfo{.signalSemaphoreCount = 1, .pSignalSemaphores = &semaphore}, temp_fence);
+    queue().submit_commands({}, {}, {semaphore}, temp_fence);
     if (vk::Result::eSuccess != vkdevice().waitForFences({temp_fence}, VK_TRUE, UINT64_MAX))
         throw std::runtime_error("error on create semaphore.");
     fence_pool().revert(temp_fence);
@@ -1,10 +1,12 @@
 #pragma once
+#include <set>
 #include "vk_common.hpp"
 #include "core/queue.hpp"
 #include "core/window.hpp"
 #include "gpu.hpp"
 #include "command.hpp"
 #include "utils/fence_pool.hpp"
+#include "utils/deletion_queue.hpp"
 
 
 namespace Hiss
@@ -23,7 +25,13 @@ public:
     vk::Semaphore create_semaphore(const std::string& debug_name = "", bool signal = false);
 
     template<class handle_t>
-    void set_debug_name(vk::ObjectType type, handle_t handle, const std::string& name) const;
+    void set_debug_name(vk::ObjectType type, handle_t handle, const char* name) const;
+
+    template<class handle_t>
+    void set_debug_name(vk::ObjectType type, handle_t handle, const std::string& name) const
+    {
+        set_debug_name(type, handle, name.c_str());
+    }
 
 
     vk::CommandBuffer create_commnad_buffer(const std::string& debug_name)
@@ -52,6 +60,18 @@ public:
     CommandPool& command_pool() const { return *_command_pool; }
     FencePool&   fence_pool() const { return *_fence_pool; }
 
+    // 替换、释放资源时不需要等待 device idle
+    DeletionQueue& deletion_queue() const { return *_deletion_queue; }
+
+    /// 是否启用了某个 device extension（包括可选的 extension）
+    bool is_extension_enabled(const std::string& extension_name) const
+    {
+        return _enabled_extensions.count(extension_name) > 0;
+    }
+
+    /// 是否启用了 VK_KHR_synchronization2，录制 barrier 时使用，因此单独缓存
+    bool synchronization2() const { return _synchronization2; }
+
 #pragma endregion
 
 
@@ -62,17 +82,22 @@ private:
     Queue*       _queue        = nullptr;
     CommandPool* _command_pool = nullptr;
     FencePool*   _fence_pool   = nullptr;
+
+    DeletionQueue* _deletion_queue = nullptr;
+
+    std::set<std::string> _enabled_extensions;
+    bool                  _synchronization2 = false;
 #pragma endregion
 };
 }    // namespace Hiss
 
 
 template<class handle_t>
-void Hiss::Device::set_debug_name(vk::ObjectType type, handle_t handle, const std::string& name) const
+void Hiss::Device::set_debug_name(vk::ObjectType type, handle_t handle, const char* name) const
 {
     vkdevice().setDebugUtilsObjectNameEXT(vk::DebugUtilsObjectNameInfoEXT{
             .objectType   = type,
             .objectHandle = (uint64_t) handle,
-            .pObjectName  = name.c_str(),
+            .pObjectName  = name,
     });
 }
\ No newline at end of file
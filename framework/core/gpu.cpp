@@ -1,4 +1,5 @@
 #include "gpu.hpp"
+#include <cstring>
 
 
 Hiss::GPU::GPU(vk::PhysicalDevice physical_device, vk::SurfaceKHR surface)
@@ -80,6 +81,26 @@ bool Hiss::GPU::is_support_linear_filter(vk::Format format) const
 }
 
 
+bool Hiss::GPU::is_support_linear_blit(vk::Format format) const
+{
+    vk::FormatProperties  format_property = vkgpu().getFormatProperties(format);
+    vk::FormatFeatureFlags features        = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst
+                                   | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+    return BITS_CONTAIN(format_property.optimalTilingFeatures, features);
+}
+
+
+bool Hiss::GPU::is_support_extension(const char* extension_name) const
+{
+    for (auto& ext: vkgpu().enumerateDeviceExtensionProperties())
+    {
+        if (std::strcmp(ext.extensionName, extension_name) == 0)
+            return true;
+    }
+    return false;
+}
+
+
 std::optional<uint32_t> Hiss::GPU::find_all_powerful_queue(vk::PhysicalDevice gpu, vk::SurfaceKHR surface)
 {
     std::optional<uint32_t> all_powerful_queue;
@@ -15,6 +15,12 @@ public:
 public:
     /// format 是否支持 linear filter
     bool is_support_linear_filter(vk::Format format) const;
+
+    /// format 是否可以作为 blit 的 src 和 dst，并且支持 linear filter，用于生成 mipmap
+    bool is_support_linear_blit(vk::Format format) const;
+
+    /// 是否支持某个 device extension
+    bool is_support_extension(const char* extension_name) const;
 #pragma endregion
 
 
@@ -1,5 +1,7 @@
 #pragma once
+#include <mutex>
 #include "utils/tools.hpp"
+#include "utils/arena.hpp"
 
 
 namespace Hiss
@@ -30,16 +32,23 @@ struct Queue
     }
 
 
-    // 提交命令执行
-    void submit_commands(const std::vector<StageSemaphore>& dst, const std::vector<vk::CommandBuffer>& command_buffers,
-                         const std::vector<vk::Semaphore>& signal_semaphores = {}, vk::Fence fence = VK_NULL_HANDLE)
+    /**
+     * 提交命令执行
+     * @details 参数是 ArrayProxy，可以直接传入 {a, b}，vector 或者单个元素，不会在堆上分配内存
+     */
+    void submit_commands(vk::ArrayProxy<const StageSemaphore>    dst,
+                         vk::ArrayProxy<const vk::CommandBuffer> command_buffers,
+                         vk::ArrayProxy<const vk::Semaphore>     signal_semaphores = {},
+                         vk::Fence                               fence             = VK_NULL_HANDLE) const
     {
-        std::vector<vk::PipelineStageFlags> stages(dst.size());
-        std::vector<vk::Semaphore>          wait_semaphores(dst.size());
-        for (int i = 0; i < dst.size(); ++i)
+        SmallVector<vk::PipelineStageFlags, 8> stages;
+        SmallVector<vk::Semaphore, 8>          wait_semaphores;
+        stages.resize(dst.size());
+        wait_semaphores.resize(dst.size());
+        for (uint32_t i = 0; i < dst.size(); ++i)
         {
-            stages[i]          = dst[i].stage;
-            wait_semaphores[i] = dst[i].semaphore;
+            stages[i]          = dst.data()[i].stage;
+            wait_semaphores[i] = dst.data()[i].semaphore;
         }
 
         vk::SubmitInfo submit_info = {
@@ -52,13 +61,18 @@ struct Queue
                 .pSignalSemaphores    = signal_semaphores.data(),
         };
 
-        if (fence)
-            vkqueue._value.submit({submit_info}, fence);
-        else
-            vkqueue._value.submit({submit_info});
+        auto guard = lock();
+        vkqueue._value.submit(submit_info, fence);
     }
 
 
+    /**
+     * vkQueueSubmit，vkQueuePresentKHR 以及 vkDeviceWaitIdle 需要对 queue 进行外部同步
+     * @details 启用 present 线程时，present 和提交命令位于不同的线程
+     */
+    std::unique_lock<std::mutex> lock() const { return std::unique_lock<std::mutex>(_mutex); }
+
+
 #pragma region public properties
 public:
     Prop<vk::Queue, Queue> vkqueue;
@@ -66,5 +80,9 @@ public:
     Prop<QueueFlag, Queue> queue_flag;
 
 #pragma endregion
+
+
+private:
+    mutable std::mutex _mutex;
 };
 }    // namespace Hiss
\ No newline at end of file
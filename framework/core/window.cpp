@@ -31,6 +31,7 @@ Hiss::Window::Window(const std::string& title, int width, int height)
     /* 设置窗口大小改变的 callback */
     glfwSetWindowUserPointer(window, &_user_data);
     glfwSetFramebufferSizeCallback(window, callback_window_resize);
+    glfwSetKeyCallback(window, callback_key);
 }
 
 
@@ -63,6 +64,15 @@ void Hiss::Window::callback_window_resize(GLFWwindow* window, int width, int hei
 }
 
 
+void Hiss::Window::callback_key(GLFWwindow* window, int key, int, int action, int)
+{
+    if (action != GLFW_PRESS || key < 0 || key > GLFW_KEY_LAST)    // GLFW_KEY_UNKNOWN 为 -1
+        return;
+    auto user_data = reinterpret_cast<UserData*>(glfwGetWindowUserPointer(window));
+    user_data->pressed_keys.set(key);
+}
+
+
 vk::SurfaceKHR Hiss::Window::create_surface(vk::Instance instance) const
 {
     /* 调用 glfw 来创建 window surface，这样可以避免平台相关的细节 */
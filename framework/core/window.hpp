@@ -1,4 +1,5 @@
 #pragma once
+#include <bitset>
 #include "vk_common.hpp"
 #include "utils/tools.hpp"
 
@@ -30,15 +31,29 @@ public:
     bool should_close() const { return glfwWindowShouldClose(this->window); }
 
 
-    // 处理窗口系统的各种事件：鼠标，键盘
-    void poll_event() const
+    // 处理窗口系统的各种事件：鼠标，键盘；上一帧中没有被 consume_key 处理的按键会被丢弃
+    void poll_event()
     {
+        _user_data.pressed_keys.reset();
         glfwPollEvents();
         if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
             glfwSetWindowShouldClose(window, true);
     }
 
 
+    /**
+     * 这一帧的 poll_event 中，某个按键是否被按下过，每次按下只会返回一次 true
+     * @param key GLFW_KEY_*
+     */
+    bool consume_key(int key)
+    {
+        if (key < 0 || key > GLFW_KEY_LAST || !_user_data.pressed_keys.test(key))
+            return false;
+        _user_data.pressed_keys.reset(key);
+        return true;
+    }
+
+
     // vulkan 所需的 instance extension
     std::vector<const char*> get_extensions() const;
 
@@ -46,6 +61,8 @@ public:
 private:
     static void callback_window_resize(GLFWwindow* window, int width, int height);
 
+    static void callback_key(GLFWwindow* window, int key, int scancode, int action, int mods);
+
     void clear_resized_state() { _user_data.resized = false; }
 
     /// 等待退出最小化模式
@@ -65,6 +82,8 @@ private:
         bool resized = false;
         int  width   = 0;    // window 的尺寸，单位并不是 pixel
         int  height  = 0;
+
+        std::bitset<GLFW_KEY_LAST + 1> pressed_keys;    // 这一帧中还没有被 consume_key 处理的按键，不会分配内存
     } _user_data = {};
 
 
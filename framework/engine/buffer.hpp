@@ -1,21 +1,29 @@
 #pragma once
+#include <atomic>
+#include <cstring>
 #include <utility>
 
 #include "../core/device.hpp"
+#include "../core/barrier_batch.hpp"
+#include "memory_policy.hpp"
+#include "relocatable.hpp"
+#include "resource_registry.hpp"
 
 
 namespace Hiss
 {
 
-class Buffer
+class Buffer : public Relocatable
 {
 public:
     Buffer(Hiss::Device& device, VmaAllocator allocator, vk::DeviceSize size, vk::BufferUsageFlags buffer_usage,
            VmaAllocationCreateFlags memory_flags, std::string name)
-        : size(size),
+        : Relocatable(Kind::Buffer),
+          size(size),
           name(std::move(name)),
           device(device),
-          _allocator(allocator)
+          _allocator(allocator),
+          _usage(buffer_usage)
     {
         assert(size > 0);
 
@@ -24,18 +32,33 @@ public:
                 .size  = size,
                 .usage = (VkBufferUsageFlags) buffer_usage,
         };
-        VmaAllocationCreateInfo indices_alloc_create_info = {
-                .flags    = memory_flags,
-                .usage    = VMA_MEMORY_USAGE_AUTO,
-                .priority = 1.f,
-        };
-        vmaCreateBuffer(allocator, &indices_buffer_info, &indices_alloc_create_info, &vkbuffer._value, &_allocation,
-                        &_alloc_info);
+        // 具体的分配方式（dedicated，pool 等）由 memory policy 决定
+        MemoryPolicy::create_buffer(allocator, indices_buffer_info, memory_flags, &vkbuffer._value, &_allocation,
+                                    &_alloc_info);
+        // Defragmenter 通过 user data 找到 allocation 对应的资源
+        vmaSetAllocationUserData(allocator, _allocation, static_cast<Relocatable*>(this));
 
         device.set_debug_name(vk::ObjectType::eBuffer, vkbuffer._value, this->name);
+
+        ResourceRegistry::add(allocator, vkbuffer._value,
+                              {
+                                      .name     = this->name,
+                                      .category = ResourceRegistry::buffer_category(buffer_usage),
+                                      .usage    = vk::to_string(buffer_usage),
+                              },
+                              _alloc_info);
     }
 
-    ~Buffer() { vmaDestroyBuffer(_allocator, vkbuffer._value, _allocation); }
+    ~Buffer()
+    {
+        ResourceRegistry::remove(_allocator, vkbuffer._value);
+
+        // Defragmenter 还没有结束这一轮移动：allocation 由 VMA 释放
+        if (_abort_relocation())
+            device.vkdevice().destroy(vkbuffer._value);
+        else
+            vmaDestroyBuffer(_allocator, vkbuffer._value, _allocation);
+    }
 
 
     /**
@@ -43,27 +66,156 @@ public:
      */
     void memory_barrier(vk::CommandBuffer& command_buffer, const StageAccess& src, const StageAccess& dst)
     {
-        command_buffer.pipelineBarrier(src.stage, dst.stage, {}, {},
-                                       vk::BufferMemoryBarrier{
-                                               .srcAccessMask = src.access,
-                                               .dstAccessMask = dst.access,
-                                               .buffer        = vkbuffer._value,
-                                               .offset        = 0,
-                                               .size          = size._value,
-                                       },
-                                       {});
+        BarrierBatch barriers{device};
+        memory_barrier(barriers, src, dst);
+        barriers.flush(command_buffer);
+    }
+
+
+    /**
+     * 将关于当前 buffer 的内存屏障加入 batch，和其他的 barrier 一起提交
+     */
+    void memory_barrier(BarrierBatch& barriers, const StageAccess& src, const StageAccess& dst) const
+    {
+        barriers.buffer(vkbuffer._value, src, dst, 0, size._value);
     }
 
 
     /**
      * 将内存拷贝到 stage buffer 中
      * @details 需要由 application 确保 buffer 是可以 map 的
+     * @param offset 写入到 buffer 中的位置，单位是 byte
      */
-    void mem_copy(const void* src, vk::DeviceSize src_size) const
+    void mem_copy(const void* src, vk::DeviceSize src_size, vk::DeviceSize offset = 0) const
     {
-        assert(this->size() >= src_size);
+        assert(this->size() >= offset + src_size);
 
-        std::memcpy(_alloc_info.pMappedData, src, src_size);
+        std::memcpy(static_cast<uint8_t*>(_alloc_info.pMappedData) + offset, src, src_size);
+    }
+
+
+    /**
+     * 将 host 写入的数据 flush 到 device，memory 是 host coherent 时不会做任何事情
+     * @details 需要在提交使用这些数据的 command 之前调用
+     */
+    void flush(vk::DeviceSize offset = 0, vk::DeviceSize flush_size = VK_WHOLE_SIZE) const
+    {
+        vmaFlushAllocation(_allocator, _allocation, offset, flush_size);
+    }
+
+
+    /**
+     * 持久映射的地址，buffer 不可 map 时为 nullptr
+     */
+    void* mapped_data() const { return _alloc_info.pMappedData; }
+
+
+    /**
+     * memory 是否为 host visible：UMA（集成显卡，lavapipe）或者 resizable BAR 时，device local 的 memory 也可能是
+     */
+    bool host_visible() const
+    {
+        VkMemoryPropertyFlags memory_flags;
+        vmaGetAllocationMemoryProperties(_allocator, _allocation, &memory_flags);
+        return memory_flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    }
+
+
+    /**
+     * 立即将 data 写入到 buffer 中
+     * @details memory 是 host visible 时，直接写入 mapped 的地址；否则通过 stage buffer 以及 GPU 拷贝，会等待拷贝完成
+     * @details 使用 DIRECT_UPLOAD_FLAGS 创建的 buffer 会尽可能地使用前一种方式
+     * @details 需要确保 GPU 没有正在使用这段数据，并且 buffer 支持 transfer dst
+     * @param offset 写入到 buffer 中的位置，单位是 byte
+     */
+    inline void upload(const void* data, vk::DeviceSize data_size, vk::DeviceSize offset = 0);
+
+
+    /**
+     * 设备内存优先，如果 device local 的 memory 是 host visible，就会被 map，可以直接写入
+     */
+    static constexpr VmaAllocationCreateFlags DIRECT_UPLOAD_FLAGS =
+            VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT
+            | VMA_ALLOCATION_CREATE_HOST_ACCESS_ALLOW_TRANSFER_INSTEAD_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+
+    // 记录 upload 走了哪一条路径
+    struct UploadStats
+    {
+        std::atomic<uint64_t> direct_num{0};
+        std::atomic<uint64_t> direct_bytes{0};
+        std::atomic<uint64_t> staged_num{0};
+        std::atomic<uint64_t> staged_bytes{0};
+    };
+
+    static const UploadStats& upload_stats() { return _upload_stats; }
+
+    // 在外部合并为一次拷贝的上传，参考 GeometryArena::UploadBatch
+    static void record_staged_upload(vk::DeviceSize bytes)
+    {
+        _upload_stats.staged_num++;
+        _upload_stats.staged_bytes += bytes;
+    }
+
+
+    /**
+     * 是否可以被 Defragmenter 移动：需要设置 movable，并且 buffer 可以作为拷贝的 src 以及 dst
+     */
+    bool can_relocate() const
+    {
+        auto transfer = vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst;
+        return movable && (_usage & transfer) == transfer;
+    }
+
+
+    /**
+     * 由 Defragmenter 调用：在 dst_allocation 的位置创建新的 buffer，并录制拷贝的命令
+     * @details 拷贝在之前提交的命令对旧 buffer 的写入之后进行，之后的命令可以直接使用新的 buffer
+     */
+    void begin_relocation(VmaAllocation dst_allocation, vk::CommandBuffer command_buffer)
+    {
+        assert(can_relocate() && !_relocation_buffer);
+
+        _relocation_buffer = device.vkdevice().createBuffer(vk::BufferCreateInfo{.size = size._value, .usage = _usage});
+        vmaBindBufferMemory(_allocator, dst_allocation, _relocation_buffer);
+
+        BarrierBatch barriers{device};
+        barriers.buffer(vkbuffer._value, {vk::PipelineStageFlagBits::eAllCommands, vk::AccessFlagBits::eMemoryWrite},
+                        {vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferRead});
+        barriers.flush(command_buffer);
+
+        command_buffer.copyBuffer(vkbuffer._value, _relocation_buffer, {vk::BufferCopy{.size = size._value}});
+
+        barriers.buffer(_relocation_buffer, {vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite},
+                        {vk::PipelineStageFlagBits::eAllCommands,
+                         vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite});
+        barriers.flush(command_buffer);
+    }
+
+
+    /**
+     * 由 Defragmenter 调用：录制拷贝之后立即换成新的 handle，并通知使用者
+     * @details 之前提交的 frame 可能仍然在使用旧的 buffer，交给 deletion queue
+     */
+    void end_relocation()
+    {
+        std::swap(vkbuffer._value, _relocation_buffer);
+        ResourceRegistry::relocate(_allocator, _relocation_buffer, vkbuffer._value, _alloc_info);
+        device.deletion_queue().destroy(vk::Buffer(_relocation_buffer));
+        _relocation_buffer = VK_NULL_HANDLE;
+        device.set_debug_name(vk::ObjectType::eBuffer, vkbuffer._value, name);
+
+        _notify_relocated();
+    }
+
+
+    /**
+     * 由 Defragmenter 调用：VMA 完成这一轮移动之后，更新分配信息
+     */
+    void finish_relocation()
+    {
+        vmaGetAllocationInfo(_allocator, _allocation, &_alloc_info);
+        ResourceRegistry::relocate(_allocator, vkbuffer._value, vkbuffer._value, _alloc_info);
     }
 
 
@@ -89,7 +241,7 @@ public:
         return std::make_shared<Hiss::Buffer>(device, allocator, size,
                                               vk::BufferUsageFlagBits::eStorageBuffer
                                                       | vk::BufferUsageFlagBits::eTransferDst,
-                                              VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT, name);
+                                              0, name);
     }
 
     /**
@@ -102,7 +254,7 @@ public:
         return std::make_shared<Hiss::Buffer>(device, allocator, size,
                                               vk::BufferUsageFlagBits::eUniformBuffer
                                                       | vk::BufferUsageFlagBits::eTransferDst,
-                                              VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT, name);
+                                              0, name);
     }
 
 public:
@@ -116,6 +268,11 @@ protected:
     VmaAllocator      _allocator;
     VmaAllocation     _allocation{};    // 对应 memory
     VmaAllocationInfo _alloc_info{};    // 分配信息，例如内存映射的地址
+
+    vk::BufferUsageFlags _usage;
+    VkBuffer             _relocation_buffer = VK_NULL_HANDLE;    // 移动过程中，位于新位置的 buffer
+
+    inline static UploadStats _upload_stats;
 };
 
 
@@ -131,6 +288,43 @@ public:
 };
 
 
+inline void Buffer::upload(const void* data, vk::DeviceSize data_size, vk::DeviceSize offset)
+{
+    assert(offset + data_size <= size());
+
+    if (host_visible())
+    {
+        // 没有持久映射时，临时 map 一次
+        void* mapped = _alloc_info.pMappedData;
+        if (!mapped)
+            vmaMapMemory(_allocator, _allocation, &mapped);
+
+        std::memcpy(static_cast<uint8_t*>(mapped) + offset, data, data_size);
+        vmaFlushAllocation(_allocator, _allocation, offset, data_size);
+
+        if (!_alloc_info.pMappedData)
+            vmaUnmapMemory(_allocator, _allocation);
+
+        _upload_stats.direct_num++;
+        _upload_stats.direct_bytes += data_size;
+        spdlog::debug("[buffer] {}: direct upload, {} bytes", name, data_size);
+        return;
+    }
+
+    StageBuffer stage_buffer(device, _allocator, data_size, fmt::format("{}-stage-buffer", name));
+    stage_buffer.mem_copy(data, data_size);
+
+    OneTimeCommand command_buffer{device, device.command_pool()};
+    command_buffer().copyBuffer(stage_buffer.vkbuffer(), vkbuffer(),
+                                {vk::BufferCopy{.dstOffset = offset, .size = data_size}});
+    command_buffer.exec();
+
+    _upload_stats.staged_num++;
+    _upload_stats.staged_bytes += data_size;
+    spdlog::debug("[buffer] {}: staged upload, {} bytes", name, data_size);
+}
+
+
 class UniformBuffer : public Buffer
 {
 public:
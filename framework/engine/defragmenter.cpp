@@ -0,0 +1,227 @@
+#include "engine/defragmenter.hpp"
+#include "engine/image.hpp"
+#include "engine/frame.hpp"
+
+#include <spdlog/spdlog.h>
+
+
+namespace
+{
+
+double to_mb(vk::DeviceSize bytes)
+{
+    return (double) bytes / 1024.0 / 1024.0;
+}
+
+
+bool can_relocate(Hiss::Relocatable& resource)
+{
+    if (resource.relocatable_kind == Hiss::Relocatable::Kind::Buffer)
+        return static_cast<Hiss::Buffer&>(resource).can_relocate();
+    return static_cast<Hiss::Image2D&>(resource).can_relocate();
+}
+
+}    // namespace
+
+
+Hiss::Defragmenter::Defragmenter(Device& device, VmaAllocator allocator, const Config& config)
+    : _device(device),
+      _allocator(allocator),
+      _config(config)
+{}
+
+
+Hiss::Defragmenter::~Defragmenter()
+{
+    // 还在等待的一轮：flush 会等待 device idle，然后执行回调结束这一轮
+    if (_pass_pending)
+        _device.deletion_queue().flush();
+    if (_context)
+        _end();
+}
+
+
+Hiss::Defragmenter::Fragmentation Hiss::Defragmenter::fragmentation() const
+{
+    VmaTotalStatistics stats;
+    vmaCalculateStatistics(_allocator, &stats);
+
+    auto& total = stats.total;
+    return Fragmentation{
+            .block_num    = total.statistics.blockCount,
+            .block_bytes  = total.statistics.blockBytes,
+            .free_bytes   = total.statistics.blockBytes - total.statistics.allocationBytes,
+            .largest_free = total.unusedRangeCount ? total.unusedRangeSizeMax : 0,
+    };
+}
+
+
+void Hiss::Defragmenter::step(uint64_t frame_index, Frame& frame)
+{
+    // 上一轮还在等待之前提交的 frame
+    if (_pass_pending)
+        return;
+
+    if (!_context)
+    {
+        bool check = _config.check_interval && frame_index > 0 && frame_index % _config.check_interval == 0;
+        if (!_requested && !check)
+            return;
+
+        auto current = fragmentation();
+        if (!_requested && (current.ratio() < _config.threshold || current.free_bytes < _config.min_free_bytes))
+            return;
+
+        _requested = false;
+        _begin(current);
+        if (!_context)
+            return;
+    }
+
+    _pass(frame);
+}
+
+
+void Hiss::Defragmenter::_begin(const Fragmentation& fragmentation)
+{
+    VmaDefragmentationInfo info = {
+            .flags                 = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT,
+            .pool                  = nullptr,    // 只整理默认的 pool
+            .maxBytesPerPass       = _config.bytes_per_frame,
+            .maxAllocationsPerPass = _config.moves_per_frame,
+    };
+    if (vmaBeginDefragmentation(_allocator, &info, &_context) != VK_SUCCESS)
+    {
+        spdlog::error("[defragmenter] fail to begin defragmentation");
+        _context = nullptr;
+        return;
+    }
+
+    _before    = fragmentation;
+    _pass_num  = 0;
+    _moved_num = 0;
+    spdlog::info("[defragmenter] begin: fragmentation {:.2f}, {} blocks, {:.1f} MB free, largest free {:.1f} MB",
+                 fragmentation.ratio(), fragmentation.block_num, to_mb(fragmentation.free_bytes),
+                 to_mb(fragmentation.largest_free));
+}
+
+
+void Hiss::Defragmenter::_pass(Frame& frame)
+{
+    _pass_info = {};
+    if (vmaBeginDefragmentationPass(_allocator, _context, &_pass_info) == VK_SUCCESS)
+    {
+        _end();
+        return;
+    }
+    _pass_num++;
+
+
+    // 通过 user data 找到 allocation 对应的资源，无法移动的 allocation 保持原位
+    _moves.clear();
+    for (uint32_t i = 0; i < _pass_info.moveCount; ++i)
+    {
+        auto& move = _pass_info.pMoves[i];
+
+        VmaAllocationInfo alloc_info;
+        vmaGetAllocationInfo(_allocator, move.srcAllocation, &alloc_info);
+        auto* resource = static_cast<Relocatable*>(alloc_info.pUserData);
+
+        if (resource && can_relocate(*resource))
+            _moves.push_back(Move{.resource = resource, .index = i});
+        else
+            move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+    }
+
+    // 剩下的 allocation 都无法移动时结束，避免每一帧都空转
+    if (_moves.empty())
+    {
+        vmaEndDefragmentationPass(_allocator, _context, &_pass_info);
+        _end();
+        return;
+    }
+
+
+    // 拷贝在这一帧的其他命令之前执行，这一帧以及之后的 frame 直接使用新的 handle
+    auto command_buffer = frame.upload_command();
+    for (auto& move: _moves)
+    {
+        auto dst_allocation = _pass_info.pMoves[move.index].dstTmpAllocation;
+        if (move.resource->relocatable_kind == Relocatable::Kind::Buffer)
+            static_cast<Buffer*>(move.resource)->begin_relocation(dst_allocation, command_buffer);
+        else
+            static_cast<Image2D*>(move.resource)->begin_relocation(dst_allocation, command_buffer);
+    }
+    for (auto& move: _moves)
+    {
+        if (move.resource->relocatable_kind == Relocatable::Kind::Buffer)
+            static_cast<Buffer*>(move.resource)->end_relocation();
+        else
+            static_cast<Image2D*>(move.resource)->end_relocation();
+        move.resource->relocation_abort = [this](Relocatable* resource) { _abort_move(resource); };
+    }
+
+
+    /**
+     * 旧的 handle 已经交给 deletion queue，但是旧的位置在 VMA 的这一轮结束之前不会被重新分配
+     * 这个回调和旧的 handle 在同一批中：这一帧结束时插入的 fence signal 之后，之前的 frame 都不再使用旧的位置
+     */
+    _pass_pending = true;
+    _device.deletion_queue().push([this, alive = std::weak_ptr<void>(_alive)] {
+        if (alive.lock())
+            _finish_pass();
+    });
+}
+
+
+void Hiss::Defragmenter::_finish_pass()
+{
+    VkResult result = vmaEndDefragmentationPass(_allocator, _context, &_pass_info);
+
+    for (auto& move: _moves)
+    {
+        if (!move.resource)
+            continue;
+
+        move.resource->relocation_abort = nullptr;
+        if (move.resource->relocatable_kind == Relocatable::Kind::Buffer)
+            static_cast<Buffer*>(move.resource)->finish_relocation();
+        else
+            static_cast<Image2D*>(move.resource)->finish_relocation();
+        _moved_num++;
+    }
+    _moves.clear();
+    _pass_pending = false;
+
+    if (result == VK_SUCCESS)
+        _end();
+}
+
+
+void Hiss::Defragmenter::_abort_move(Relocatable* resource)
+{
+    // 资源已经销毁了新的 handle：VMA 在这一轮结束时释放原来的 allocation 以及新的位置
+    for (auto& move: _moves)
+    {
+        if (move.resource != resource)
+            continue;
+        _pass_info.pMoves[move.index].operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_DESTROY;
+        move.resource                            = nullptr;
+    }
+}
+
+
+void Hiss::Defragmenter::_end()
+{
+    VmaDefragmentationStats stats = {};
+    vmaEndDefragmentation(_allocator, _context, &stats);
+    _context = nullptr;
+
+    auto after = fragmentation();
+    spdlog::info("[defragmenter] done in {} passes: {} moves, {:.1f} MB moved, {} blocks freed ({:.1f} MB)",
+                 _pass_num, _moved_num, to_mb(stats.bytesMoved), stats.deviceMemoryBlocksFreed,
+                 to_mb(stats.bytesFreed));
+    spdlog::info("[defragmenter] fragmentation {:.2f} -> {:.2f}, blocks {} -> {}, {:.1f} -> {:.1f} MB",
+                 _before.ratio(), after.ratio(), _before.block_num, after.block_num, to_mb(_before.block_bytes),
+                 to_mb(after.block_bytes));
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <memory>
+#include "core/device.hpp"
+#include "relocatable.hpp"
+
+
+namespace Hiss
+{
+
+class Frame;
+
+
+/**
+ * 长时间运行时，反复创建、释放资源会在 VMA 的 block 中留下很多空洞；Defragmenter 将 allocation 移动到一起，释放空的 block
+ * @details 增量进行：每一帧最多移动 moves_per_frame 个 allocation 或者 bytes_per_frame 字节，避免某一帧卡顿太久
+ * @details 只移动 can_relocate() 的 Buffer 以及 Image2D（例如纹理缓存中的纹理），其他 allocation 保持不动
+ * @details 不会等待 GPU：拷贝录制在当前 frame 的 upload command buffer 中，随后立即替换 handle 并通知使用者，
+ *  旧的 handle 交给 deletion queue；VMA 的这一轮保持打开，直到之前提交的 frame 都不再使用旧的位置，
+ *  才在 deletion queue 的回调中结束这一轮，开始下一轮
+ * @details 每隔 check_interval 帧检查一次碎片率，超过 threshold 时自动开始；也可以调用 request 手动开始
+ */
+class Defragmenter
+{
+public:
+    struct Config
+    {
+        uint32_t       moves_per_frame = 8;
+        vk::DeviceSize bytes_per_frame = 16 * 1024 * 1024;
+        uint32_t       check_interval  = 600;    // 单位是帧，0 表示不自动检查
+        float          threshold       = 0.5f;
+        vk::DeviceSize min_free_bytes  = 32 * 1024 * 1024;    // 空闲的空间太少时，不值得整理
+    };
+
+
+    Defragmenter(Device& device, VmaAllocator allocator, const Config& config);
+    Defragmenter(Device& device, VmaAllocator allocator)
+        : Defragmenter(device, allocator, Config{})
+    {}
+    ~Defragmenter();
+
+
+    /**
+     * 所有 block 的空闲情况
+     */
+    struct Fragmentation
+    {
+        uint32_t       block_num    = 0;
+        vk::DeviceSize block_bytes  = 0;
+        vk::DeviceSize free_bytes   = 0;
+        vk::DeviceSize largest_free = 0;    // 最大的连续空闲区域
+
+        /**
+         * 碎片率：1 - largest_free / free_bytes，所有空闲空间连续时为 0
+         */
+        float ratio() const { return free_bytes == 0 ? 0.f : 1.f - (float) largest_free / (float) free_bytes; }
+    };
+
+    Fragmentation fragmentation() const;
+
+
+    /**
+     * 在下一次 step 时开始整理，不检查碎片率
+     */
+    void request() { _requested = true; }
+
+
+    /**
+     * 每一帧调用一次，需要在录制这一帧的命令之前调用：移动之后，descriptor set 会被重新分配
+     * @param frame 拷贝的命令录制在 frame 的 upload command buffer 中
+     */
+    void step(uint64_t frame_index, Frame& frame);
+
+
+    bool running() const { return _context != nullptr; }
+
+
+private:
+    // 这一轮中可以移动的 allocation
+    struct Move
+    {
+        Relocatable* resource;    // 在这一轮结束之前被销毁时为 nullptr
+        uint32_t     index;       // 在 VMA 的 move 列表中的索引
+    };
+
+
+    void _begin(const Fragmentation& fragmentation);
+    void _pass(Frame& frame);
+    void _finish_pass();
+    void _abort_move(Relocatable* resource);
+    void _end();
+
+
+    Device&      _device;
+    VmaAllocator _allocator;
+    Config       _config;
+
+    VmaDefragmentationContext _context   = nullptr;
+    bool                      _requested = false;
+
+    // 已经替换了 handle，等待之前提交的 frame 完成之后结束这一轮
+    bool                           _pass_pending = false;
+    VmaDefragmentationPassMoveInfo _pass_info    = {};
+    std::vector<Move>              _moves;
+
+    // deletion queue 中的回调的生命周期
+    std::shared_ptr<void> _alive = std::make_shared<int>(0);
+
+    // 用于输出本次整理的结果
+    Fragmentation _before;
+    uint32_t      _pass_num  = 0;
+    uint32_t      _moved_num = 0;
+};
+
+}    // namespace Hiss
@@ -2,6 +2,7 @@
 #include "utils/tools.hpp"
 #include "vk_config.hpp"
 #include "proj_config.hpp"
+#include <fmt/format.h>
 
 
 /**
@@ -18,14 +19,23 @@ VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
 void Hiss::Engine::resize()
 {
     _window->on_resize();
-    _swapchain     = Swapchain::resize(_swapchain, *_device, *_window, _surface);
-    _frame_manager = Hiss::FrameManager::on_resize(_frame_manager, *_device, *_swapchain);
+    _swapchain          = Swapchain::resize(_swapchain, *_device, *_window, _surface, _present_config);
+    _swapchain_outdated = false;
+    _frame_manager->on_resize(*_swapchain);
+
+    // swapchain 的 image 数量变多时，ring 的分段不够用，需要重新创建；pass 每一帧都会重新获取 descriptor set
+    if (_frame_manager->frames_number() > _uniform_ring->segment_num())
+    {
+        _device->deletion_queue().retire(std::unique_ptr<UniformRing>(_uniform_ring));
+        _uniform_ring = new UniformRing(*_device, allocator, descriptor_pool(), _frame_manager->frames_number());
+    }
 }
 
 
 void Hiss::Engine::prepare()
 {
-    _window = new Window(name(), WINDOW_WIDTH, WINDOW_HEIGHT);
+    _window     = new Window(name(), WINDOW_WIDTH, WINDOW_HEIGHT);
+    _job_system = new JobSystem(default_job_config);
 
     timer._value.start();
 
@@ -56,20 +66,31 @@ void Hiss::Engine::prepare()
 
     // 内存分配工具
     init_vma();
+    _memory_policy     = new MemoryPolicy(allocator);
+    _resource_registry = new ResourceRegistry(allocator);
+    _defragmenter      = new Defragmenter(*_device, allocator);
+    ResourceRegistry::OwnerScope owner_scope{"engine"};
 
 
     create_descriptor_pool();
 
 
     // 创建 swapchain
-    _swapchain = new Swapchain(*_device, *_window, _surface);
+    _swapchain = new Swapchain(*_device, *_window, _surface, _present_config);
+    _frame_limiter.set_fps(frame_rate_limit);
 
 
-    _frame_manager = new Hiss::FrameManager(*_device, *_swapchain);
+    _frame_manager = new Hiss::FrameManager(*_device, allocator, *_swapchain);
+    _uniform_ring  = new UniformRing(*_device, allocator, descriptor_pool(), _frame_manager->frames_number());
 
     _shader_loader = new ShaderLoader(*_device);
 
 
+    _texture_cache = new TextureCache(*_device, allocator, *_job_system, texture_cache_budget);
+
+    _geometry_arena = new GeometryArena(*_device, allocator);
+
+
     // 创建默认的纹理
     default_texture = std::make_unique<Hiss::Texture>(*_device, allocator, texture / "awesomeface.jpg",
                                                       vk::Format::eR8G8B8A8Srgb);
@@ -88,7 +109,13 @@ void Hiss::Engine::init_vma()
             .vkGetDeviceProcAddr   = &vkGetDeviceProcAddr,
     };
 
+    // 启用之后，VMA 会从驱动获取每个 heap 的 budget
+    VmaAllocatorCreateFlags flags = 0;
+    if (_device->is_extension_enabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+        flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+
     VmaAllocatorCreateInfo vma_allocator_info = {
+            .flags            = flags,
             .physicalDevice   = _physical_device->vkgpu(),
             .device           = device().vkdevice(),
             .pVulkanFunctions = &vulkan_funcs,
@@ -102,15 +129,25 @@ void Hiss::Engine::init_vma()
 
 void Hiss::Engine::clean()
 {
+    DELETE(_defragmenter);
+
     // 销毁默认的纹理
     default_texture.reset();
+    DELETE(_texture_cache);
+    DELETE(_geometry_arena);
 
     _device->vkdevice().destroy(material_layout);
 
     DELETE(_shader_loader);
+    DELETE(_uniform_ring);
     DELETE(_frame_manager);
     DELETE(_swapchain);
 
+    // 所有的资源都已经释放，最后销毁 pool；registry 会报告泄漏的资源
+    _device->deletion_queue().flush();
+    DELETE(_resource_registry);
+    DELETE(_memory_policy);
+
     // 销毁 vma 的分配器
     vmaDestroyAllocator(allocator);
 
@@ -122,19 +159,81 @@ void Hiss::Engine::clean()
     _instance->vkinstance().destroy(_debug_messenger);
     DELETE(_instance);
     DELETE(_window);
+
+    _job_system->log_stats();
+    DELETE(_job_system);
 }
 
 
 void Hiss::Engine::preupdate() noexcept
 {
     timer._value.tick();
+    _job_system->run_main_thread_jobs();
     _frame_manager->acquire_frame();
+    _uniform_ring->begin_frame(_frame_manager->current_frame().frame_id());
+
+    _resource_registry->update(_frame_counter++);
+    if (_window->consume_key(GLFW_KEY_F9))
+        dump_resources();
+    if (_window->consume_key(GLFW_KEY_F10))
+        defragment();
+
+    // 拷贝录制在当前 frame 的 upload command buffer 中，不会等待 GPU
+    _defragmenter->step(_frame_counter, _frame_manager->current_frame());
+
+    _sync_submit_mark = OneTimeCommand::sync_submit_count();
+    _barrier_mark     = BarrierBatch::stats();
+}
+
+
+void Hiss::Engine::dump_resources(const std::filesystem::path& path) const
+{
+    _resource_registry->dump(path.empty() ? std::filesystem::path(fmt::format("{}_memory_{}.txt", name(), _frame_counter))
+                                          : path);
 }
 
 
 void Hiss::Engine::postupdate() noexcept
 {
     _frame_manager->submit_frame();
+
+
+    /**
+     * 渲染循环中的 OneTimeCommand 会让 CPU 等待 GPU，应该改为 Frame::update_buffer
+     * 第一次出现时，以及之后每 256 帧最多报告一次
+     */
+    auto sync_submit_num = OneTimeCommand::sync_submit_count() - _sync_submit_mark;
+    if (sync_submit_num > 0)
+    {
+        if (_sync_submit_frames % 256 == 0)
+            spdlog::warn("[engine] {} synchronous submits in frame {} ({} frames so far)", sync_submit_num,
+                         _frame_counter, _sync_submit_frames + 1);
+        _sync_submit_frames++;
+    }
+
+
+    auto barriers   = BarrierBatch::stats();
+    _frame_barriers = BarrierBatch::Stats{
+            .barrier_num = barriers.barrier_num - _barrier_mark.barrier_num,
+            .call_num    = barriers.call_num - _barrier_mark.call_num,
+    };
+    if (_frame_counter % 600 == 0)
+        spdlog::debug("[engine] frame {}: {} barriers in {} pipeline barrier calls", _frame_counter,
+                      _frame_barriers.barrier_num, _frame_barriers.call_num);
+
+
+    // 启用 HISS_COUNT_ALLOCATIONS 时，每 600 帧报告一次这一帧的堆分配次数（从 poll_event 开始），需要放在最后
+    _frame_allocations = AllocCounter::count() - _alloc_mark;
+    if (AllocCounter::enabled() && _frame_counter % 600 == 0)
+        spdlog::info("[engine] frame {}: {} heap allocations", _frame_counter, _frame_allocations);
+
+    // 预热之后（pipeline，descriptor，各种 pool 都已经创建），稳定运行的帧不应该分配内存
+    if (AllocCounter::enabled() && _frame_counter > alloc_warmup_frames && _frame_allocations > 0)
+    {
+        spdlog::error("[engine] frame {}: {} heap allocations in a steady-state frame", _frame_counter,
+                      _frame_allocations);
+        assert(_frame_allocations == 0 && "heap allocations in a steady-state frame");
+    }
 }
 
 
@@ -156,7 +255,9 @@ Hiss::Image2D* Hiss::Engine::create_depth_attach(vk::SampleCountFlagBits sample)
 
 void Hiss::Engine::create_descriptor_pool()
 {
+    // 允许单独释放 descriptor set，参考 DeletionQueue::free
     descriptor_pool._value = vkdevice().createDescriptorPool(vk::DescriptorPoolCreateInfo{
+            .flags         = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
             .maxSets       = descriptor_set_max_number,
             .poolSizeCount = static_cast<uint32_t>(pool_size.size()),
             .pPoolSizes    = pool_size.data(),
@@ -185,6 +286,15 @@ void Hiss::Engine::color_attach_layout_trans_1(vk::CommandBuffer command_buffer,
 }
 
 
+void Hiss::Engine::color_attach_layout_trans_1(Hiss::BarrierBatch& barriers, Hiss::Image2D& image)
+{
+    image.transfer_layout(
+            barriers, {vk::PipelineStageFlagBits::eTopOfPipe, vk::AccessFlags()},
+            {vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::AccessFlagBits::eColorAttachmentWrite},
+            vk::ImageLayout::eColorAttachmentOptimal, true);
+}
+
+
 void Hiss::Engine::color_attach_layout_trans_2(vk::CommandBuffer command_buffer, Hiss::Image2D& image)
 {
     image.transfer_layout(
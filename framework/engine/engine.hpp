@@ -2,6 +2,8 @@
 #include <memory>
 #include "utils/shader_loader.hpp"
 #include "utils/timer.hpp"
+#include "utils/frame_limiter.hpp"
+#include "utils/alloc_counter.hpp"
 #include "core/device.hpp"
 #include "core/instance.hpp"
 #include "swapchain.hpp"
@@ -9,6 +11,12 @@
 #include "frame.hpp"
 #include "frame_manager.hpp"
 #include "texture.hpp"
+#include "texture_cache.hpp"
+#include "geometry_arena.hpp"
+#include "memory_policy.hpp"
+#include "resource_registry.hpp"
+#include "uniform_ring.hpp"
+#include "defragmenter.hpp"
 #include "utils/vk_func.hpp"
 
 
@@ -38,12 +46,55 @@ public:
     void preupdate() noexcept;
     void postupdate() noexcept;
     void clean();
-    void wait_idle() const { device().vkdevice().waitIdle(); }
-    void poll_event() { _window->poll_event(); }
+    void wait_idle() const
+    {
+        auto guard = queue().lock();
+        device().vkdevice().waitIdle();
+    }
+
+    // 在采样输入之前进行帧率限制，使得输入到显示的延迟最短
+    void poll_event()
+    {
+        _alloc_mark = AllocCounter::count();    // 一帧从这里开始，到 postupdate 结束
+        _frame_limiter.wait();
+        _window->poll_event();
+    }
 
     bool should_close() const { return _window->should_close(); }
 
-    bool should_resize() const { return _window->has_resized(); }
+    // 窗口大小变化，或者 latency mode 变化时，需要重新创建 swapchain
+    bool should_resize() const { return _window->has_resized() || _swapchain_outdated; }
+
+
+    /**
+     * 切换 latency mode，会在下一次 resize 时重新创建 swapchain
+     */
+    void set_latency_mode(LatencyMode mode)
+    {
+        if (_present_config.mode == mode)
+            return;
+        _present_config.mode = mode;
+        _swapchain_outdated  = true;
+    }
+
+
+    /**
+     * CPU 端的帧率上限，0 表示不限制
+     */
+    void set_frame_rate_limit(double fps) { _frame_limiter.set_fps(fps); }
+
+
+    /**
+     * 将所有存活的 buffer 以及 image 按大小写入文件，运行时按 F9 也会触发
+     * @param path 为空时使用 "<app name>_memory_<frame>.txt"
+     */
+    void dump_resources(const std::filesystem::path& path = {}) const;
+
+
+    /**
+     * 在接下来的若干帧中整理显存碎片，运行时按 F10 也会触发；碎片率过高时也会自动进行
+     */
+    void defragment() { _defragmenter->request(); }
 
 
 
@@ -58,6 +109,7 @@ public:
 
     // layout 转换为 colorAttachment，不保留之前的数据
     static void color_attach_layout_trans_1(vk::CommandBuffer command_buffer, Image2D& image);
+    static void color_attach_layout_trans_1(BarrierBatch& barriers, Image2D& image);
 
     // layout 转换为 present，保留之前的数据，最后一个 stage 是 color attachment
     static void color_attach_layout_trans_2(vk::CommandBuffer command_buffer, Image2D& image);
@@ -121,6 +173,36 @@ public:
 
     ShaderLoader& shader_loader() const { return *_shader_loader; }
 
+    // 以路径为 key 的纹理缓存，在多个模型、材质之间共享纹理
+    TextureCache& texture_cache() const { return *_texture_cache; }
+
+    // 所有 mesh 共享的顶点以及索引 buffer
+    GeometryArena& geometry_arena() const { return *_geometry_arena; }
+
+    // 决定 buffer 以及 image 的分配方式，包含若干 VMA pool
+    MemoryPolicy& memory_policy() const { return *_memory_policy; }
+
+    // 所有 pass 共享的每一帧的常量数据，通过 dynamic offset 绑定
+    UniformRing& uniform_ring() const { return *_uniform_ring; }
+
+    // 所有存活的 buffer 以及 image，以及每个 heap 的 budget
+    ResourceRegistry& resource_registry() const { return *_resource_registry; }
+
+    // 增量地移动 allocation，减少显存碎片
+    Defragmenter& defragmenter() const { return *_defragmenter; }
+
+    /**
+     * 上一帧中（poll_event 到 postupdate 结束）operator new 的调用次数，需要启用 HISS_COUNT_ALLOCATIONS
+     * @details 稳定运行时应该为 0，可以用于测试中的断言；超过 alloc_warmup_frames 之后不为 0 时，debug 模式下会断言
+     */
+    uint64_t frame_allocations() const { return _frame_allocations; }
+
+    // 上一帧中录制的 pipeline barrier 数量，以及 vkCmdPipelineBarrier(2) 的调用次数
+    const BarrierBatch::Stats& frame_barriers() const { return _frame_barriers; }
+
+    // 用于并行的 CPU 任务：模型导入，纹理解码，剔除等；Affinity::Main 的 job 在 preupdate 中执行
+    JobSystem& job_system() const { return *_job_system; }
+
 
     VmaAllocator                     allocator = {};
     Prop<vk::DescriptorPool, Engine> descriptor_pool{VK_NULL_HANDLE};
@@ -128,13 +210,37 @@ public:
 
 
 private:
-    Instance*     _instance        = nullptr;
-    GPU*          _physical_device = nullptr;
-    Swapchain*    _swapchain       = nullptr;
-    Window*       _window          = nullptr;
-    Device*       _device          = nullptr;
-    FrameManager* _frame_manager   = nullptr;
-    ShaderLoader* _shader_loader   = nullptr;
+    Instance*      _instance        = nullptr;
+    GPU*           _physical_device = nullptr;
+    Swapchain*     _swapchain       = nullptr;
+    Window*        _window          = nullptr;
+    JobSystem*     _job_system      = nullptr;
+    Device*        _device          = nullptr;
+    FrameManager*  _frame_manager   = nullptr;
+    ShaderLoader*  _shader_loader   = nullptr;
+    TextureCache*  _texture_cache   = nullptr;
+    GeometryArena* _geometry_arena  = nullptr;
+    MemoryPolicy*  _memory_policy   = nullptr;
+    UniformRing*   _uniform_ring    = nullptr;
+
+    ResourceRegistry* _resource_registry = nullptr;
+    Defragmenter*     _defragmenter      = nullptr;
+    uint64_t          _frame_counter     = 0;    // 已经开始的帧数，单调递增
+
+    PresentConfig _present_config     = default_present_config;
+    bool          _swapchain_outdated = false;    // present config 变化之后，需要重新创建 swapchain
+    FrameLimiter  _frame_limiter;
+
+    // 用于检查每一帧中 OneTimeCommand 的次数
+    uint64_t _sync_submit_mark   = 0;
+    uint64_t _sync_submit_frames = 0;    // 出现了同步提交的帧数
+
+    // 用于统计每一帧的堆分配次数，参考 AllocCounter
+    uint64_t _alloc_mark        = 0;
+    uint64_t _frame_allocations = 0;
+
+    BarrierBatch::Stats _barrier_mark;
+    BarrierBatch::Stats _frame_barriers;
 
     vk::SurfaceKHR             _surface         = VK_NULL_HANDLE;
     vk::DebugUtilsMessengerEXT _debug_messenger = VK_NULL_HANDLE;
@@ -1,4 +1,5 @@
 #pragma once
+#include <memory>
 #include <utility>
 #include <vector>
 #include "vk_config.hpp"
@@ -6,6 +7,7 @@
 #include "core/device.hpp"
 #include "swapchain.hpp"
 #include "utils/semaphore_pool.hpp"
+#include "utils/arena.hpp"
 
 namespace Hiss
 {
@@ -30,13 +32,13 @@ public:
 
 
     /**
-     * 仅在当前 frame 有效的 command buffer，在下一个周期到来时会被销毁掉
+     * 仅在当前 frame 有效的 command buffer，在下一个周期到来时会被回收
      */
     struct FrameCommandBuffer
     {
-        explicit FrameCommandBuffer(Frame& frame, const std::string& name = "",
-                                    std::vector<vk::Semaphore> signal_semaphores = {})
-            : signal_semaphores(std::move(signal_semaphores)),
+        explicit FrameCommandBuffer(Frame& frame, const char* name = "",
+                                    std::initializer_list<vk::Semaphore> signal_semaphores = {})
+            : signal_semaphores(signal_semaphores),
               frame(frame)
         {
             command_buffer = frame.acquire_command_buffer(name);
@@ -45,28 +47,39 @@ public:
 
         ~FrameCommandBuffer()
         {
+            // 在这之前记录的上传需要先执行
+            frame.flush_uploads();
+
             command_buffer.end();
-            frame._device.queue().submit_commands({}, {command_buffer}, signal_semaphores, frame.insert_fence());
+            frame._device.queue().submit_commands(
+                    {}, {command_buffer}, {(uint32_t) signal_semaphores.size(), signal_semaphores.data()},
+                    frame.insert_fence());
         }
 
         inline vk::CommandBuffer& operator()() { return command_buffer; }
 
-        vk::CommandBuffer          command_buffer;
-        std::vector<vk::Semaphore> signal_semaphores;
-        Frame&                     frame;
+        vk::CommandBuffer             command_buffer;
+        SmallVector<vk::Semaphore, 4> signal_semaphores;
+        Frame&                        frame;
     };
 
-    Frame(Device& device, uint32_t frame_index, Hiss::Image2D& image)
+    Frame(Device& device, VmaAllocator allocator, uint32_t frame_index, Hiss::Image2D& image)
         : frame_id(frame_index),
           submit_semaphore(device.create_semaphore(fmt::format("frame-{}", frame_index), false)),
           _device(device),
-          _image(image)
+          _allocator(allocator),
+          _image(&image)
     {}
 
     ~Frame()
     {
         _device.vkdevice().destroy(submit_semaphore._value);
 
+        // 调用者需要保证 command buffer 已经执行完成（例如先调用 wait_resource）
+        _free_command_buffers.insert(_free_command_buffers.end(), _command_buffers.begin(), _command_buffers.end());
+        if (!_free_command_buffers.empty())
+            _device.vkdevice().freeCommandBuffers(_device.command_pool().vkpool(), _free_command_buffers);
+
         // 归还 fence
         _device.fence_pool().revert(_fences);
     }
@@ -88,18 +101,91 @@ public:
 
     /**
      * 申请一个 command buffer，用于当前 frame。在下一个循环时，该 command buffer 变得不可用
+     * @details 优先复用这个 frame 之前申请过的 command buffer，begin 时会隐式地 reset
      */
-    vk::CommandBuffer acquire_command_buffer(const std::string& name)
+    vk::CommandBuffer acquire_command_buffer(const char* name)
     {
-        auto command_buffer = _device.create_commnad_buffer(name);
+        vk::CommandBuffer command_buffer;
+        if (_free_command_buffers.empty())
+            command_buffer = _device.command_pool().command_buffer_create(1).front();
+        else
+        {
+            command_buffer = _free_command_buffers.back();
+            _free_command_buffers.pop_back();
+        }
+        _device.set_debug_name(vk::ObjectType::eCommandBuffer, (VkCommandBuffer) command_buffer, name);
+
         _command_buffers.push_back(command_buffer);
         return command_buffer;
     }
 
 
+    /**
+     * 只在当前 frame 有效的临时内存，frame 下一次开始时（wait_resource）回收
+     * @details 用于每一帧都会构造的临时数组，例如 ArenaVector，避免每一帧都在堆上分配
+     */
+    LinearArena& arena() { return _arena; }
+
+
+    /**
+     * 更新 buffer 的内容，记录到当前 frame 的 upload command buffer 中，不会等待 GPU
+     * @details 不超过 64 KB 时使用 vkCmdUpdateBuffer，否则通过 stage buffer 拷贝；
+     *  stage buffer 在这个 frame 下一次开始时释放
+     * @details 会插入两个 barrier：等待 dst 之前对 buffer 的读取；拷贝完成之后，对 dst 可见
+     * @details upload command buffer 会在下一次 submit_command 或者 FrameCommandBuffer 提交之前提交
+     * @param dst 之后使用这个 buffer 的 stage 以及 access，buffer 需要支持 transfer dst
+     * @param offset 需要是 4 的倍数，size 也需要是 4 的倍数
+     */
+    void update_buffer(Buffer& buffer, const void* data, vk::DeviceSize size, const StageAccess& dst,
+                       vk::DeviceSize offset = 0)
+    {
+        assert(offset % 4 == 0 && size % 4 == 0);
+        assert(offset + size <= buffer.size());
+
+        const StageAccess transfer_write = {vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite};
+
+        auto command_buffer = _upload_command();
+        buffer.memory_barrier(command_buffer, {dst.stage}, transfer_write);
+
+        if (size <= UPDATE_BUFFER_MAX_SIZE)
+            command_buffer.updateBuffer(buffer.vkbuffer(), offset, size, data);
+        else
+        {
+            auto stage_buffer = std::make_unique<StageBuffer>(_device, _allocator, size, "frame upload stage");
+            stage_buffer->mem_copy(data, size);
+            command_buffer.copyBuffer(stage_buffer->vkbuffer(), buffer.vkbuffer(),
+                                      {vk::BufferCopy{.dstOffset = offset, .size = size}});
+            _stage_buffers.push_back(std::move(stage_buffer));
+        }
+
+        buffer.memory_barrier(command_buffer, transfer_write, dst);
+    }
+
+
+    /**
+     * 当前 frame 的 upload command buffer，在这一帧的其他命令之前提交，不会等待 GPU
+     * @details 例如 Defragmenter 在这里录制移动资源的拷贝
+     */
+    vk::CommandBuffer upload_command() { return _upload_command(); }
+
+
+    /**
+     * 提交 update_buffer 记录的命令，没有记录任何命令时什么都不做
+     */
+    void flush_uploads()
+    {
+        if (!_upload_command_buffer)
+            return;
+
+        _upload_command_buffer.end();
+        _device.queue().submit_commands({}, {_upload_command_buffer}, {}, insert_fence());
+        _upload_command_buffer = VK_NULL_HANDLE;
+    }
+
+
     /**
      * 等待所有的 fence，并清空 fence 列表。并且将 fence 归还给 pool
-     * 销毁当前 frame 分配的临时 command buffer
+     * 回收当前 frame 分配的临时 command buffer，以及临时内存
      */
     void wait_resource()
     {
@@ -110,11 +196,11 @@ public:
             _fences.clear();
         }
 
-        if (!_command_buffers.empty())
-        {
-            _device.vkdevice().freeCommandBuffers(_device.command_pool().vkpool(), _command_buffers);
-            _command_buffers.clear();
-        }
+        _free_command_buffers.insert(_free_command_buffers.end(), _command_buffers.begin(), _command_buffers.end());
+        _command_buffers.clear();
+
+        _stage_buffers.clear();
+        _arena.reset();
     }
 
 
@@ -124,6 +210,7 @@ public:
      */
     void submit_command(const vk::CommandBuffer& command_buffer)
     {
+        flush_uploads();
         _device.queue().submit_commands({}, {command_buffer}, {}, insert_fence());
     }
 
@@ -133,7 +220,7 @@ public:
     // id 和 swapchain image index 是等同的
     Prop<uint32_t, Frame> frame_id;
 
-    Hiss::Image2D& image() const { return _image; }
+    Hiss::Image2D& image() const { return *_image; }
 
 
     /**
@@ -145,16 +232,41 @@ public:
 
     // 私有成员============================================================================================
 private:
-    Device& _device;
+    // vkCmdUpdateBuffer 的上限
+    static constexpr vk::DeviceSize UPDATE_BUFFER_MAX_SIZE = 65536;
+
 
-    Hiss::Image2D& _image;
+    vk::CommandBuffer _upload_command()
+    {
+        if (!_upload_command_buffer)
+        {
+            _upload_command_buffer = acquire_command_buffer("frame upload");
+            _upload_command_buffer.begin(vk::CommandBufferBeginInfo{
+                    .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+            });
+        }
+        return _upload_command_buffer;
+    }
+
+
+    Device&      _device;
+    VmaAllocator _allocator;
+
+    Hiss::Image2D* _image;    // swapchain 重新创建之后，会绑定到新的 image
 
 
     // 用于保护和当前 frame 关联的数据
     std::vector<vk::Fence> _fences = {};
 
-    // 当前 frame 申请的所有临时 command buffer
-    std::vector<vk::CommandBuffer> _command_buffers = {};
+    // 当前 frame 申请的所有临时 command buffer，以及之前的周期中使用过、可以复用的 command buffer
+    std::vector<vk::CommandBuffer> _command_buffers      = {};
+    std::vector<vk::CommandBuffer> _free_command_buffers = {};
+
+    LinearArena _arena;
+
+    // update_buffer 使用的 command buffer，以及 stage buffer
+    vk::CommandBuffer                         _upload_command_buffer = VK_NULL_HANDLE;
+    std::vector<std::unique_ptr<StageBuffer>> _stage_buffers;
     // ====================================================================================================
 };
 
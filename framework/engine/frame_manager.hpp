@@ -5,6 +5,7 @@
 #include "core/device.hpp"
 #include "swapchain.hpp"
 #include "utils/semaphore_pool.hpp"
+#include "utils/ring_queue.hpp"
 #include "frame.hpp"
 
 
@@ -24,15 +25,17 @@ namespace Hiss
 class FrameManager
 {
 public:
-    FrameManager(Device& device, Swapchain& swapchain)
+    FrameManager(Device& device, VmaAllocator allocator, Swapchain& swapchain)
         : frames_number(swapchain.image_number()),
           _device(device),
-          _swapchain(swapchain)
+          _allocator(allocator),
+          _swapchain(&swapchain),
+          _submitted_frames(swapchain.image_number())
     {
         // 创建 frame
         this->_frames.resize(frames_number._value);
         for (int id = 0; id < frames_number._value; ++id)
-            this->_frames[id] = new Frame(_device, id, *_swapchain.get_image(id));
+            this->_frames[id] = new Frame(_device, allocator, id, *_swapchain->get_image(id));
     }
 
     ~FrameManager()
@@ -45,6 +48,8 @@ public:
     // 获取 frame，用于渲染，会等待 fence
     void acquire_frame()
     {
+        _limit_present_queue();
+
         /**
          * 向 swapchain 获取 image，并等待 image 可用
          * @details swapchain 可能正在读取 image（presentation engine 的时间周期：读取 image，显示 image），
@@ -52,7 +57,7 @@ public:
          *  留给 CPU 录制 command 和 GPU 渲染的时间有：presentation engine 显示当前 image 的时间；presentation 读取并显示下一个 image 的时间
          */
         auto swapchain_acquire_fence = _device.fence_pool().acquire();
-        auto swapchain_image_index   = _swapchain.acquire_image(VK_NULL_HANDLE, swapchain_acquire_fence);
+        auto swapchain_image_index   = _swapchain->acquire_image(VK_NULL_HANDLE, swapchain_acquire_fence);
         (void) _device.vkdevice().waitForFences(swapchain_acquire_fence, VK_TRUE, UINT64_MAX);
         _device.fence_pool().revert(swapchain_acquire_fence);
 
@@ -68,19 +73,53 @@ public:
     {
         assert(_current_frame != nullptr);
 
+        _current_frame->flush_uploads();
+
+        _swapchain->submit_image(_current_frame->frame_id(), _current_frame->submit_semaphore());
+
+        // 这一帧中交给 deletion queue 的资源在之后的 fence signal 时销毁
+        _device.deletion_queue().end_frame();
+        _device.deletion_queue().collect();
 
-        _swapchain.submit_image(_current_frame->frame_id(), _current_frame->submit_semaphore());
+        if (_submitted_frames.full())
+            _submitted_frames.pop_front();
+        _submitted_frames.push_back(_current_frame);
 
         // 提交之后，current frame 就是无效的了
         _current_frame = nullptr;
     }
 
 
-    // 窗口 resize 时调用
-    static FrameManager* on_resize(FrameManager* old, Device& device, Swapchain& swapchain)
+    /**
+     * 窗口 resize 时调用：保留已有的 frame（command buffer，semaphore，fence），只是绑定到新的 swapchain image
+     * @details 仍在渲染的 frame 由各自的 fence 保护，下一次使用这个 frame 时（wait_resource）才会等待
+     * @details image 的数量变少时，多余的 frame 交给 deletion queue；变多时创建新的 frame
+     */
+    void on_resize(Swapchain& swapchain)
     {
-        DELETE(old);
-        return new FrameManager(device, swapchain);
+        assert(_current_frame == nullptr);
+        _swapchain = &swapchain;
+
+        uint32_t new_number = swapchain.image_number();
+        _submitted_frames.reset(new_number);    // 只在 resize 时分配
+        for (uint32_t id = new_number; id < _frames.size(); ++id)
+            _device.deletion_queue().push([frame = _frames[id]] {
+                frame->wait_resource();
+                delete frame;
+            });
+        _frames.resize(new_number, nullptr);
+
+        for (uint32_t id = 0; id < new_number; ++id)
+        {
+            if (_frames[id])
+                _frames[id]->_image = swapchain.get_image(id);
+            else
+                _frames[id] = new Frame(_device, _allocator, id, *swapchain.get_image(id));
+        }
+
+        if (new_number != frames_number._value)
+            spdlog::info("[frame manager] frame number: {} -> {}", frames_number._value, new_number);
+        frames_number._value = new_number;
     }
 
 
@@ -113,8 +152,28 @@ public:
 
     // 私有成员============================================================================================
 private:
-    Device&    _device;
-    Swapchain& _swapchain;
+    /**
+     * FifoLowLatency：限制已经提交但还没有显示的帧数，减少输入到显示的延迟
+     * @details 支持 present wait 时，等待 presentation engine 显示之前的帧；
+     *  否则退而求其次，等待更早提交的 frame 在 GPU 上执行完成
+     */
+    void _limit_present_queue()
+    {
+        auto& config = _swapchain->config();
+        if (config.mode != LatencyMode::FifoLowLatency || _swapchain->wait_present_queue())
+            return;
+
+        while (_submitted_frames.size() > config.queue_depth)
+        {
+            _submitted_frames.front()->wait_resource();
+            _submitted_frames.pop_front();
+        }
+    }
+
+
+    Device&      _device;
+    VmaAllocator _allocator;
+    Swapchain*   _swapchain;    // resize 之后指向新的 swapchain
 
 
     // swapchain 中管理的所有 frame
@@ -124,6 +183,9 @@ private:
     // 当前用于渲染的 frame
     Frame* _current_frame = nullptr;
 
+    // 按照提交顺序排列的 frame，用于 FifoLowLatency；容量为 frame 的数量，每一帧进出都不会分配内存
+    RingQueue<Frame*> _submitted_frames;
+
     // ====================================================================================================
 };
 
@@ -0,0 +1,318 @@
+#include "engine/geometry_arena.hpp"
+#include "engine/vertex_buffer.hpp"
+
+#include <algorithm>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+
+Hiss::GeometryRange& Hiss::GeometryRange::operator=(GeometryRange&& other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        _arena      = std::exchange(other._arena, nullptr);
+        _page       = std::exchange(other._page, nullptr);
+        _allocation = std::exchange(other._allocation, VK_NULL_HANDLE);
+        _first      = std::exchange(other._first, 0);
+        _count      = std::exchange(other._count, 0);
+    }
+    return *this;
+}
+
+
+void Hiss::GeometryRange::reset()
+{
+    if (!_arena)
+        return;
+    _arena->_free(static_cast<GeometryArena::Page*>(_page), _allocation);
+    _arena      = nullptr;
+    _page       = nullptr;
+    _allocation = VK_NULL_HANDLE;
+    _first      = 0;
+    _count      = 0;
+}
+
+
+VkBuffer Hiss::GeometryRange::vkbuffer() const
+{
+    return _page ? static_cast<GeometryArena::Page*>(_page)->buffer->vkbuffer() : VK_NULL_HANDLE;
+}
+
+
+Hiss::GeometryArena::GeometryArena(Device& device, VmaAllocator allocator, vk::DeviceSize vertex_page_size,
+                                   vk::DeviceSize index_page_size)
+    : _device(device),
+      _allocator(allocator),
+      _vertex_page_size(vertex_page_size),
+      _index_page_size(index_page_size)
+{}
+
+
+Hiss::GeometryArena::~GeometryArena()
+{
+    // 还没有真正释放的 range 引用了 page，需要在 page 销毁之前执行完
+    if (_pending_free_num > 0)
+        _device.deletion_queue().flush();
+
+    for (auto& [key, pages]: _pages)
+    {
+        for (auto& page: pages)
+        {
+            if (page->allocation_num > 0)
+                spdlog::warn("[geometry arena] page destroyed with {} live allocations", page->allocation_num);
+
+            // 仍然存在的 allocation 会导致 VMA 报错，这里统一释放
+            vmaClearVirtualBlock(page->block);
+            vmaDestroyVirtualBlock(page->block);
+            _device.deletion_queue().retire(std::move(page->buffer));    // 之前提交的 frame 可能仍然在使用
+        }
+    }
+}
+
+
+Hiss::GeometryRange Hiss::GeometryArena::upload_vertices(const void* data, uint32_t vertex_num, uint32_t stride)
+{
+    auto range = _allocate(vertex_num, stride, true);
+    static_cast<Page*>(range._page)->buffer->upload(data, (vk::DeviceSize) vertex_num * stride,
+                                                     (vk::DeviceSize) range._first * stride);
+    return range;
+}
+
+
+Hiss::GeometryRange Hiss::GeometryArena::upload_indices(const void* data, uint32_t index_num, vk::IndexType index_type)
+{
+    uint32_t index_size = index_type == vk::IndexType::eUint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    auto range = _allocate(index_num, index_size, false);
+    static_cast<Page*>(range._page)->buffer->upload(data, (vk::DeviceSize) index_num * index_size,
+                                                     (vk::DeviceSize) range._first * index_size);
+    return range;
+}
+
+
+Hiss::GeometryRange Hiss::GeometryArena::upload_indices(const uint32_t* indices, uint32_t index_num,
+                                                        vk::IndexType& index_type)
+{
+    index_type = IndexBuffer2::choose_index_type(indices, index_num);
+    if (index_type == vk::IndexType::eUint32)
+        return upload_indices(static_cast<const void*>(indices), index_num, index_type);
+
+    std::vector<uint16_t> indices_16(indices, indices + index_num);
+    return upload_indices(static_cast<const void*>(indices_16.data()), index_num, index_type);
+}
+
+
+Hiss::GeometryRange Hiss::GeometryArena::_allocate(uint32_t element_num, uint32_t element_size, bool is_vertex)
+{
+    assert(element_num > 0);
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    VmaVirtualAllocationCreateInfo alloc_info = {.size = element_num};
+    VmaVirtualAllocation           allocation = VK_NULL_HANDLE;
+    VkDeviceSize                   offset     = 0;
+
+
+    // 依次尝试已有的 page，都放不下时创建新的 page
+    Page* target = nullptr;
+    for (auto& page: _pages[{is_vertex, element_size}])
+    {
+        if (vmaVirtualAllocate(page->block, &alloc_info, &allocation, &offset) == VK_SUCCESS)
+        {
+            target = page.get();
+            break;
+        }
+    }
+    if (!target)
+    {
+        target = _create_page(element_num, element_size, is_vertex);
+        if (vmaVirtualAllocate(target->block, &alloc_info, &allocation, &offset) != VK_SUCCESS)
+            throw std::runtime_error("[geometry arena] fail to allocate from a new page");
+    }
+    target->allocation_num++;
+
+
+    GeometryRange range;
+    range._arena      = this;
+    range._page       = target;
+    range._allocation = allocation;
+    range._first      = (uint32_t) offset;
+    range._count      = element_num;
+    return range;
+}
+
+
+void Hiss::GeometryArena::_free(Page* page, VmaVirtualAllocation allocation)
+{
+    // 之前提交的 frame 可能仍然在读取这段数据，立即释放的话，下一次上传会覆盖掉正在使用的几何信息
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _pending_free_num++;
+    }
+    _device.deletion_queue().push([this, page, allocation] { _release(page, allocation); });
+}
+
+
+void Hiss::GeometryArena::_release(Page* page, VmaVirtualAllocation allocation)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _pending_free_num--;
+    vmaVirtualFree(page->block, allocation);
+    page->allocation_num--;
+
+
+    // 释放空的 page，但是每种元素至少保留一个 page，避免反复创建
+    auto& pages = _pages[{page->is_vertex, page->element_size}];
+    if (page->allocation_num == 0 && pages.size() > 1)
+    {
+        // virtual block 只是 CPU 端的记录，可以立即销毁；之前提交的 frame 可能仍然在使用 buffer
+        vmaDestroyVirtualBlock(page->block);
+        _device.deletion_queue().retire(std::move(page->buffer));
+        pages.erase(std::find_if(pages.begin(), pages.end(), [page](auto& p) { return p.get() == page; }));
+    }
+}
+
+
+Hiss::GeometryArena::Page* Hiss::GeometryArena::_create_page(uint32_t element_num, uint32_t element_size,
+                                                             bool is_vertex)
+{
+    // page 的大小至少能够容纳这次分配
+    vk::DeviceSize page_size = is_vertex ? _vertex_page_size : _index_page_size;
+    auto           capacity  = (uint32_t) std::max<vk::DeviceSize>(page_size / element_size, element_num);
+
+    auto page          = std::make_unique<Page>();
+    page->element_size = element_size;
+    page->capacity     = capacity;
+    page->is_vertex    = is_vertex;
+    auto& pages        = _pages[{is_vertex, element_size}];
+
+    // transfer src 用于之后整理碎片时的拷贝
+    ResourceRegistry::OwnerScope owner_scope{"geometry arena"};
+    page->buffer = std::make_unique<Buffer>(
+            _device, _allocator, (vk::DeviceSize) capacity * element_size,
+            (is_vertex ? vk::BufferUsageFlagBits::eVertexBuffer : vk::BufferUsageFlagBits::eIndexBuffer)
+                    | vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc,
+            Buffer::DIRECT_UPLOAD_FLAGS,
+            fmt::format("geometry arena {} page {}-{}", is_vertex ? "vertex" : "index", element_size, pages.size()));
+
+    VmaVirtualBlockCreateInfo block_info = {.size = capacity};
+    vmaCreateVirtualBlock(&block_info, &page->block);
+
+    spdlog::info("[geometry arena] new {} page: element size {}, {:.1f} MB, {} upload",
+                 is_vertex ? "vertex" : "index", element_size, (double) page->buffer->size() / 1024.0 / 1024.0,
+                 page->buffer->host_visible() ? "direct" : "staged");
+
+    pages.push_back(std::move(page));
+    return pages.back().get();
+}
+
+
+Hiss::GeometryArena::Stats Hiss::GeometryArena::stats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    Stats stats;
+    for (auto& [key, pages]: _pages)
+    {
+        for (auto& page: pages)
+        {
+            VmaStatistics block_stats;
+            vmaGetVirtualBlockStatistics(page->block, &block_stats);
+
+            stats.page_num++;
+            stats.allocation_num += block_stats.allocationCount;
+            stats.bytes_reserved += page->buffer->size();
+            stats.bytes_allocated += block_stats.allocationBytes * page->element_size;
+        }
+    }
+    return stats;
+}
+
+
+void Hiss::GeometryArena::log_stats() const
+{
+    auto s = stats();
+    spdlog::info("[geometry arena] pages: {}, allocations: {}, used: {:.1f} / {:.1f} MB", s.page_num,
+                 s.allocation_num, (double) s.bytes_allocated / 1024.0 / 1024.0,
+                 (double) s.bytes_reserved / 1024.0 / 1024.0);
+}
+
+
+Hiss::GeometryRange Hiss::GeometryArena::UploadBatch::vertices(const void* data, uint32_t vertex_num, uint32_t stride)
+{
+    auto range = _arena._allocate(vertex_num, stride, true);
+    _write(range, data, stride);
+    return range;
+}
+
+
+Hiss::GeometryRange Hiss::GeometryArena::UploadBatch::indices(const uint32_t* indices, uint32_t index_num,
+                                                              vk::IndexType& index_type)
+{
+    index_type      = IndexBuffer2::choose_index_type(indices, index_num);
+    const void* src = indices;
+    if (index_type == vk::IndexType::eUint16)
+        src = _indices_16.emplace_back(indices, indices + index_num).data();
+
+    uint32_t index_size = index_type == vk::IndexType::eUint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    auto     range      = _arena._allocate(index_num, index_size, false);
+    _write(range, src, index_size);
+    return range;
+}
+
+
+void Hiss::GeometryArena::UploadBatch::_write(const GeometryRange& range, const void* data, uint32_t element_size)
+{
+    auto*          buffer = &_page_buffer(range);
+    vk::DeviceSize size   = (vk::DeviceSize) range.count() * element_size;
+    vk::DeviceSize offset = (vk::DeviceSize) range.first() * element_size;
+
+    // host visible 时直接写入，不需要等待
+    if (buffer->host_visible())
+    {
+        buffer->upload(data, size, offset);
+        return;
+    }
+
+    _copies.push_back(Copy{.data = data, .size = size, .dst = buffer, .dst_offset = offset});
+    _staged_bytes += size;
+}
+
+
+void Hiss::GeometryArena::UploadBatch::submit()
+{
+    if (_copies.empty())
+        return;
+
+    // 同一个 page 的拷贝合并为一个 copyBuffer
+    std::stable_sort(_copies.begin(), _copies.end(), [](const Copy& a, const Copy& b) { return a.dst < b.dst; });
+
+    StageBuffer    stage_buffer(_arena._device, _arena._allocator, _staged_bytes, "geometry-upload-batch");
+    OneTimeCommand command{_arena._device, _arena._device.command_pool()};
+
+    std::vector<vk::BufferCopy> regions;
+    vk::DeviceSize              stage_offset = 0;
+    for (size_t i = 0; i < _copies.size(); ++i)
+    {
+        auto& copy = _copies[i];
+        stage_buffer.mem_copy(copy.data, copy.size, stage_offset);
+        regions.push_back(vk::BufferCopy{.srcOffset = stage_offset, .dstOffset = copy.dst_offset, .size = copy.size});
+        stage_offset += copy.size;
+
+        if (i + 1 == _copies.size() || _copies[i + 1].dst != copy.dst)
+        {
+            command().copyBuffer(stage_buffer.vkbuffer(), copy.dst->vkbuffer(), regions);
+            regions.clear();
+        }
+    }
+    command.exec();
+
+    Buffer::record_staged_upload(_staged_bytes);
+    spdlog::info("[geometry arena] batch upload: {} copies, {:.1f} MB in one submit", _copies.size(),
+                 (double) _staged_bytes / 1024.0 / 1024.0);
+
+    _copies.clear();
+    _indices_16.clear();
+    _staged_bytes = 0;
+}
@@ -0,0 +1,232 @@
+#pragma once
+#include <cassert>
+#include <map>
+#include <mutex>
+#include <memory>
+
+#include "engine/buffer.hpp"
+
+
+namespace Hiss
+{
+
+class GeometryArena;
+
+
+/**
+ * 在 GeometryArena 中分配的一段连续的顶点或者索引，析构时自动释放
+ * @details first 和 count 的单位是元素（顶点或者索引），可以直接作为 vertexOffset 以及 firstIndex
+ */
+class GeometryRange
+{
+public:
+    GeometryRange() = default;
+    ~GeometryRange() { reset(); }
+
+    GeometryRange(GeometryRange&& other) noexcept { *this = std::move(other); }
+    GeometryRange& operator=(GeometryRange&& other) noexcept;
+
+    GeometryRange(const GeometryRange&)            = delete;
+    GeometryRange& operator=(const GeometryRange&) = delete;
+
+
+    // 归还给 arena
+    void reset();
+
+    bool     valid() const { return _arena != nullptr; }
+    VkBuffer vkbuffer() const;
+    uint32_t first() const { return _first; }
+    uint32_t count() const { return _count; }
+
+
+private:
+    friend class GeometryArena;
+
+    GeometryArena*       _arena      = nullptr;
+    void*                _page       = nullptr;    // GeometryArena::Page
+    VmaVirtualAllocation _allocation = VK_NULL_HANDLE;
+    uint32_t             _first      = 0;
+    uint32_t             _count      = 0;
+};
+
+
+/**
+ * 所有 mesh 共享的顶点以及索引 buffer，避免每个 mesh 都创建 dedicated 的 buffer
+ * @details 每种元素大小（顶点的 stride，或者索引的大小）对应一组 page，每个 page 是一个大的 buffer
+ * @details page 内部通过 VMA 的 virtual block（TLSF 算法）进行分配，以元素为单位，因此 offset 一定是 stride 的整数倍
+ * @details 同一个 page 中的 mesh 可以共享一次 bind，使用 firstIndex 以及 vertexOffset 进行绘制
+ * @details 线程安全；page 是 host visible 时直接写入，否则使用 stage buffer 以及阻塞的 one time command
+ * @details 释放的 range 通过 deletion queue 延迟归还，等到之前提交的 frame 都完成之后才会被再次分配
+ */
+class GeometryArena
+{
+public:
+    /**
+     * @param vertex_page_size 每个顶点 page 的默认大小，单位是 byte
+     * @param index_page_size 每个索引 page 的默认大小，单位是 byte
+     */
+    GeometryArena(Device& device, VmaAllocator allocator, vk::DeviceSize vertex_page_size = 64 * 1024 * 1024,
+                  vk::DeviceSize index_page_size = 16 * 1024 * 1024);
+    ~GeometryArena();
+
+
+    /**
+     * 分配 vertex_num 个顶点的空间，并将数据上传到 GPU
+     * @param stride 每个顶点的大小，单位是 byte
+     */
+    GeometryRange upload_vertices(const void* data, uint32_t vertex_num, uint32_t stride);
+
+
+    /**
+     * 分配 index_num 个索引的空间，并将数据上传到 GPU
+     * @param data 元素的类型需要与 index_type 一致
+     */
+    GeometryRange upload_indices(const void* data, uint32_t index_num, vk::IndexType index_type);
+
+
+    /**
+     * 上传 uint32 的索引，所有的索引都小于 65535 时，转换为 uint16 存储
+     * @param[out] index_type 实际使用的索引类型，绑定时需要使用
+     */
+    GeometryRange upload_indices(const uint32_t* indices, uint32_t index_num, vk::IndexType& index_type);
+
+
+    class UploadBatch;
+
+
+    struct Stats
+    {
+        uint32_t       page_num        = 0;
+        uint32_t       allocation_num  = 0;
+        vk::DeviceSize bytes_reserved  = 0;    // 所有 page 的大小
+        vk::DeviceSize bytes_allocated = 0;    // 实际被使用的大小
+    };
+
+    Stats stats() const;
+    void  log_stats() const;
+
+
+private:
+    friend class GeometryRange;
+
+    struct Page
+    {
+        std::unique_ptr<Buffer> buffer;
+        VmaVirtualBlock         block          = VK_NULL_HANDLE;
+        uint32_t                element_size   = 0;
+        uint32_t                capacity       = 0;    // 单位是元素
+        bool                    is_vertex      = true;
+        uint32_t                allocation_num = 0;
+    };
+
+    GeometryRange _allocate(uint32_t element_num, uint32_t element_size, bool is_vertex);
+    void          _free(Page* page, VmaVirtualAllocation allocation);       // 交给 deletion queue，延迟释放
+    void          _release(Page* page, VmaVirtualAllocation allocation);    // 真正归还给 virtual block
+    Page*         _create_page(uint32_t element_num, uint32_t element_size, bool is_vertex);
+
+    static Buffer& _page_buffer(const GeometryRange& range) { return *static_cast<Page*>(range._page)->buffer; }
+
+
+private:
+    Device&        _device;
+    VmaAllocator   _allocator;
+    vk::DeviceSize _vertex_page_size;
+    vk::DeviceSize _index_page_size;
+
+    mutable std::mutex _mutex;
+    uint32_t           _pending_free_num = 0;    // 已经交给 deletion queue，还没有释放的 range
+
+    // key 为 (是否为顶点，元素的大小)
+    std::map<std::pair<bool, uint32_t>, std::vector<std::unique_ptr<Page>>> _pages;
+};
+
+
+/**
+ * 批量上传多个 mesh：立即分配空间，host visible 的 page 直接写入；
+ *  其他 page 的数据在 submit 时写入同一个 stage buffer，通过一次 one time command 全部拷贝
+ * @details 逐个 upload 时，每次 staged 的上传都会阻塞地等待 GPU，加载大量 mesh 时这是主要的开销
+ * @details data 需要在 submit 之前保持有效，返回的 range 在 submit 之后才能用于绘制
+ * @details 不是线程安全的，在同一个线程上添加并 submit
+ * @example
+ * \n - GeometryArena::UploadBatch batch{arena};
+ * \n - auto vertices = batch.vertices(data, vertex_num, stride); ...
+ * \n - batch.submit();
+ */
+class GeometryArena::UploadBatch
+{
+public:
+    explicit UploadBatch(GeometryArena& arena)
+        : _arena(arena)
+    {}
+
+    // 没有 submit 的数据会被丢弃，debug 模式下会断言
+    ~UploadBatch() { assert(_copies.empty() && "upload batch destroyed without submit"); }
+
+    UploadBatch(const UploadBatch&)            = delete;
+    UploadBatch& operator=(const UploadBatch&) = delete;
+
+
+    GeometryRange vertices(const void* data, uint32_t vertex_num, uint32_t stride);
+
+
+    /**
+     * 所有的索引都小于 65535 时，转换为 uint16 存储，参考 GeometryArena::upload_indices
+     * @param[out] index_type 实际使用的索引类型
+     */
+    GeometryRange indices(const uint32_t* indices, uint32_t index_num, vk::IndexType& index_type);
+
+
+    /**
+     * 拷贝所有 staged 的数据，并等待完成
+     */
+    void submit();
+
+
+private:
+    // 需要通过 stage buffer 拷贝的一段数据
+    struct Copy
+    {
+        const void*    data;
+        vk::DeviceSize size;
+        Buffer*        dst;
+        vk::DeviceSize dst_offset;
+    };
+
+    void _write(const GeometryRange& range, const void* data, uint32_t element_size);
+
+
+    GeometryArena&                     _arena;
+    std::vector<Copy>                  _copies;
+    vk::DeviceSize                     _staged_bytes = 0;
+    std::vector<std::vector<uint16_t>> _indices_16;    // 转换为 uint16 的索引，需要保留到 submit
+};
+
+
+/**
+ * 记录 command buffer 当前绑定的 vertex buffer 以及 index buffer
+ * @details 相邻的 mesh 位于同一个 page 时，跳过重复的绑定。每次录制 command buffer 时使用新的对象
+ */
+struct GeometryBinding
+{
+    VkBuffer      vertex_buffer = VK_NULL_HANDLE;
+    VkBuffer      index_buffer  = VK_NULL_HANDLE;
+    vk::IndexType index_type    = vk::IndexType::eUint32;
+
+    void bind(vk::CommandBuffer command_buffer, const GeometryRange& vertices, const GeometryRange& indices,
+              vk::IndexType type)
+    {
+        if (vertices.vkbuffer() != vertex_buffer)
+        {
+            vertex_buffer = vertices.vkbuffer();
+            command_buffer.bindVertexBuffers(0, {vertex_buffer}, {0});
+        }
+        if (indices.vkbuffer() != index_buffer || type != index_type)
+        {
+            index_buffer = indices.vkbuffer();
+            index_type   = type;
+            command_buffer.bindIndexBuffer(index_buffer, 0, index_type);
+        }
+    }
+};
+
+}    // namespace Hiss
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cmath>
 #include <fmt/format.h>
 #include "image.hpp"
 
@@ -13,9 +15,9 @@ void Hiss::Image2D::copy_buffer_to_image(vk::Buffer buffer)
             .imageSubresource = vk::ImageSubresourceLayers{.aspectMask     = aspect._value,
                                                            .mipLevel       = 0,
                                                            .baseArrayLayer = 0,
-                                                           .layerCount     = 1},
+                                                           .layerCount     = array_layers._value},
             .imageOffset      = {0, 0, 0},
-            .imageExtent      = {extent._value.width, extent._value.height, 1},
+            .imageExtent      = level_extent(0),
     };
 
 
@@ -25,6 +27,55 @@ void Hiss::Image2D::copy_buffer_to_image(vk::Buffer buffer)
 }
 
 
+void Hiss::Image2D::copy_buffer_to_image(vk::Buffer buffer, const std::vector<vk::DeviceSize>& level_offsets)
+{
+    assert(level_offsets.size() <= mip_levels._value);
+
+    std::vector<vk::BufferImageCopy> copy_infos;
+    copy_infos.reserve(level_offsets.size());
+    for (uint32_t level = 0; level < level_offsets.size(); ++level)
+    {
+        copy_infos.push_back(vk::BufferImageCopy{
+                .bufferOffset      = level_offsets[level],
+                .bufferRowLength   = 0,
+                .bufferImageHeight = 0,
+                .imageSubresource  = vk::ImageSubresourceLayers{.aspectMask     = aspect._value,
+                                                                .mipLevel       = level,
+                                                                .baseArrayLayer = 0,
+                                                                .layerCount     = array_layers._value},
+                .imageOffset       = {0, 0, 0},
+                .imageExtent       = level_extent(level),
+        });
+    }
+
+
+    Hiss::OneTimeCommand command(_device, _device.command_pool());
+    command().copyBufferToImage(buffer, vkimage._value, vk::ImageLayout::eTransferDstOptimal, copy_infos);
+    command.exec();
+}
+
+
+void Hiss::Image2D::copy_buffer_to_subresource(vk::CommandBuffer command_buffer, vk::Buffer buffer,
+                                               vk::DeviceSize buffer_offset, uint32_t level, uint32_t base_layer,
+                                               uint32_t layer_count) const
+{
+    assert(level < mip_levels._value && base_layer + layer_count <= array_layers._value);
+
+    command_buffer.copyBufferToImage(buffer, vkimage._value, vk::ImageLayout::eTransferDstOptimal,
+                                     vk::BufferImageCopy{
+                                             .bufferOffset      = buffer_offset,
+                                             .bufferRowLength   = 0,
+                                             .bufferImageHeight = 0,
+                                             .imageSubresource  = {.aspectMask     = aspect._value,
+                                                                   .mipLevel       = level,
+                                                                   .baseArrayLayer = base_layer,
+                                                                   .layerCount     = layer_count},
+                                             .imageOffset       = {0, 0, 0},
+                                             .imageExtent       = level_extent(level),
+                                     });
+}
+
+
 /**
  * 注：
  *  - 确保所有 level 的 layout 都是 transfer_dst
@@ -36,105 +87,138 @@ void Hiss::Image2D::copy_buffer_to_image(vk::Buffer buffer)
  *      |_ layout transition(level#i): tranfer_src -> shader_read_only
  *  - layout transition(level#n): transfer_dst -> shader_read_only
  */
-//bool Hiss::Image::mipmap_generate(vk::ImageAspectFlags aspect)
-//{
-//    assert(_mip_levels > 0);
-//    if (_mip_levels == 1)
-//        return true;
-//
-//    if (!_device.gpu().is_support_linear_filter(_format))
-//        return false;
-//
-//
-//    Hiss::OneTimeCommand   command(_device, _device.command_pool());
-//    vk::ImageMemoryBarrier barrier = {
-//            .image            = _image,
-//            .subresourceRange = {.aspectMask = aspect, .levelCount = 1, .baseArrayLayer = 0, .layerCount = 1}};
-//
-//
-//    for (struct {
-//             int32_t  mip_width;
-//             int32_t  mip_height;
-//             uint32_t level;
-//         } _{(int32_t) _extent.width, (int32_t) _extent.height, 0};
-//         _.level < _mip_levels - 1; ++_.level)
-//    {
-//        /* layout transition(level#i): transfer_dst -> transfer_src */
-//        barrier.subresourceRange.baseMipLevel = _.level;
-//        barrier.oldLayout                     = vk::ImageLayout::eTransferDstOptimal;
-//        barrier.newLayout                     = vk::ImageLayout::eTransferSrcOptimal;
-//        barrier.srcAccessMask                 = vk::AccessFlagBits::eTransferWrite;
-//        barrier.dstAccessMask                 = vk::AccessFlagBits::eTransferRead;
-//        command().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, {},
-//                                  {}, {barrier});
-//
-//
-//        /**
-//         * blit: level#i -> level#i+1
-//         * dst 的 layout 只允许 3 种，这里 transfer_dst 最好
-//         */
-//        auto src_offset = std::array<vk::Offset3D, 2>{
-//                vk::Offset3D{0, 0, 0},
-//                vk::Offset3D{_.mip_width, _.mip_height, 1},
-//        };
-//        auto dst_offset = std::array<vk::Offset3D, 2>{
-//                vk::Offset3D{0, 0, 0},
-//                vk::Offset3D{std::max(1, _.mip_width / 2), std::max(1, _.mip_height / 2), 1},
-//        };
-//        vk::ImageBlit blit = {
-//                .srcSubresource = {.aspectMask = aspect, .mipLevel = _.level, .baseArrayLayer = 0, .layerCount = 1},
-//                .srcOffsets     = src_offset,
-//                .dstSubresource = {.aspectMask = aspect, .mipLevel = _.level + 1, .baseArrayLayer = 0, .layerCount = 1},
-//                .dstOffsets     = dst_offset,
-//        };
-//        command().blitImage(_image, vk::ImageLayout::eTransferSrcOptimal, _image, vk::ImageLayout::eTransferDstOptimal,
-//                            {blit}, vk::Filter::eLinear);
-//
-//
-//        /* layout transition(level#i): transfer_src -> shader_readonly */
-//        barrier.oldLayout     = vk::ImageLayout::eTransferSrcOptimal;
-//        barrier.newLayout     = vk::ImageLayout::eShaderReadOnlyOptimal;
-//        barrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
-//        barrier.dstAccessMask = {};    // 这这是个 execution barrier
-//        command().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {},
-//                                  {}, {}, {barrier});
-//
-//
-//        _.mip_width  = _.mip_width > 1 ? _.mip_width / 2 : _.mip_width;
-//        _.mip_height = _.mip_height > 1 ? _.mip_height / 2 : _.mip_height;
-//    }
-//
-//
-//    /* layout transition(level#n): transfer_dst -> shader_readonly */
-//    barrier.subresourceRange.baseMipLevel = _mip_levels - 1;
-//    barrier.oldLayout                     = vk::ImageLayout::eTransferDstOptimal;
-//    barrier.newLayout                     = vk::ImageLayout::eShaderReadOnlyOptimal;
-//    barrier.srcAccessMask                 = vk::AccessFlagBits::eTransferWrite;
-//    barrier.dstAccessMask                 = {};    // execution barrier
-//    command().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {}, {},
-//                              {}, {barrier});
-//
-//
-//    command.exec();
-//    return true;
-//}
+bool Hiss::Image2D::generate_mipmap()
+{
+    assert(mip_levels._value > 0);
+    if (!_device.gpu().is_support_linear_blit(format._value))
+        return false;
+
+
+    Hiss::OneTimeCommand   command(_device, _device.command_pool());
+    vk::ImageMemoryBarrier barrier = {
+            .image            = vkimage._value,
+            .subresourceRange = subresource_range(0, 1),
+    };
+
+
+    for (struct {
+             int32_t  mip_width;
+             int32_t  mip_height;
+             int32_t  mip_depth;
+             uint32_t level;
+         } _{(int32_t) extent._value.width, (int32_t) extent._value.height, (int32_t) depth._value, 0};
+         _.level < mip_levels._value - 1; ++_.level)
+    {
+        /* layout transition(level#i): transfer_dst -> transfer_src */
+        barrier.subresourceRange.baseMipLevel = _.level;
+        barrier.oldLayout                     = vk::ImageLayout::eTransferDstOptimal;
+        barrier.newLayout                     = vk::ImageLayout::eTransferSrcOptimal;
+        barrier.srcAccessMask                 = vk::AccessFlagBits::eTransferWrite;
+        barrier.dstAccessMask                 = vk::AccessFlagBits::eTransferRead;
+        command().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, {},
+                                  {}, {barrier});
+
+
+        /**
+         * blit: level#i -> level#i+1
+         * dst 的 layout 只允许 3 种，这里 transfer_dst 最好
+         */
+        auto src_offset = std::array<vk::Offset3D, 2>{
+                vk::Offset3D{0, 0, 0},
+                vk::Offset3D{_.mip_width, _.mip_height, _.mip_depth},
+        };
+        auto dst_offset = std::array<vk::Offset3D, 2>{
+                vk::Offset3D{0, 0, 0},
+                vk::Offset3D{std::max(1, _.mip_width / 2), std::max(1, _.mip_height / 2),
+                             std::max(1, _.mip_depth / 2)},
+        };
+        vk::ImageBlit blit = {
+                .srcSubresource = {.aspectMask     = aspect._value,
+                                   .mipLevel       = _.level,
+                                   .baseArrayLayer = 0,
+                                   .layerCount     = array_layers._value},
+                .srcOffsets     = src_offset,
+                .dstSubresource = {.aspectMask     = aspect._value,
+                                   .mipLevel       = _.level + 1,
+                                   .baseArrayLayer = 0,
+                                   .layerCount     = array_layers._value},
+                .dstOffsets     = dst_offset,
+        };
+        command().blitImage(vkimage._value, vk::ImageLayout::eTransferSrcOptimal, vkimage._value,
+                            vk::ImageLayout::eTransferDstOptimal, {blit}, vk::Filter::eLinear);
+
+
+        /* layout transition(level#i): transfer_src -> shader_readonly */
+        barrier.oldLayout     = vk::ImageLayout::eTransferSrcOptimal;
+        barrier.newLayout     = vk::ImageLayout::eShaderReadOnlyOptimal;
+        barrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
+        barrier.dstAccessMask = {};    // 这这是个 execution barrier
+        command().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {},
+                                  {}, {}, {barrier});
+
+
+        _.mip_width  = _.mip_width > 1 ? _.mip_width / 2 : _.mip_width;
+        _.mip_height = _.mip_height > 1 ? _.mip_height / 2 : _.mip_height;
+        _.mip_depth  = _.mip_depth > 1 ? _.mip_depth / 2 : _.mip_depth;
+    }
+
+
+    /* layout transition(level#n): transfer_dst -> shader_readonly */
+    barrier.subresourceRange.baseMipLevel = mip_levels._value - 1;
+    barrier.oldLayout                     = vk::ImageLayout::eTransferDstOptimal;
+    barrier.newLayout                     = vk::ImageLayout::eShaderReadOnlyOptimal;
+    barrier.srcAccessMask                 = vk::AccessFlagBits::eTransferWrite;
+    barrier.dstAccessMask                 = {};    // execution barrier
+    command().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {}, {},
+                              {}, {barrier});
+
+
+    command.exec();
+    _layout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    return true;
+}
+
+
+uint32_t Hiss::Image2D::max_mip_levels(vk::Extent3D extent)
+{
+    uint32_t max_dim = std::max({extent.width, extent.height, extent.depth, 1u});
+    return static_cast<uint32_t>(std::floor(std::log2(max_dim))) + 1;
+}
 
 
 Hiss::Image2D::Image2D(VmaAllocator allocator, Hiss::Device& device, const Hiss::Image2DCreateInfo& info)
-    : name(info.name),
+    : Relocatable(Kind::Image),
+      name(info.name),
       format(info.format),
       extent(info.extent),
       aspect(info.aspect),
+      mip_levels(info.mip_levels),
+      array_layers(info.array_layers),
+      depth(info.type == vk::ImageType::e3D ? info.depth : 1),
+      type(info.type),
       _device(device),
       _allocator(allocator),
       _layout(vk::ImageLayout::eUndefined)
 {
-    VkImageCreateInfo image_info = vk::ImageCreateInfo{
-            .imageType     = vk::ImageType::e2D,
+    assert(info.type != vk::ImageType::e3D || info.array_layers == 1);
+    assert(info.mip_levels <= max_mip_levels({info.extent.width, info.extent.height, depth._value}));
+    assert(!info.cube || (info.array_layers % 6 == 0 && info.extent.width == info.extent.height));
+
+    // 默认 view 的类型
+    if (info.type == vk::ImageType::e3D)
+        view_type = vk::ImageViewType::e3D;
+    else if (info.cube)
+        view_type = info.array_layers == 6 ? vk::ImageViewType::eCube : vk::ImageViewType::eCubeArray;
+    else
+        view_type = info.array_layers > 1 ? vk::ImageViewType::e2DArray : vk::ImageViewType::e2D;
+
+    _image_info = vk::ImageCreateInfo{
+            .flags         = info.cube ? vk::ImageCreateFlagBits::eCubeCompatible : vk::ImageCreateFlags{},
+            .imageType     = info.type,
             .format        = info.format,
-            .extent        = {.width = info.extent.width, .height = info.extent.height, .depth = 1},
-            .mipLevels     = 1,
-            .arrayLayers   = 1,
+            .extent        = {.width = info.extent.width, .height = info.extent.height, .depth = depth._value},
+            .mipLevels     = info.mip_levels,
+            .arrayLayers   = info.array_layers,
             .samples       = info.samples,
             .tiling        = info.tiling,
             .usage         = info.usage,
@@ -142,15 +226,18 @@ Hiss::Image2D::Image2D(VmaAllocator allocator, Hiss::Device& device, const Hiss:
             .initialLayout = vk::ImageLayout::eUndefined,    // 这里只能是 undefined
     };
 
-    VmaAllocationCreateInfo alloc_create_info = {
-            .flags    = info.memory_flags,
-            .usage    = VMA_MEMORY_USAGE_AUTO,
-            .priority = 1.f,
-    };
-
-    vmaCreateImage(allocator, &image_info, &alloc_create_info, &vkimage._value, &_allocation, &_alloc_info);
+    // render target 使用 dedicated memory，其他的 image 从共享的 block 中分配，参考 MemoryPolicy
+    MemoryPolicy::create_image(allocator, _image_info, info.memory_flags, &vkimage._value, &_allocation, &_alloc_info);
+    vmaSetAllocationUserData(allocator, _allocation, static_cast<Relocatable*>(this));
     if (!info.name.empty())
         _device.set_debug_name(vk::ObjectType::eImage, vkimage._value, info.name);
+    ResourceRegistry::add(allocator, vkimage._value,
+                          {
+                                  .name     = info.name,
+                                  .category = ResourceRegistry::image_category(info.usage),
+                                  .usage    = vk::to_string(info.usage),
+                          },
+                          _alloc_info);
 
 
     // 进行 layout 转换
@@ -164,7 +251,8 @@ Hiss::Image2D::Image2D(VmaAllocator allocator, Hiss::Device& device, const Hiss:
 
 Hiss::Image2D::Image2D(Hiss::Device& device, vk::Image image, const std::string& name, vk::ImageAspectFlags aspect,
                        vk::ImageLayout layout, vk::Format format, vk::Extent2D extent)
-    : vkimage(image),
+    : Relocatable(Kind::Image),
+      vkimage(image),
       name(name),
       format(format),
       extent(extent),
@@ -181,8 +269,17 @@ Hiss::Image2D::Image2D(Hiss::Device& device, vk::Image image, const std::string&
 Hiss::Image2D::~Image2D()
 {
     if (!is_proxy)
-        vmaDestroyImage(_allocator, vkimage._value, _allocation);
+    {
+        ResourceRegistry::remove(_allocator, vkimage._value);
+
+        // Defragmenter 还没有结束这一轮移动：allocation 由 VMA 释放
+        if (_abort_relocation())
+            _device.vkdevice().destroy(vkimage._value);
+        else
+            vmaDestroyImage(_allocator, vkimage._value, _allocation);
+    }
     _device.vkdevice().destroy(view._value.vkview);
+    _destroy_cached_views();
 }
 
 
@@ -193,11 +290,7 @@ void Hiss::Image2D::transfer_layout_im(vk::ImageLayout new_layout)
             .oldLayout        = _layout,
             .newLayout        = new_layout,
             .image            = vkimage._value,
-            .subresourceRange = {.aspectMask     = aspect._value,
-                                 .baseMipLevel   = 0,
-                                 .levelCount     = 1,
-                                 .baseArrayLayer = 0,
-                                 .layerCount     = 1},
+            .subresourceRange = subresource_range(),
     };
 
     OneTimeCommand command_buffer{_device, _device.command_pool()};
@@ -213,31 +306,26 @@ void Hiss::Image2D::transfer_layout_im(vk::ImageLayout new_layout)
 
 void Hiss::Image2D::execution_barrier(vk::CommandBuffer command_buffer, const StageAccess& src, const StageAccess& dst)
 {
-    command_buffer.pipelineBarrier(src.stage, dst.stage, {}, {}, {},
-                                   {vk::ImageMemoryBarrier{
-                                           .srcAccessMask    = src.access,
-                                           .dstAccessMask    = dst.access,
-                                           .oldLayout        = _layout,
-                                           .newLayout        = _layout,
-                                           .image            = vkimage._value,
-                                           .subresourceRange = view().range,
-                                   }});
+    BarrierBatch barriers{_device};
+    barriers.image(vkimage._value, view().range, src, dst, _layout, _layout);
+    barriers.flush(command_buffer);
 }
 
 
 void Hiss::Image2D::transfer_layout(vk::CommandBuffer command_buffer, const StageAccess& src, const StageAccess& dst,
                                     vk::ImageLayout new_layout, bool clear)
 {
-    command_buffer.pipelineBarrier(
-            src.stage, dst.stage, {}, {}, {},
-            {
-                    vk::ImageMemoryBarrier{.srcAccessMask    = src.access,
-                                           .dstAccessMask    = dst.access,
-                                           .oldLayout        = clear ? vk::ImageLayout::eUndefined : _layout,
-                                           .newLayout        = new_layout,
-                                           .image            = vkimage._value,
-                                           .subresourceRange = view().range},
-            });
+    BarrierBatch barriers{_device};
+    transfer_layout(barriers, src, dst, new_layout, clear);
+    barriers.flush(command_buffer);
+}
+
+
+void Hiss::Image2D::transfer_layout(BarrierBatch& barriers, const StageAccess& src, const StageAccess& dst,
+                                    vk::ImageLayout new_layout, bool clear)
+{
+    barriers.image(vkimage._value, view().range, src, dst, clear ? vk::ImageLayout::eUndefined : _layout,
+                   new_layout);
 
     // 更新 layout 数据
     _layout = new_layout;
@@ -246,39 +334,192 @@ void Hiss::Image2D::transfer_layout(vk::CommandBuffer command_buffer, const Stag
 
 void Hiss::Image2D::_create_view()
 {
-    vk::ImageSubresourceRange range = {
-            .aspectMask     = aspect._value,
-            .baseMipLevel   = 0,
-            .levelCount     = 1,
-            .baseArrayLayer = 0,
-            .layerCount     = 1,
-    };
+    view._value.range  = subresource_range();
+    view._value.vkview = _create_view(view._value.range, view_type._value, fmt::format("{}_view", name._value));
+}
+
 
+vk::ImageView Hiss::Image2D::_create_view(const vk::ImageSubresourceRange& range, vk::ImageViewType view_type,
+                                          const std::string& debug_name)
+{
     vk::ImageView vkview = _device.vkdevice().createImageView(vk::ImageViewCreateInfo{
             .image            = vkimage._value,
-            .viewType         = vk::ImageViewType::e2D,
+            .viewType         = view_type,
             .format           = format._value,
             .subresourceRange = range,
     });
 
     if (!name._value.empty())
-        _device.set_debug_name(vk::ObjectType::eImageView, (VkImageView) vkview, fmt::format("{}_view", name._value));
+        _device.set_debug_name(vk::ObjectType::eImageView, (VkImageView) vkview, debug_name);
+
+    return vkview;
+}
 
-    view._value.vkview = vkview;
-    view._value.range  = range;
+
+void Hiss::Image2D::_destroy_cached_views()
+{
+    for (auto& cached: _cached_views)
+        _device.vkdevice().destroy(cached.vkview);
+    _cached_views.clear();
+}
+
+
+vk::ImageView Hiss::Image2D::subresource_view(const vk::ImageSubresourceRange& range, vk::ImageViewType view_type)
+{
+    assert(range.baseMipLevel + range.levelCount <= mip_levels._value);
+    assert(range.baseArrayLayer + range.layerCount <= array_layers._value);
+
+    for (auto& cached: _cached_views)
+        if (cached.type == view_type && cached.range == range)
+            return cached.vkview;
+
+    auto vkview = _create_view(range, view_type,
+                               fmt::format("{}_view_level{}_layer{}", name._value, range.baseMipLevel,
+                                           range.baseArrayLayer));
+    _cached_views.push_back(CachedView{.type = view_type, .range = range, .vkview = vkview});
+    return vkview;
+}
+
+
+vk::ImageView Hiss::Image2D::level_view(uint32_t level)
+{
+    assert(level < mip_levels._value);
+    return subresource_view(subresource_range(level, 1), view_type._value);
+}
+
+
+vk::ImageView Hiss::Image2D::layer_view(uint32_t layer, uint32_t level)
+{
+    assert(type._value == vk::ImageType::e2D);
+    return subresource_view(subresource_range(level, 1, layer, 1), vk::ImageViewType::e2D);
+}
+
+
+vk::ImageSubresourceRange Hiss::Image2D::subresource_range(uint32_t base_level, uint32_t level_count,
+                                                           uint32_t base_layer, uint32_t layer_count) const
+{
+    return vk::ImageSubresourceRange{
+            .aspectMask     = aspect._value,
+            .baseMipLevel   = base_level,
+            .levelCount     = level_count == VK_REMAINING_MIP_LEVELS ? mip_levels._value - base_level : level_count,
+            .baseArrayLayer = base_layer,
+            .layerCount = layer_count == VK_REMAINING_ARRAY_LAYERS ? array_layers._value - base_layer : layer_count,
+    };
+}
+
+
+vk::Extent3D Hiss::Image2D::level_extent(uint32_t level) const
+{
+    return vk::Extent3D{
+            .width  = std::max(1u, extent._value.width >> level),
+            .height = std::max(1u, extent._value.height >> level),
+            .depth  = std::max(1u, depth._value >> level),
+    };
 }
 
 
 void Hiss::Image2D::memory_barrier(const StageAccess& src, const StageAccess& dst, vk::ImageLayout old_layout,
                                    vk::ImageLayout new_layout, vk::CommandBuffer command_buffer)
 {
-    command_buffer.pipelineBarrier(src.stage, dst.stage, {}, {}, {},
-                                   {
-                                           vk::ImageMemoryBarrier{.srcAccessMask    = src.access,
-                                                                  .dstAccessMask    = dst.access,
-                                                                  .oldLayout        = old_layout,
-                                                                  .newLayout        = new_layout,
-                                                                  .image            = vkimage._value,
-                                                                  .subresourceRange = view().range},
-                                   });
+    BarrierBatch barriers{_device};
+    memory_barrier(barriers, src, dst, old_layout, new_layout);
+    barriers.flush(command_buffer);
+}
+
+
+void Hiss::Image2D::memory_barrier(BarrierBatch& barriers, const StageAccess& src, const StageAccess& dst,
+                                   vk::ImageLayout old_layout, vk::ImageLayout new_layout) const
+{
+    barriers.image(vkimage._value, view().range, src, dst, old_layout, new_layout);
+}
+
+
+void Hiss::Image2D::memory_barrier(BarrierBatch& barriers, const vk::ImageSubresourceRange& range,
+                                   const StageAccess& src, const StageAccess& dst, vk::ImageLayout old_layout,
+                                   vk::ImageLayout new_layout) const
+{
+    barriers.image(vkimage._value, range, src, dst, old_layout, new_layout);
+}
+
+
+bool Hiss::Image2D::can_relocate() const
+{
+    auto transfer = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst;
+    return movable && !is_proxy && _layout == vk::ImageLayout::eShaderReadOnlyOptimal
+        && (_image_info.usage & transfer) == transfer;
+}
+
+
+void Hiss::Image2D::begin_relocation(VmaAllocation dst_allocation, vk::CommandBuffer command_buffer)
+{
+    assert(can_relocate() && !_relocation_image);
+
+    _relocation_image = _device.vkdevice().createImage(_image_info);
+    vmaBindImageMemory(_allocator, dst_allocation, _relocation_image);
+
+
+    // 旧 image：shader read only -> transfer src；新 image：undefined -> transfer dst
+    auto         range = subresource_range();
+    BarrierBatch barriers{_device};
+    barriers.image(vkimage._value, range, {vk::PipelineStageFlagBits::eAllCommands, {}},
+                   {vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferRead}, _layout,
+                   vk::ImageLayout::eTransferSrcOptimal);
+    barriers.image(_relocation_image, range, {vk::PipelineStageFlagBits::eAllCommands, {}},
+                   {vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite},
+                   vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
+    barriers.flush(command_buffer);
+
+
+    std::vector<vk::ImageCopy> regions;
+    regions.reserve(mip_levels._value);
+    for (uint32_t level = 0; level < mip_levels._value; ++level)
+    {
+        vk::ImageSubresourceLayers layers = {.aspectMask     = aspect._value,
+                                             .mipLevel       = level,
+                                             .baseArrayLayer = 0,
+                                             .layerCount     = array_layers._value};
+        regions.push_back(vk::ImageCopy{
+                .srcSubresource = layers,
+                .dstSubresource = layers,
+                .extent         = level_extent(level),
+        });
+    }
+    command_buffer.copyImage(vkimage._value, vk::ImageLayout::eTransferSrcOptimal, _relocation_image,
+                             vk::ImageLayout::eTransferDstOptimal, regions);
+
+
+    // 新 image：transfer dst -> shader read only
+    barriers.image(_relocation_image, range, {vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite},
+                   {vk::PipelineStageFlagBits::eAllCommands, vk::AccessFlagBits::eShaderRead},
+                   vk::ImageLayout::eTransferDstOptimal, _layout);
+    barriers.flush(command_buffer);
+}
+
+
+void Hiss::Image2D::end_relocation()
+{
+    std::swap(vkimage._value, _relocation_image);
+    ResourceRegistry::relocate(_allocator, _relocation_image, vkimage._value, _alloc_info);
+
+    // 之前提交的 frame 可能仍然在使用旧的 image 以及 view；其他的 view 在下一次使用时创建
+    auto& deletion_queue = _device.deletion_queue();
+    deletion_queue.destroy(vk::Image(_relocation_image));
+    deletion_queue.destroy(view._value.vkview);
+    for (auto& cached: _cached_views)
+        deletion_queue.destroy(cached.vkview);
+    _cached_views.clear();
+    _relocation_image = VK_NULL_HANDLE;
+
+    if (!name._value.empty())
+        _device.set_debug_name(vk::ObjectType::eImage, vkimage._value, name._value);
+    _create_view();
+
+    _notify_relocated();
+}
+
+
+void Hiss::Image2D::finish_relocation()
+{
+    vmaGetAllocationInfo(_allocator, _allocation, &_alloc_info);
+    ResourceRegistry::relocate(_allocator, vkimage._value, vkimage._value, _alloc_info);
 }
@@ -13,21 +13,30 @@ namespace Hiss
 struct Image2DCreateInfo
 {
     std::string              name;
+    vk::ImageType            type         = vk::ImageType::e2D;    // e3D 时使用 depth，不能有多个 layer
     vk::Format               format       = {};
     vk::Extent2D             extent       = {};
+    uint32_t                 depth        = 1;    // 只用于 3D image
     vk::ImageUsageFlags      usage        = {};
     vk::ImageTiling          tiling       = vk::ImageTiling::eOptimal;
     vk::SampleCountFlagBits  samples      = vk::SampleCountFlagBits::e1;
-    VmaAllocationCreateFlags memory_flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+    uint32_t                 mip_levels   = 1;    // mipmap 的级数，完整的级数可以通过 Image2D::max_mip_levels 计算
+    uint32_t                 array_layers = 1;    // cube 为 true 时需要是 6 的倍数
+    bool                     cube         = false;
+    VmaAllocationCreateFlags memory_flags = 0;    // 只是建议，最终由 MemoryPolicy 决定
     vk::ImageAspectFlags     aspect;
     vk::ImageLayout          init_layout = vk::ImageLayout::eUndefined;
 };
 
 
 /**
- * 不支持 mipmap
+ * 支持 mipmap，array layer，cube map 以及 3D image
+ * @details 默认的 view 包含所有的 level 和 layer，类型由 image 决定：2D，2D array，cube，cube array 或者 3D
+ * @details 只包含部分 level 或者 layer 的 view 在第一次使用时创建并缓存，例如 depth pyramid 的每一级，
+ *  shadow cascade 的每一层，cube map 的每一个面
+ * @details layout 的记录以整个 image 为单位；只转换部分 subresource 时，需要调用者自己记录 layout
  */
-class Image2D
+class Image2D : public Relocatable
 {
 public:
     struct View
@@ -55,12 +64,44 @@ public:
 
 
     /**
-     * 将 buffer 的内容拷贝到当前 image 中
-     * @param buffer buffer 的所有内容都拷贝到 image 中
+     * 将 buffer 的内容拷贝到当前 image 的 level 0 中，需要 image 的 layout 为 transfer dst
+     * @param buffer buffer 的所有内容都拷贝到 image 中，多个 layer 的数据在 buffer 中依次紧密排列
      */
     void copy_buffer_to_image(vk::Buffer buffer);
 
 
+    /**
+     * 将 buffer 的内容拷贝到 image 的多个 level 中，需要 image 的 layout 为 transfer dst
+     * @param level_offsets 第 i 个 level 的数据在 buffer 中的 offset，同一个 level 的多个 layer 依次紧密排列
+     */
+    void copy_buffer_to_image(vk::Buffer buffer, const std::vector<vk::DeviceSize>& level_offsets);
+
+
+    /**
+     * 向 command buffer 中录制拷贝：将 buffer 中紧密排列的数据拷贝到某个 level 的若干个 layer 中
+     * @details 需要这些 subresource 的 layout 为 transfer dst
+     */
+    void copy_buffer_to_subresource(vk::CommandBuffer command_buffer, vk::Buffer buffer, vk::DeviceSize buffer_offset,
+                                    uint32_t level, uint32_t base_layer = 0, uint32_t layer_count = 1) const;
+
+
+    /**
+     * 使用 blit 逐级生成 mipmap，需要 format 支持 linear filter 的 blit
+     * @details 调用前所有 level 的 layout 都需要是 transfer dst，level 0 已经写入了数据
+     * @details 完成之后所有 level 的 layout 都是 shader read only；所有 layer 同时生成，3D image 的深度也会减半
+     * @return format 不支持 linear blit 时返回 false，不会做任何事情
+     */
+    bool generate_mipmap();
+
+
+    /**
+     * 某个尺寸的 image 完整的 mipmap 级数：floor(log2(max(width, height, depth))) + 1
+     * @details 3D image 的深度也会逐级减半，只有深度最大时级数由深度决定
+     */
+    static uint32_t max_mip_levels(vk::Extent3D extent);
+    static uint32_t max_mip_levels(vk::Extent2D extent) { return max_mip_levels({extent.width, extent.height, 1}); }
+
+
     /**
      * 创建作为 depth attachment 的 image
      * 初始 layout 为 eDepthStencilAttachmentOptimal
@@ -106,6 +147,10 @@ public:
     void transfer_layout(vk::CommandBuffer command_buffer, const StageAccess& src, const StageAccess& dst,
                          vk::ImageLayout new_layout, bool clear = false);
 
+    // 加入 batch，和其他的 barrier 一起提交；layout 的记录会立即更新
+    void transfer_layout(BarrierBatch& barriers, const StageAccess& src, const StageAccess& dst,
+                         vk::ImageLayout new_layout, bool clear = false);
+
 
     /**
      * 在当前 class 中记录 layout 是非常不可靠的。
@@ -115,13 +160,84 @@ public:
     void memory_barrier(const StageAccess& src, const StageAccess& dst, vk::ImageLayout old_layout,
                         vk::ImageLayout new_layout, vk::CommandBuffer command_buffer);
 
+    void memory_barrier(BarrierBatch& barriers, const StageAccess& src, const StageAccess& dst,
+                        vk::ImageLayout old_layout, vk::ImageLayout new_layout) const;
+
+    // 只作用于部分 subresource，例如 depth pyramid 中相邻的两级，参考 subresource_range
+    void memory_barrier(BarrierBatch& barriers, const vk::ImageSubresourceRange& range, const StageAccess& src,
+                        const StageAccess& dst, vk::ImageLayout old_layout, vk::ImageLayout new_layout) const;
+
     // ====================================================================================================
 
 
+public:
+    /**
+     * 只包含某一个 mip level 的 view（包含所有的 layer），在第一次使用时创建
+     */
+    vk::ImageView level_view(uint32_t level);
+
+
+    /**
+     * 只包含某一个 layer 的某一个 level 的 2D view，在第一次使用时创建
+     * @details 例如渲染到 shadow cascade 的某一层，或者 cube map 的某一个面
+     */
+    vk::ImageView layer_view(uint32_t layer, uint32_t level = 0);
+
+
+    /**
+     * 任意 subresource 范围以及类型的 view，在第一次使用时创建，和 image 一起销毁
+     */
+    vk::ImageView subresource_view(const vk::ImageSubresourceRange& range, vk::ImageViewType view_type);
+
+
+    /**
+     * 指定 mip level 以及 layer 范围的 subresource range
+     * @param level_count 默认是从 base_level 开始剩下的所有 level
+     * @param layer_count 默认是从 base_layer 开始剩下的所有 layer
+     */
+    vk::ImageSubresourceRange subresource_range(uint32_t base_level = 0,
+                                                uint32_t level_count = VK_REMAINING_MIP_LEVELS,
+                                                uint32_t base_layer  = 0,
+                                                uint32_t layer_count = VK_REMAINING_ARRAY_LAYERS) const;
+
+
+    // 某个 mip level 的尺寸，3D image 的深度也会逐级减半
+    vk::Extent3D level_extent(uint32_t level) const;
+
+
+    // 由 Defragmenter 调用，参考 Buffer ==============================================================================
+public:
+    /**
+     * 只移动采样用的 image：需要设置 movable，layout 为 shader read only，并且可以作为拷贝的 src 以及 dst
+     */
+    bool can_relocate() const;
+
+    /**
+     * 在 dst_allocation 的位置创建新的 image，并录制拷贝所有 level 的命令，完成后新 image 的 layout 为 shader read only
+     */
+    void begin_relocation(VmaAllocation dst_allocation, vk::CommandBuffer command_buffer);
+
+    /**
+     * 录制拷贝之后立即换成新的 handle 并通知使用者；旧的 image 以及 view 交给 deletion queue
+     */
+    void end_relocation();
+
+    /**
+     * VMA 完成这一轮移动之后，更新分配信息
+     */
+    void finish_relocation();
+
+
 private:
     // 创建 image view
     void _create_view();
 
+    vk::ImageView _create_view(const vk::ImageSubresourceRange& range, vk::ImageViewType view_type,
+                               const std::string& debug_name);
+
+    // 销毁按需创建的 view
+    void _destroy_cached_views();
+
 
 public:
     Prop<VkImage, Image2D>              vkimage{};
@@ -130,38 +246,97 @@ public:
     Prop<vk::Format, Image2D>           format{};
     Prop<vk::Extent2D, Image2D>         extent{};
     Prop<vk::ImageAspectFlags, Image2D> aspect{};
+    Prop<uint32_t, Image2D>             mip_levels{1};
+    Prop<uint32_t, Image2D>             array_layers{1};
+    Prop<uint32_t, Image2D>             depth{1};    // 只有 3D image 大于 1
+    Prop<vk::ImageType, Image2D>        type{vk::ImageType::e2D};
+    Prop<vk::ImageViewType, Image2D>    view_type{vk::ImageViewType::e2D};    // 默认 view 的类型
     vk::ImageView                       vkview() const { return view().vkview; }
 
 
 private:
     Device& _device;
 
-    VmaAllocator      _allocator  = nullptr;
-    VmaAllocation     _allocation = nullptr;
-    VmaAllocationInfo _alloc_info{};
+    VmaAllocator        _allocator  = nullptr;
+    VmaAllocation       _allocation = nullptr;
+    VmaAllocationInfo   _alloc_info{};
+    vk::ImageCreateInfo _image_info{};                       // 移动时使用相同的参数创建新的 image
+    VkImage             _relocation_image = VK_NULL_HANDLE;    // 移动过程中，位于新位置的 image
 
     bool is_proxy = false;    // image 来自类的外部，并非在类中创建
 
+    // 按需创建的 view：level view，layer view 以及其他 subresource view
+    struct CachedView
+    {
+        vk::ImageViewType         type;
+        vk::ImageSubresourceRange range;
+        vk::ImageView             vkview;
+    };
+    std::vector<CachedView> _cached_views;
+
     vk::ImageLayout _layout;
 };
 
 
+/**
+ * storage image 的 layout 一定是 general
+ * @details 可以有多个 mip level（例如 depth pyramid，每一级通过 level_view 写入）以及多个 layer
+ */
 class StorageImage : public Image2D
 {
 public:
     StorageImage(VmaAllocator allocator, Device& device, vk::Format format, vk::Extent2D extent,
-                 const std::string& name = "")
+                 const std::string& name = "", uint32_t mip_levels = 1, uint32_t array_layers = 1)
         : Image2D(allocator, device,
                   Image2DCreateInfo{
                           .name         = name,
                           .format       = format,    // compoenent 是 uint
                           .extent       = extent,
                           .usage        = vk::ImageUsageFlagBits::eStorage,
+                          .mip_levels   = mip_levels,
+                          .array_layers = array_layers,
                           .memory_flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
                           .aspect       = vk::ImageAspectFlagBits::eColor,    // 表示要访问 RGB 组件
                           .init_layout  = vk::ImageLayout::eGeneral,          // storage image 一定要是这个 layout
                   })
     {}
+
+
+    // 完全自定义的参数，会添加 storage 的 usage，并且 layout 一定是 general
+    StorageImage(VmaAllocator allocator, Device& device, Image2DCreateInfo info)
+        : Image2D(allocator, device, _storage_info(std::move(info)))
+    {}
+
+
+    /**
+     * 3D 的 storage image，例如 clustered shading 中每个 cluster 的 light grid
+     * @param mip_levels 完整的级数需要考虑深度，通过 Image2D::max_mip_levels(extent) 计算
+     */
+    static std::shared_ptr<StorageImage> create_3d(VmaAllocator allocator, Device& device, vk::Format format,
+                                                   vk::Extent3D extent, const std::string& name = "",
+                                                   uint32_t mip_levels = 1)
+    {
+        return std::make_shared<StorageImage>(allocator, device,
+                                              Image2DCreateInfo{
+                                                      .name         = name,
+                                                      .type         = vk::ImageType::e3D,
+                                                      .format       = format,
+                                                      .extent       = {extent.width, extent.height},
+                                                      .depth        = extent.depth,
+                                                      .mip_levels   = mip_levels,
+                                                      .memory_flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
+                                                      .aspect       = vk::ImageAspectFlagBits::eColor,
+                                              });
+    }
+
+
+private:
+    static Image2DCreateInfo _storage_info(Image2DCreateInfo info)
+    {
+        info.usage |= vk::ImageUsageFlagBits::eStorage;
+        info.init_layout = vk::ImageLayout::eGeneral;
+        return info;
+    }
 };
 
 
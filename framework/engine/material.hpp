@@ -33,10 +33,11 @@ struct Matt
     glm::vec4 color_specular{0.f};
     glm::vec4 color_emissive{0.f};
 
-    std::unique_ptr<Hiss::Texture> tex_diffuse;
-    std::unique_ptr<Hiss::Texture> tex_ambient;
-    std::unique_ptr<Hiss::Texture> tex_emissive;
-    std::unique_ptr<Hiss::Texture> tex_specular;
+    // 纹理来自 texture cache，可能被多个材质共享
+    std::shared_ptr<Hiss::Texture> tex_diffuse;
+    std::shared_ptr<Hiss::Texture> tex_ambient;
+    std::shared_ptr<Hiss::Texture> tex_emissive;
+    std::shared_ptr<Hiss::Texture> tex_specular;
 
 
     /**
@@ -105,7 +106,7 @@ struct Matt
         descriptor_set->write({.buffer = material_uniform.get()}, 0);
 
         // 如果有材质，就填充材质；否则填充默认材质
-        auto func = [&engine, this](std::unique_ptr<Texture>& tex, int binding) {
+        auto func = [&engine, this](std::shared_ptr<Texture>& tex, int binding) {
             if (tex)
             {
                 descriptor_set->write({.image = &tex->image(), .sampler = tex->sampler()}, binding);
@@ -0,0 +1,254 @@
+#include "engine/memory_policy.hpp"
+
+#include <spdlog/spdlog.h>
+
+
+std::mutex                                             Hiss::MemoryPolicy::_registry_mutex;
+std::unordered_map<VmaAllocator, Hiss::MemoryPolicy*> Hiss::MemoryPolicy::_registry;
+
+
+namespace
+{
+
+const VmaAllocationCreateFlags HOST_ACCESS_FLAGS =
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT;
+
+}    // namespace
+
+
+Hiss::MemoryPolicy::MemoryPolicy(VmaAllocator allocator, const Config& config)
+    : _allocator(allocator),
+      _config(config)
+{
+    const VmaAllocationCreateFlags host_write =
+            VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    // UniformBuffer 的 flags：允许使用 device local 且 host visible 的内存；没有这样的内存时可能不是 host visible 的
+    _uniform_flags = host_write | VMA_ALLOCATION_CREATE_HOST_ACCESS_ALLOW_TRANSFER_INSTEAD_BIT;
+    _uniform_pool  = _create_pool(vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                                  _uniform_flags, config.uniform_block_size, 0, 0, "uniform pool",
+                                  &_uniform_host_visible);
+    _storage_pool = _create_pool(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst
+                                         | vk::BufferUsageFlagBits::eTransferSrc,
+                                 0, config.storage_block_size, 0, 0, "storage pool");
+    _stage_flags  = host_write;
+    _stage_pool   = _create_pool(vk::BufferUsageFlagBits::eTransferSrc, _stage_flags, config.stage_block_size, 0, 0,
+                                 "stage pool", &_stage_host_visible);
+
+    // 只有一个 block 的 linear pool，可以按照 ring buffer 的方式使用
+    _frame_flags = host_write;
+    _frame_pool  = _create_pool(vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer
+                                        | vk::BufferUsageFlagBits::eTransferSrc,
+                                _frame_flags, config.frame_pool_size, VMA_POOL_CREATE_LINEAR_ALGORITHM_BIT, 1,
+                                "frame pool", &_frame_host_visible);
+
+
+    std::lock_guard<std::mutex> lock(_registry_mutex);
+    _registry[allocator] = this;
+}
+
+
+Hiss::MemoryPolicy::~MemoryPolicy()
+{
+    {
+        std::lock_guard<std::mutex> lock(_registry_mutex);
+        _registry.erase(_allocator);
+    }
+
+    for (auto pool: {_uniform_pool, _storage_pool, _stage_pool, _frame_pool})
+        if (pool)
+            vmaDestroyPool(_allocator, pool);
+}
+
+
+Hiss::MemoryPolicy* Hiss::MemoryPolicy::find(VmaAllocator allocator)
+{
+    std::lock_guard<std::mutex> lock(_registry_mutex);
+    auto                        iter = _registry.find(allocator);
+    return iter == _registry.end() ? nullptr : iter->second;
+}
+
+
+VmaPool Hiss::MemoryPolicy::_create_pool(vk::BufferUsageFlags usage, VmaAllocationCreateFlags flags,
+                                         vk::DeviceSize block_size, VmaPoolCreateFlags pool_flags,
+                                         size_t max_block_count, const char* name, bool* host_visible)
+{
+    // 通过一个示例 buffer 找到合适的 memory type
+    VkBufferCreateInfo buffer_info = {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size  = 1024,
+            .usage = (VkBufferUsageFlags) usage,
+    };
+    VmaAllocationCreateInfo alloc_info = {
+            .flags = flags,
+            .usage = VMA_MEMORY_USAGE_AUTO,
+    };
+    uint32_t memory_type_index = 0;
+    if (vmaFindMemoryTypeIndexForBufferInfo(_allocator, &buffer_info, &alloc_info, &memory_type_index) != VK_SUCCESS)
+    {
+        spdlog::warn("[memory policy] no memory type for {}, fallback to default allocation", name);
+        return VK_NULL_HANDLE;
+    }
+
+    VmaPoolCreateInfo pool_info = {
+            .memoryTypeIndex = memory_type_index,
+            .flags           = pool_flags,
+            .blockSize       = block_size,
+            .maxBlockCount   = max_block_count,
+    };
+    VmaPool pool = VK_NULL_HANDLE;
+    if (vmaCreatePool(_allocator, &pool_info, &pool) != VK_SUCCESS)
+    {
+        spdlog::warn("[memory policy] fail to create {}", name);
+        return VK_NULL_HANDLE;
+    }
+    vmaSetPoolName(_allocator, pool, name);
+
+    if (host_visible)
+    {
+        VkMemoryPropertyFlags memory_properties = 0;
+        vmaGetMemoryTypeProperties(_allocator, memory_type_index, &memory_properties);
+        *host_visible = memory_properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    }
+    return pool;
+}
+
+
+bool Hiss::MemoryPolicy::_host_access_compatible(VmaAllocationCreateFlags pool_flags, bool pool_host_visible,
+                                                 VmaAllocationCreateFlags memory_flags)
+{
+    // 随机访问需要 cached 的内存，只有以同样方式创建的 pool 才能满足
+    if ((memory_flags & VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT)
+        != (pool_flags & VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT))
+        return false;
+
+    // 调用者可以接受通过 transfer 写入时，任何 memory 都可以；否则需要能够 map
+    return pool_host_visible || (memory_flags & VMA_ALLOCATION_CREATE_HOST_ACCESS_ALLOW_TRANSFER_INSTEAD_BIT);
+}
+
+
+VmaAllocationCreateInfo Hiss::MemoryPolicy::_buffer_alloc_info(const VkBufferCreateInfo& buffer_info,
+                                                               VmaAllocationCreateFlags  memory_flags) const
+{
+    auto usage = vk::BufferUsageFlags(buffer_info.usage);
+    auto size  = buffer_info.size;
+    bool host  = memory_flags & HOST_ACCESS_FLAGS;
+
+    VmaAllocationCreateInfo info = {
+            .flags    = memory_flags & ~VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
+            .usage    = VMA_MEMORY_USAGE_AUTO,
+            .priority = 1.f,
+    };
+
+    if (size >= _config.dedicated_threshold)
+        info.flags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+    else if (host && usage == FRAME_BUFFER_USAGE && size <= _config.frame_pool_size / 2)
+    {
+        // 每一帧的临时数据（例如 UniformRing）；保留一半的空间，重新创建时旧的 buffer 仍然可以存在
+        if (_host_access_compatible(_frame_flags, _frame_host_visible, memory_flags))
+            info.pool = _frame_pool;
+    }
+    else if (host && usage == vk::BufferUsageFlagBits::eTransferSrc && size <= _config.stage_block_size / 2)
+    {
+        if (_host_access_compatible(_stage_flags, _stage_host_visible, memory_flags))
+            info.pool = _stage_pool;
+    }
+    else if (size <= _config.small_limit)
+    {
+        if (host && (usage & vk::BufferUsageFlagBits::eUniformBuffer))
+        {
+            if (_host_access_compatible(_uniform_flags, _uniform_host_visible, memory_flags))
+                info.pool = _uniform_pool;
+        }
+        else if (!host && (usage & vk::BufferUsageFlagBits::eStorageBuffer))
+            info.pool = _storage_pool;
+    }
+    return info;
+}
+
+
+VmaAllocationCreateInfo Hiss::MemoryPolicy::_image_alloc_info(const VkImageCreateInfo& image_info,
+                                                              VmaAllocationCreateFlags memory_flags) const
+{
+    // 按照每个像素 4 byte 估计大小，忽略 mipmap
+    auto size = (vk::DeviceSize) image_info.extent.width * image_info.extent.height * image_info.extent.depth
+              * image_info.arrayLayers * (vk::DeviceSize) image_info.samples * 4;
+
+    // render target 以及 storage image 会被频繁读写，并且通常很大，使用 dedicated memory
+    auto usage         = vk::ImageUsageFlags(image_info.usage);
+    bool render_target = bool(usage
+                              & (vk::ImageUsageFlagBits::eColorAttachment
+                                 | vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eStorage));
+
+    VmaAllocationCreateInfo info = {
+            .flags    = memory_flags & ~VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
+            .usage    = VMA_MEMORY_USAGE_AUTO,
+            .priority = 1.f,
+    };
+    if (render_target || size >= _config.dedicated_threshold)
+        info.flags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+    return info;
+}
+
+
+VkResult Hiss::MemoryPolicy::create_buffer(VmaAllocator allocator, const VkBufferCreateInfo& buffer_info,
+                                           VmaAllocationCreateFlags memory_flags, VkBuffer* buffer,
+                                           VmaAllocation* allocation, VmaAllocationInfo* alloc_info)
+{
+    VmaAllocationCreateInfo fallback = {
+            .flags    = memory_flags,
+            .usage    = VMA_MEMORY_USAGE_AUTO,
+            .priority = 1.f,
+    };
+
+    auto* policy = find(allocator);
+    if (!policy)
+        return vmaCreateBuffer(allocator, &buffer_info, &fallback, buffer, allocation, alloc_info);
+
+    auto info   = policy->_buffer_alloc_info(buffer_info, memory_flags);
+    auto result = vmaCreateBuffer(allocator, &buffer_info, &info, buffer, allocation, alloc_info);
+    if (result != VK_SUCCESS && info.pool)
+    {
+        info.pool = VK_NULL_HANDLE;
+        result    = vmaCreateBuffer(allocator, &buffer_info, &info, buffer, allocation, alloc_info);
+    }
+    return result;
+}
+
+
+VkResult Hiss::MemoryPolicy::create_image(VmaAllocator allocator, const VkImageCreateInfo& image_info,
+                                          VmaAllocationCreateFlags memory_flags, VkImage* image,
+                                          VmaAllocation* allocation, VmaAllocationInfo* alloc_info)
+{
+    auto* policy = find(allocator);
+    auto  info   = policy ? policy->_image_alloc_info(image_info, memory_flags)
+                          : VmaAllocationCreateInfo{
+                                    .flags    = memory_flags,
+                                    .usage    = VMA_MEMORY_USAGE_AUTO,
+                                    .priority = 1.f,
+                            };
+    return vmaCreateImage(allocator, &image_info, &info, image, allocation, alloc_info);
+}
+
+
+Hiss::MemoryPolicy::Stats Hiss::MemoryPolicy::stats() const
+{
+    VmaTotalStatistics total;
+    vmaCalculateStatistics(_allocator, &total);
+
+    return Stats{
+            .memory_block_num = total.total.statistics.blockCount,
+            .allocation_num   = total.total.statistics.allocationCount,
+            .bytes_block      = total.total.statistics.blockBytes,
+            .bytes_allocation = total.total.statistics.allocationBytes,
+    };
+}
+
+
+void Hiss::MemoryPolicy::log_stats(const std::string& tag) const
+{
+    auto s = stats();
+    spdlog::info("[memory policy] {}device memory: {}, allocations: {}, used: {:.1f} / {:.1f} MB",
+                 tag.empty() ? "" : tag + ": ", s.memory_block_num, s.allocation_num,
+                 (double) s.bytes_allocation / 1024.0 / 1024.0, (double) s.bytes_block / 1024.0 / 1024.0);
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "core/vk_include.hpp"
+
+
+namespace Hiss
+{
+
+/**
+ * 根据资源的用途以及大小决定 VMA 的分配方式，避免每个小对象都独占一个 VkDeviceMemory
+ *  - dedicated memory：只用于 render target，storage image，以及超过 dedicated_threshold 的资源
+ *  - 小的 uniform buffer，storage buffer，stage buffer：从对应的 custom pool 中分配，
+ *    只有 host 访问方式与 pool 兼容时才会进入 pool（例如需要 mapped 的 buffer 不会进入不可 map 的 pool）
+ *  - 每一帧的临时数据：usage 为 FRAME_BUFFER_USAGE 的 host visible buffer（例如 UniformRing），从 linear pool 中分配
+ *  - 其他：交给 VMA 的默认策略，从共享的 block 中分配
+ * @details Buffer 以及 Image2D 在创建时通过 allocator 找到对应的 policy；没有 policy 时（例如离线工具），直接使用调用者的 flags
+ * @details 调用者传入的 memory flags 只是建议，DEDICATED_MEMORY_BIT 会被 policy 忽略
+ */
+class MemoryPolicy
+{
+public:
+    struct Config
+    {
+        vk::DeviceSize dedicated_threshold = 16 * 1024 * 1024;    // 超过这个大小的资源使用 dedicated memory
+        vk::DeviceSize small_limit         = 256 * 1024;          // 超过这个大小的 buffer 不进入 pool
+        vk::DeviceSize uniform_block_size  = 4 * 1024 * 1024;
+        vk::DeviceSize storage_block_size  = 16 * 1024 * 1024;
+        vk::DeviceSize stage_block_size    = 32 * 1024 * 1024;
+        vk::DeviceSize frame_pool_size     = 8 * 1024 * 1024;    // linear pool 只有一个 block
+    };
+
+
+    MemoryPolicy(VmaAllocator allocator, const Config& config);
+    explicit MemoryPolicy(VmaAllocator allocator)
+        : MemoryPolicy(allocator, Config{})
+    {}
+    ~MemoryPolicy();
+
+
+    /**
+     * 找到 allocator 对应的 policy，不存在时返回 nullptr
+     */
+    static MemoryPolicy* find(VmaAllocator allocator);
+
+
+    /**
+     * 按照 policy 创建 buffer，代替 vmaCreateBuffer
+     * @details 从 pool 中分配失败时（例如 memory type 不兼容），会退回到 VMA 的默认策略
+     * @param memory_flags 调用者的建议，例如是否需要 host 访问
+     */
+    static VkResult create_buffer(VmaAllocator allocator, const VkBufferCreateInfo& buffer_info,
+                                  VmaAllocationCreateFlags memory_flags, VkBuffer* buffer, VmaAllocation* allocation,
+                                  VmaAllocationInfo* alloc_info);
+
+
+    /**
+     * 按照 policy 创建 image，代替 vmaCreateImage
+     */
+    static VkResult create_image(VmaAllocator allocator, const VkImageCreateInfo& image_info,
+                                 VmaAllocationCreateFlags memory_flags, VkImage* image, VmaAllocation* allocation,
+                                 VmaAllocationInfo* alloc_info);
+
+
+    /**
+     * 用于每一帧临时数据的 linear pool，host visible，可以作为 uniform 以及 storage buffer
+     * @details usage 恰好为 FRAME_BUFFER_USAGE，并且需要 host 写入的 buffer 会自动从这里分配
+     */
+    VmaPool frame_pool() const { return _frame_pool; }
+
+    static constexpr vk::BufferUsageFlags FRAME_BUFFER_USAGE =
+            vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer;
+
+
+    struct Stats
+    {
+        uint32_t       memory_block_num = 0;    // VkDeviceMemory 的数量
+        uint32_t       allocation_num   = 0;
+        vk::DeviceSize bytes_block      = 0;
+        vk::DeviceSize bytes_allocation = 0;
+    };
+
+    Stats stats() const;
+    void  log_stats(const std::string& tag = "") const;
+
+
+private:
+    /**
+     * @param host_visible 返回 pool 的 memory type 是否是 host visible 的
+     */
+    VmaPool _create_pool(vk::BufferUsageFlags usage, VmaAllocationCreateFlags flags, vk::DeviceSize block_size,
+                         VmaPoolCreateFlags pool_flags, size_t max_block_count, const char* name,
+                         bool* host_visible = nullptr);
+
+    // 调用者要求的 host 访问方式能否由 pool 的 memory 满足
+    static bool _host_access_compatible(VmaAllocationCreateFlags pool_flags, bool pool_host_visible,
+                                        VmaAllocationCreateFlags memory_flags);
+
+    VmaAllocationCreateInfo _buffer_alloc_info(const VkBufferCreateInfo& buffer_info,
+                                               VmaAllocationCreateFlags  memory_flags) const;
+    VmaAllocationCreateInfo _image_alloc_info(const VkImageCreateInfo& image_info,
+                                              VmaAllocationCreateFlags memory_flags) const;
+
+
+private:
+    VmaAllocator _allocator;
+    Config       _config;
+
+    VmaPool _uniform_pool = VK_NULL_HANDLE;
+    VmaPool _storage_pool = VK_NULL_HANDLE;
+    VmaPool _stage_pool   = VK_NULL_HANDLE;
+    VmaPool _frame_pool   = VK_NULL_HANDLE;
+
+    // 创建 pool 时使用的 flags，以及选中的 memory type 是否 host visible
+    VmaAllocationCreateFlags _uniform_flags        = 0;
+    VmaAllocationCreateFlags _stage_flags          = 0;
+    VmaAllocationCreateFlags _frame_flags          = 0;
+    bool                     _uniform_host_visible = false;
+    bool                     _stage_host_visible   = false;
+    bool                     _frame_host_visible   = false;
+
+    static std::mutex                                       _registry_mutex;
+    static std::unordered_map<VmaAllocator, MemoryPolicy*> _registry;
+};
+
+}    // namespace Hiss
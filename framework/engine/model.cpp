@@ -1,8 +1,11 @@
 #include "model.hpp"
 
+#include <map>
+#include <tuple>
 #include <utility>
 #include <fmt/format.h>
 #include "utils/tools.hpp"
+#include "utils/mesh_optimizer.hpp"
 #include "engine.hpp"
 
 
@@ -16,18 +19,10 @@ Hiss::Mesh::Mesh(Hiss::Engine& engine, const std::string& mesh_path, const std::
     tiny_obj_load(vertices, indices);
 
 
-    // 创建 vertex buffer 以及 index buffer
-    _vertex_buffer2 = new Hiss::VertexBuffer2<Hiss::Vertex3DNormalUV>(engine.device(), engine.allocator, vertices,
-                                                                      fmt::format("{}-vertex-buffer", name));
-    _index_buffer2 =
-            new Hiss::IndexBuffer2(engine.device(), engine.allocator, indices, fmt::format("{}-index-buffer", name));
-}
-
-
-Hiss::Mesh::~Mesh()
-{
-    delete _vertex_buffer2;
-    delete _index_buffer2;
+    // 在 geometry arena 中分配顶点以及索引
+    auto& arena = engine.geometry_arena();
+    _vertices   = arena.upload_vertices(vertices.data(), (uint32_t) vertices.size(), sizeof(Hiss::Vertex3DNormalUV));
+    _indices    = arena.upload_indices(indices.data(), (uint32_t) indices.size(), _index_type);
 }
 
 
@@ -45,10 +40,20 @@ void Hiss::Mesh::tiny_obj_load(std::vector<Hiss::Vertex3DNormalUV>&        verti
         throw std::runtime_error(fmt::format("fail to _load obj file: ({}), error message: ({})", mesh_path(), err_msg));
 
 
+    // obj 中的每个顶点由 (position, normal, uv) 的索引确定，相同的组合只生成一个顶点
+    std::map<std::tuple<int, int, int>, uint32_t> unique_vertices;
     for (const auto& shape: shapes)
     {
         for (const auto& index: shape.mesh.indices)
         {
+            auto key  = std::make_tuple(index.vertex_index, index.normal_index, index.texcoord_index);
+            auto iter = unique_vertices.find(key);
+            if (iter != unique_vertices.end())
+            {
+                indices.push_back(iter->second);
+                continue;
+            }
+
             Vertex3DNormalUV vertex = {
                     .pos = {attr.vertices[3 * index.vertex_index + 0], attr.vertices[3 * index.vertex_index + 1],
                             attr.vertices[3 * index.vertex_index + 2]},
@@ -66,8 +71,19 @@ void Hiss::Mesh::tiny_obj_load(std::vector<Hiss::Vertex3DNormalUV>&        verti
             };
 
 
+            unique_vertices[key] = (uint32_t) vertices.size();
             indices.push_back(vertices.size());
             vertices.push_back(vertex);
         }
     }
+
+
+    // 优化 vertex cache 以及 vertex fetch
+    auto before = MeshOptimizer::analyze_vertex_cache(indices.data(), indices.size(), vertices.size());
+    MeshOptimizer::optimize_vertex_cache(indices.data(), indices.size(), vertices.size());
+    MeshOptimizer::remap_vertices(vertices,
+                                  MeshOptimizer::optimize_vertex_fetch(indices.data(), indices.size(), vertices.size()));
+    auto after = MeshOptimizer::analyze_vertex_cache(indices.data(), indices.size(), vertices.size());
+    spdlog::info("[mesh optimizer] {}: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", mesh_path(), before.acmr,
+                 after.acmr, before.atvr, after.atvr);
 }
@@ -15,10 +15,21 @@ class Mesh
 {
 public:
     Mesh(Hiss::Engine& engine, const std::string& mesh_path, const std::string& name = "");
-    ~Mesh();
+    ~Mesh() = default;
 
-    Hiss::VertexBuffer2<Hiss::Vertex3DNormalUV>& vertex_buffer() const { return *_vertex_buffer2; }
-    Hiss::IndexBuffer2&                          index_buffer() const { return *_index_buffer2; }
+
+    /**
+     * 顶点和索引位于 engine 的 geometry arena 中，绘制时需要使用 vertexOffset 以及 firstIndex
+     */
+    void bind(vk::CommandBuffer command_buffer, GeometryBinding& binding) const
+    {
+        binding.bind(command_buffer, _vertices, _indices, _index_type);
+    }
+
+    void draw(vk::CommandBuffer command_buffer, uint32_t instance_num = 1) const
+    {
+        command_buffer.drawIndexed(_indices.count(), instance_num, _indices.first(), (int32_t) _vertices.first(), 0);
+    }
 
     Prop<std::string, Mesh> mesh_path;
 
@@ -33,8 +44,9 @@ private:
 private:
     Hiss::Engine& engine;
 
-    Hiss::VertexBuffer2<Hiss::Vertex3DNormalUV>* _vertex_buffer2;
-    Hiss::IndexBuffer2*                          _index_buffer2;
+    Hiss::GeometryRange _vertices;
+    Hiss::GeometryRange _indices;
+    vk::IndexType       _index_type = vk::IndexType::eUint32;
 };
 
 
@@ -1,18 +1,22 @@
 #pragma once
 #include <memory>
+#include <cassert>
+#include <exception>
 #include <filesystem>
 
 #include <fmt/format.h>
-#include <assimp/scene.h>
-#include <assimp/Importer.hpp>
-#include <assimp/postprocess.h>
 
 #include "core/vk_include.hpp"
 #include "engine/engine.hpp"
 #include "engine/vertex.hpp"
+#include "engine/vertex_pack.hpp"
+#include "engine/model_desc.hpp"
 #include "vertex_buffer.hpp"
+#include "engine/geometry_arena.hpp"
 #include "engine/texture.hpp"
 #include "utils/vk_func.hpp"
+#include "utils/cook.hpp"
+#include "utils/timer.hpp"
 #include "material.hpp"
 
 
@@ -20,81 +24,91 @@ namespace Hiss
 {
 
 
-struct Vertex3D
+/**
+ * 几何信息
+ * @details 只持有 GPU 端的数据，CPU 端的数据在 MeshDesc 中，创建完 buffer 之后就不需要了
+ * @details 顶点和索引都分配在 engine 的 geometry arena 中，与其他的 mesh 共享 buffer
+ */
+struct Mesh2
 {
-    glm::vec3 position;     // location 0
-    glm::vec3 normal;       // location 1
-    glm::vec3 tangent;      // location 2
-    glm::vec3 bitangent;    // location 3
-    glm::vec2 uv;           // location 4
+    GeometryRange vertices;    // 顶点的类型由 vertex_format 决定
+    GeometryRange indices;
+    vk::IndexType index_type = vk::IndexType::eUint32;
 
-    static std::vector<vk::VertexInputBindingDescription> binding_description(uint32_t bindind)
+    VertexFormat             vertex_format = VertexFormat::Full;
+    VertexPack::Quantization quantization;    // 只有 Quantized 格式需要，shader 需要用来还原位置
+
+
+    /**
+     * 数据从 MeshDesc 直接写入 stage buffer，MeshDesc 可能指向 mapped file
+     * @param format 不是 Full 时，先在 CPU 端转换顶点格式
+     * @param error 不为空时，记录转换顶点格式带来的最大误差
+     */
+    void create_buffer(Engine& engine, const MeshDesc& desc, VertexFormat format = VertexFormat::Full,
+                       VertexPack::PackError* error = nullptr)
     {
-        return {
-                vk::VertexInputBindingDescription{
-                        // 表示一个 vertex buffer，一次渲染的顶点数据可能位于多个 vertex buffer 中
-                        .binding   = bindind,
-                        .stride    = sizeof(Hiss::Vertex3D),
-                        .inputRate = vk::VertexInputRate::eVertex,
-                },
-        };
+        auto& arena      = engine.geometry_arena();
+        auto  vertex_num = (uint32_t) desc.vertex_num();
+
+        vertex_format = format;
+        switch (format)
+        {
+            case VertexFormat::Full:
+                vertices = arena.upload_vertices(desc.vertex_data(), vertex_num, sizeof(Vertex3D));
+                break;
+            case VertexFormat::Packed:
+                vertices = arena.upload_vertices(VertexPack::pack(desc.vertex_data(), vertex_num, error).data(),
+                                                 vertex_num, sizeof(Vertex3DPacked));
+                break;
+            case VertexFormat::Quantized:
+                quantization = VertexPack::compute_quantization(desc.vertex_data(), vertex_num);
+                vertices     = arena.upload_vertices(
+                        VertexPack::quantize(desc.vertex_data(), vertex_num, quantization, error).data(), vertex_num,
+                        sizeof(Vertex3DQuantized));
+                break;
+        }
+
+
+        // 索引允许时使用 uint16
+        indices = arena.upload_indices(reinterpret_cast<const uint32_t*>(desc.face_data()),
+                                       (uint32_t) desc.face_num() * 3, index_type);
     }
 
 
-    static std::vector<vk::VertexInputAttributeDescription> attribute_description(uint32_t binding)
+    /**
+     * 加入批量上传，顶点已经在 CPU 端转换为 format 对应的格式，参考 MeshLoader
+     * @param vertex_data 需要在 batch.submit 之前保持有效
+     */
+    void create_buffer(GeometryArena::UploadBatch& batch, const MeshDesc& desc, VertexFormat format,
+                       const void* vertex_data, const VertexPack::Quantization& quant = {})
     {
-        return {
-                vk::VertexInputAttributeDescription{
-                        .location = 0,
-                        .binding  = binding,
-                        .format   = vk::Format::eR32G32B32Sfloat,    // signed float
-                        .offset   = offsetof(Vertex3D, position),
-                },
-                vk::VertexInputAttributeDescription{
-                        .location = 1,
-                        .binding  = binding,
-                        .format   = vk::Format::eR32G32B32Sfloat,
-                        .offset   = offsetof(Vertex3D, normal),
-                },
-                vk::VertexInputAttributeDescription{
-                        .location = 2,
-                        .binding  = binding,
-                        .format   = vk::Format::eR32G32B32Sfloat,
-                        .offset   = offsetof(Vertex3D, tangent),
-                },
-                vk::VertexInputAttributeDescription{
-                        .location = 3,
-                        .binding  = binding,
-                        .format   = vk::Format::eR32G32B32Sfloat,
-                        .offset   = offsetof(Vertex3D, bitangent),
-                },
-                vk::VertexInputAttributeDescription{
-                        .location = 4,
-                        .binding  = binding,
-                        .format   = vk::Format::eR32G32Sfloat,
-                        .offset   = offsetof(Vertex3D, uv),
-                },
-        };
+        uint32_t stride = format == VertexFormat::Full   ? sizeof(Vertex3D)
+                        : format == VertexFormat::Packed ? sizeof(Vertex3DPacked)
+                                                         : sizeof(Vertex3DQuantized);
+
+        vertex_format = format;
+        quantization  = quant;
+        vertices      = batch.vertices(vertex_data, (uint32_t) desc.vertex_num(), stride);
+        indices       = batch.indices(reinterpret_cast<const uint32_t*>(desc.face_data()),
+                                      (uint32_t) desc.face_num() * 3, index_type);
     }
-};
 
 
-/**
- * 几何信息
- */
-struct Mesh2
-{
-    std::vector<Vertex3D>     vertices;
-    std::vector<FaceTriangle> faces;
+    /**
+     * 绑定 vertex buffer 以及 index buffer，与上一个 mesh 相同时会跳过
+     */
+    void bind(vk::CommandBuffer command_buffer, GeometryBinding& binding) const
+    {
+        binding.bind(command_buffer, vertices, indices, index_type);
+    }
 
-    std::unique_ptr<Hiss::VertexBuffer2<Vertex3D>> vertex_buffer;
-    std::unique_ptr<Hiss::IndexBuffer2>            index_buffer;
 
-    void create_buffer(Engine& engine)
+    /**
+     * 通过 firstIndex 和 vertexOffset 定位到 mesh 在共享 buffer 中的位置
+     */
+    void draw(vk::CommandBuffer command_buffer, uint32_t instance_num = 1) const
     {
-        vertex_buffer = std::make_unique<Hiss::VertexBuffer2<Vertex3D>>(engine.device(), engine.allocator, vertices,
-                                                                        "mesh vertices");
-        index_buffer  = std::make_unique<Hiss::IndexBuffer2>(engine.device(), engine.allocator, faces, "mesh indcies");
+        command_buffer.drawIndexed(indices.count(), instance_num, indices.first(), (int32_t) vertices.first(), 0);
     }
 };
 
@@ -104,38 +118,11 @@ struct Mesh2
  */
 struct MatMesh
 {
-    std::unique_ptr<Mesh2> mesh;
-    std::unique_ptr<Matt>  mat;
+    std::shared_ptr<Mesh2> mesh;    // 被多个节点引用（实例化）的 mesh 共享同一份几何信息
+    std::shared_ptr<Matt>  mat;     // 使用同一个材质的 mesh 共享 Matt
 };
 
 
-/**
- * 将 Assimp 的 vec3 转换为 glm 的 vec3
- */
-inline glm::vec3 to_vec3(const aiVector3D& vec)
-{
-    return {vec.x, vec.y, vec.z};
-}
-
-inline glm::vec4 to_vec4(const aiColor4D& color)
-{
-    return {color.r, color.g, color.b, color.a};
-}
-
-/**
- * 将 Assimp 的矩阵转化为 glm 的矩阵
- * @details Assimp 的矩阵是 row-major 的，a 表示第 1 行，d 表示第 4 行
- * @details glm 的矩阵是 column-major 的
- */
-inline glm::mat4 to_mat4(const aiMatrix4x4& mat)
-{
-    return glm::mat4{mat.a1, mat.b1, mat.c1, mat.d1,     // 第 1 列
-                     mat.a2, mat.b2, mat.c2, mat.d2,     // 第 2 列
-                     mat.a3, mat.b3, mat.c3, mat.d3,     // 第 3 列
-                     mat.a4, mat.b4, mat.c4, mat.d4};    // 第 4 列
-}
-
-
 /**
  * 场景节点
  */
@@ -146,7 +133,12 @@ struct ModelNode
 
     std::vector<std::unique_ptr<ModelNode>> children;
 
-    void draw(const std::function<void(const MatMesh&, const glm::mat4&)>& d)
+    /**
+     * 遍历所有的 mesh，调用 d(mat_mesh, matrix)
+     * @details 以模板的形式接受 lambda，避免每一帧构造 std::function 时在堆上分配
+     */
+    template<typename Func>
+    void draw(Func&& d)
     {
         // TODO 暂时不考虑相对位置
 
@@ -166,10 +158,15 @@ struct ModelNode
 class MeshLoader
 {
 public:
-    MeshLoader(Hiss::Engine& engine, const std::filesystem::path& mesh_path)
+    /**
+     * @param vertex_format GPU 端使用的顶点格式，pipeline 的顶点输入需要与之对应
+     */
+    MeshLoader(Hiss::Engine& engine, const std::filesystem::path& mesh_path,
+               VertexFormat vertex_format = VertexFormat::Full)
         : engine(engine),
           mesh_path(mesh_path),
-          dir_path(mesh_path.parent_path())
+          dir_path(mesh_path.parent_path()),
+          vertex_format(vertex_format)
     {
         if (!exists(mesh_path))
             throw std::runtime_error("mesh file not exist: " + mesh_path.string());
@@ -182,204 +179,298 @@ public:
 private:
     void _load()
     {
-        // importer 析构时，会自动回收资源
-        Assimp::Importer assimp_impoter;
+        Timer timer;
+        timer.start();
+
+        // 之后创建的 buffer 以及 image 都归属于这个模型
+        ResourceRegistry::OwnerScope owner_scope{mesh_path.filename().string()};
 
         /**
-         * Assimp 导入的后处理操作
-         * @details 默认坐标系是右手系：+x = right, +y = up, +z 朝向观察方向，可以通过 MakeLeftHanded 标志来修改
-         * @details 默认三角形环绕方向是 CCW，可以通过 FlipWindingOrder 标志来修改
-         * @details 默认 UV 以左下角为原点，可以通过 FlipUVs 标志修改为左上角
-         * @details 默认矩阵采用 row major 的存储方式
-         * @flag calcTangentSpace 如果顶点具有法线属性，自动生成 tangent space 属性
-         * @flag JoinIdenticalVertices 如果没有这个 flag，那么渲染时是不需要 index buffer 的
-         * @flag Triangulate 将所有的面三角化
-         * @flag GenNormals 如果没有法线，自动生成面法线
-         * @flag SortByPType 在三角化之后发生，可以去除 point 和 line
+         * 优先使用二进制的模型文件（hiss_cook 的产物，或者之前运行时写入的缓存），通过 mmap 读取
+         * 可以跳过 Assimp 的导入以及 tangent space 的计算
          */
-        auto post_process_flags = aiProcess_CalcTangentSpace | aiProcess_JoinIdenticalVertices | aiProcess_Triangulate
-                                | aiProcess_GenNormals | aiProcess_SortByPType | aiProcess_FlipUVs;
+        ModelDesc desc;
+        bool      from_cache  = false;
+        auto      cached_path = Cook::find_cooked(mesh_path, Cook::MODEL_EXT);
+        if (cached_path)
+        {
+            try
+            {
+                desc       = ModelDesc::load(*cached_path);
+                from_cache = true;
+            }
+            catch (const std::exception& e)
+            {
+                // 版本不匹配或者文件损坏，重新导入并覆盖
+                spdlog::warn("[mesh loader] {}", e.what());
+            }
+        }
 
 
-        /**
-         * 载入模型文件
-         * @参考 Assimp 的文档：https://assimp-docs.readthedocs.io/en/v5.1.0/usage/use_the_lib.html
-         */
-        scene = assimp_impoter.ReadFile(mesh_path, post_process_flags);
-        if (!scene || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) || !scene->mRootNode)
+        // 没有可用的缓存时，使用 Assimp 导入，并写入缓存供下次使用
+        if (!from_cache)
         {
-            spdlog::error("{}", assimp_impoter.GetErrorString());
-            throw std::runtime_error("fail to _load obj file: " + mesh_path.string());
+            desc = ModelDesc::import(mesh_path, false, &engine.job_system());
+
+            auto cache_path = Cook::cooked_path(mesh_path, Cook::MODEL_EXT);
+            if (!cache_path.empty())
+            {
+                try
+                {
+                    desc.save(cache_path);
+                }
+                catch (const std::exception& e)
+                {
+                    spdlog::warn("[mesh loader] {}", e.what());
+                }
+            }
         }
 
+        timer.tick();
+        spdlog::info("[mesh loader] {} from {}: {:.1f} ms", mesh_path.filename().string(),
+                     from_cache ? "cache" : "import", timer.duration_ms());
 
-        // 从根节点开始，递归地处理
-        root_node = _process_node(*scene->mRootNode);
-    }
 
+        // 并行地解码所有材质引用的纹理，之后的 _get_texture 会直接命中缓存
+        _preload_textures(desc);
 
-    /**
-     * 递归地处理节点，节点中包括多个 mesh，包含子节点
-     */
-    std::unique_ptr<ModelNode> _process_node(const aiNode& ai_node)
-    {
-        std::unique_ptr<ModelNode> node{new ModelNode()};
-        node->relative_matrix = to_mat4(ai_node.mTransformation);
 
-        // 处理 node 中的所有 mesh
-        node->meshes.reserve(ai_node.mNumMeshes);
-        for (int i = 0; i < ai_node.mNumMeshes; ++i)
+        // 记录创建 GPU 资源的耗时以及 device memory 的数量，用于评估 memory policy 的效果
+        auto memory_before = engine.memory_policy().stats();
+        timer.tick();
+
+
+        /**
+         * 阶段 1：在 worker 上并行地转换所有 mesh 的顶点格式，同时在主线程上创建材质
+         * 材质引用的纹理已经在并行解码；descriptor set 的分配不是线程安全的，因此材质留在主线程
+         */
+        auto& jobs    = engine.job_system();
+        auto  convert = jobs.run([this, &desc] { _convert_meshes(desc); });
+
+        // 每个材质只创建一个 Matt，被使用该材质的所有 mesh 共享
+        try
         {
-            auto ai_mesh = scene->mMeshes[ai_node.mMeshes[i]];
-            node->meshes.push_back(_process_mesh(*ai_mesh));
+            materials.reserve(desc.materials.size());
+            for (auto& mat_desc: desc.materials)
+                materials.push_back(_get_material(mat_desc));
         }
-
-        // 处理所有的子节点
-        node->children.reserve(ai_node.mNumChildren);
-        for (int i = 0; i < ai_node.mNumChildren; ++i)
+        catch (...)
         {
-            node->children.push_back(_process_node(*ai_node.mChildren[i]));
+            // job 引用了栈上的数据，需要等待完成；转换也失败时，抛出的是转换的异常
+            jobs.wait(convert);
+            throw;
         }
-
-        return node;
+        timer.tick();
+        double materials_ms = timer.duration_ms();
+
+        jobs.wait(convert);    // 重新抛出转换中的异常
+        timer.tick();
+        double convert_wait_ms = timer.duration_ms();
+
+
+        // 阶段 2：所有 mesh 的顶点和索引放在一个 batch 中上传，staged 的数据只 submit 一次
+        GeometryArena::UploadBatch batch{engine.geometry_arena()};
+        meshes.reserve(desc.meshes.size());
+        for (size_t i = 0; i < desc.meshes.size(); ++i)
+            meshes.push_back(_get_geometry(batch, desc.meshes[i], _converted[i]));
+        batch.submit();
+        _converted.clear();
+        timer.tick();
+        double upload_ms = timer.duration_ms();
+
+
+        // 阶段 3：从根节点开始，递归地组装节点
+        root_node = _process_node(desc.root, desc);
+
+
+        timer.tick();
+        spdlog::info("[mesh loader] {} stages: convert {:.1f} ms on {} workers (waited {:.1f} ms), "
+                     "materials {:.1f} ms, upload {:.1f} ms",
+                     mesh_path.filename().string(), _convert_ms, jobs.worker_num(), convert_wait_ms, materials_ms,
+                     upload_ms);
+        double create_ms = materials_ms + convert_wait_ms + upload_ms + timer.duration_ms();
+        auto   memory_after = engine.memory_policy().stats();
+        spdlog::info("[mesh loader] {} create resources: {} materials, {} meshes, {:.1f} ms, "
+                     "device memory {} -> {}, allocations {} -> {}",
+                     mesh_path.filename().string(), desc.materials.size(), desc.meshes.size(), create_ms,
+                     memory_before.memory_block_num, memory_after.memory_block_num, memory_before.allocation_num,
+                     memory_after.allocation_num);
+
+        // 累计的上传路径：direct 表示 device local 的 memory 可以直接写入（UMA，resizable BAR）
+        auto& uploads = Buffer::upload_stats();
+        spdlog::info("[mesh loader] buffer uploads so far: direct {} ({:.1f} MB), staged {} ({:.1f} MB)",
+                     uploads.direct_num.load(), (double) uploads.direct_bytes.load() / 1024.0 / 1024.0,
+                     uploads.staged_num.load(), (double) uploads.staged_bytes.load() / 1024.0 / 1024.0);
+
+
+        // 压缩顶点格式时，报告精度的损失
+        if (vertex_format != VertexFormat::Full)
+            spdlog::info("[mesh loader] {} vertex format {}, max error: position {:.6f}, normal {:.4f} deg, "
+                         "tangent {:.4f} deg, uv {:.6f}",
+                         mesh_path.filename().string(), vertex_format == VertexFormat::Packed ? "packed" : "quantized",
+                         pack_error.position, pack_error.normal, pack_error.tangent, pack_error.uv);
     }
 
 
     /**
-     * 处理 aiMesh。一个 aiMesh 包括几何数据，以及对应的一个 Material 信息
+     * 收集所有材质引用的纹理，交给 texture cache 并行地解码
      */
-    MatMesh _process_mesh(const aiMesh& ai_mesh)
+    void _preload_textures(const ModelDesc& desc)
     {
-        return MatMesh{
-                .mesh = _get_geometry(ai_mesh),
-                .mat  = _get_material(*scene->mMaterials[ai_mesh.mMaterialIndex]),
-        };
+        std::vector<std::pair<std::filesystem::path, vk::Format>> requests;
+        for (auto& mat: desc.materials)
+        {
+            for (auto* tex: {&mat.tex_diffuse, &mat.tex_ambient, &mat.tex_specular, &mat.tex_emissive})
+            {
+                if (!tex->empty())
+                    requests.emplace_back(dir_path / *tex, vk::Format::eR8G8B8A8Srgb);
+            }
+        }
+
+        engine.texture_cache().preload(requests);
     }
 
 
     /**
-     * 从 aiMesh 中提取 material 的信息
+     * 递归地处理节点，节点中包括多个 mesh，包含子节点
      */
-    std::unique_ptr<Matt> _get_material(const aiMaterial& ai_mat)
+    std::unique_ptr<ModelNode> _process_node(const NodeDesc& node_desc, const ModelDesc& desc)
     {
-        std::unique_ptr<Matt> mat{new Matt()};
+        std::unique_ptr<ModelNode> node{new ModelNode()};
+        node->relative_matrix = node_desc.relative_matrix;
 
-        // 提取出各种颜色
+        // 处理 node 中的所有 mesh：几何信息已经上传，被多个节点引用的 mesh 共享同一份
+        node->meshes.reserve(node_desc.meshes.size());
+        for (auto mesh_index: node_desc.meshes)
         {
-            aiColor4D out_color;
-
-            // diffuse color
-            ai_mat.Get(AI_MATKEY_COLOR_DIFFUSE, out_color);
-            mat->color_diffuse = to_vec4(out_color);
-
-            // ambient color
-            ai_mat.Get(AI_MATKEY_COLOR_AMBIENT, out_color);
-            mat->color_ambient = to_vec4(out_color);
-
-            // specular color
-            ai_mat.Get(AI_MATKEY_COLOR_SPECULAR, out_color);
-            mat->color_specular = to_vec4(out_color);
-
-            // emissive color
-            ai_mat.Get(AI_MATKEY_COLOR_EMISSIVE, out_color);
-            mat->color_emissive = to_vec4(out_color);
+            if (mesh_index >= meshes.size())
+                throw std::runtime_error(fmt::format("mesh index {} out of range ({} meshes)", mesh_index,
+                                                     meshes.size()));
+            node->meshes.push_back(MatMesh{
+                    .mesh = meshes[mesh_index],
+                    .mat  = materials[desc.meshes[mesh_index].material],
+            });
         }
 
-        // 提取出各种纹理
+        // 处理所有的子节点
+        node->children.reserve(node_desc.children.size());
+        for (auto& child: node_desc.children)
         {
-            // diffuse texture
-            mat->tex_diffuse = _get_texture(ai_mat, aiTextureType_DIFFUSE);
+            node->children.push_back(_process_node(child, desc));
+        }
 
-            // emissive texture
-            mat->tex_ambient = _get_texture(ai_mat, aiTextureType_AMBIENT);
+        return node;
+    }
 
-            // specular texture
-            mat->tex_specular = _get_texture(ai_mat, aiTextureType_SPECULAR);
 
-            // emissive texture
-            mat->tex_emissive = _get_texture(ai_mat, aiTextureType_EMISSIVE);
-        }
+    /**
+     * 根据材质描述创建 Matt
+     */
+    std::shared_ptr<Matt> _get_material(const MaterialDesc& mat_desc)
+    {
+        auto mat = std::make_shared<Matt>();
+
+        mat->color_diffuse  = mat_desc.color_diffuse;
+        mat->color_ambient  = mat_desc.color_ambient;
+        mat->color_specular = mat_desc.color_specular;
+        mat->color_emissive = mat_desc.color_emissive;
+
+        mat->tex_diffuse  = _get_texture(mat_desc.tex_diffuse);
+        mat->tex_ambient  = _get_texture(mat_desc.tex_ambient);
+        mat->tex_specular = _get_texture(mat_desc.tex_specular);
+        mat->tex_emissive = _get_texture(mat_desc.tex_emissive);
 
         mat->create_descriptor_set(engine);
         return mat;
     }
 
     /**
-     * 从 aiMaterial 中提取出特定类型的纹理
+     * 通过 texture cache 获取纹理，多个材质引用同一个文件时，只会解码、上传一次
+     * @param relative_path 相对于模型文件所在文件夹的路径，为空表示没有纹理
      */
-    std::unique_ptr<Texture> _get_texture(const aiMaterial& ai_mat, aiTextureType tex_type,
-                                          vk::Format format = vk::Format::eR8G8B8A8Srgb)
+    std::shared_ptr<Texture> _get_texture(const std::string& relative_path,
+                                          vk::Format         format = vk::Format::eR8G8B8A8Srgb)
     {
-        if (ai_mat.GetTextureCount(tex_type) == 0)
+        if (relative_path.empty())
             return nullptr;
-
-        aiString out_path;    // 获取到的是相对路径
-
-        ai_mat.GetTexture(tex_type, 0, &out_path);
-        return std::make_unique<Texture>(engine.device(), engine.allocator, dir_path / out_path.C_Str(), format);
+        return engine.texture_cache().get(dir_path / relative_path, format);
     }
 
 
     /**
-     * 从 aiMesh 中提取几何信息
+     * 转换为 vertex_format 之后的顶点数据，只在加载的过程中使用
      */
-    std::unique_ptr<Mesh2> _get_geometry(const aiMesh& ai_mesh)
+    struct ConvertedMesh
     {
-        std::unique_ptr<Mesh2> mesh{new Mesh2()};
+        std::vector<Vertex3DPacked>    packed;
+        std::vector<Vertex3DQuantized> quantized;
+        VertexPack::Quantization       quantization;
+        VertexPack::PackError          error;
+    };
 
-        auto vert_num = ai_mesh.mNumVertices;
-        mesh->vertices.resize(vert_num);
 
-        auto face_num = ai_mesh.mNumFaces;
-        mesh->faces.resize(face_num);
+    /**
+     * 在 worker 上并行地转换所有 mesh 的顶点格式，每个 mesh 是一个独立的任务
+     * @details Full 格式不需要转换，直接上传 MeshDesc 中的数据（可能是 mapped file）
+     */
+    void _convert_meshes(const ModelDesc& desc)
+    {
+        Timer timer;
+        timer.start();
 
-        // faces
-        for (int i = 0; i < face_num; ++i)
+        _converted.clear();
+        _converted.resize(desc.meshes.size());
+        if (vertex_format != VertexFormat::Full)
         {
-            // 通过 Assimp 的 post-process 保证了这里的 face 都是 triangle
-            assert(ai_mesh.mFaces[i].mNumIndices == 3);
-            mesh->faces[i] = {
-                    ai_mesh.mFaces[i].mIndices[0],
-                    ai_mesh.mFaces[i].mIndices[1],
-                    ai_mesh.mFaces[i].mIndices[2],
-            };
+            engine.job_system().parallel_for(0, desc.meshes.size(), 1, [this, &desc](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    auto& mesh_desc  = desc.meshes[i];
+                    auto& converted  = _converted[i];
+                    auto* vertices   = mesh_desc.vertex_data();
+                    auto  vertex_num = mesh_desc.vertex_num();
+                    if (vertex_format == VertexFormat::Packed)
+                        converted.packed = VertexPack::pack(vertices, vertex_num, &converted.error);
+                    else
+                    {
+                        converted.quantization = VertexPack::compute_quantization(vertices, vertex_num);
+                        converted.quantized    = VertexPack::quantize(vertices, vertex_num, converted.quantization,
+                                                                      &converted.error);
+                    }
+                }
+            });
         }
 
-        // 通过 Assimp 的 post-process 保证了一定会有 normal，tangent
-        assert(ai_mesh.HasNormals() && ai_mesh.HasTangentsAndBitangents());
-
+        // 所有 mesh 中的最大误差
+        for (auto& converted: _converted)
+            pack_error.merge(converted.error);
 
-        // vertices
-        for (int i = 0; i < vert_num; ++i)
-        {
-            // position
-            mesh->vertices[i].position = to_vec3(ai_mesh.mVertices[i]);
-
-            // normal
-            mesh->vertices[i].normal = to_vec3(ai_mesh.mNormals[i]);
-
-            // tangent and biTangent
-            mesh->vertices[i].tangent   = to_vec3(ai_mesh.mTangents[i]);
-            mesh->vertices[i].bitangent = to_vec3(ai_mesh.mBitangents[i]);
-        }
+        timer.tick();
+        _convert_ms = timer.duration_ms();
+    }
 
 
-        // uv: Assimp 最多支持 8 套 uv。我们只需要第一套就好
-        if (ai_mesh.HasTextureCoords(0))
-        {
-            for (int i = 0; i < vert_num; ++i)
-            {
-                mesh->vertices[i].uv = to_vec3(ai_mesh.mTextureCoords[0][i]);
-            }
-        }
+    /**
+     * 根据几何描述以及转换之后的顶点创建 GPU 资源，加入批量上传
+     */
+    std::unique_ptr<Mesh2> _get_geometry(GeometryArena::UploadBatch& batch, const MeshDesc& mesh_desc,
+                                         const ConvertedMesh& converted)
+    {
+        const void* vertex_data = mesh_desc.vertex_data();
+        if (vertex_format == VertexFormat::Packed)
+            vertex_data = converted.packed.data();
+        else if (vertex_format == VertexFormat::Quantized)
+            vertex_data = converted.quantized.data();
 
-        mesh->create_buffer(engine);
+        std::unique_ptr<Mesh2> mesh{new Mesh2()};
+        mesh->create_buffer(batch, mesh_desc, vertex_format, vertex_data, converted.quantization);
         return mesh;
     }
 
 
 public:
-    std::unique_ptr<ModelNode> root_node;
+    std::unique_ptr<ModelNode>         root_node;
+    std::vector<std::shared_ptr<Matt>> materials;    // 按照材质的索引排列
 
 
 private:
@@ -388,6 +479,12 @@ private:
     const std::filesystem::path mesh_path;    // mesh 文件对应的路径
     const std::filesystem::path dir_path;     // mesh 文件所在的文件夹，形式："xx/xxx"
 
-    const aiScene* scene{};
+    const VertexFormat    vertex_format;
+    VertexPack::PackError pack_error;    // 所有 mesh 中的最大误差
+
+    // 加载过程中的临时数据，按照 mesh 的索引排列；mesh 创建之后移动到节点中
+    std::vector<ConvertedMesh>          _converted;
+    std::vector<std::shared_ptr<Mesh2>> meshes;
+    double                              _convert_ms = 0.0;
 };
 }    // namespace Hiss
\ No newline at end of file
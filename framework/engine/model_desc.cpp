@@ -0,0 +1,513 @@
+#include "engine/model_desc.hpp"
+#include "utils/mesh_optimizer.hpp"
+
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <fmt/format.h>
+#include <assimp/scene.h>
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+
+
+namespace
+{
+
+const char MODEL_MAGIC[4] = {'H', 'M', 'D', 'L'};
+
+
+/**
+ * 将 Assimp 的 vec3 转换为 glm 的 vec3
+ */
+glm::vec3 to_vec3(const aiVector3D& vec)
+{
+    return {vec.x, vec.y, vec.z};
+}
+
+glm::vec4 to_vec4(const aiColor4D& color)
+{
+    return {color.r, color.g, color.b, color.a};
+}
+
+/**
+ * 将 Assimp 的矩阵转化为 glm 的矩阵
+ * @details Assimp 的矩阵是 row-major 的，a 表示第 1 行，d 表示第 4 行
+ * @details glm 的矩阵是 column-major 的
+ */
+glm::mat4 to_mat4(const aiMatrix4x4& mat)
+{
+    return glm::mat4{mat.a1, mat.b1, mat.c1, mat.d1,     // 第 1 列
+                     mat.a2, mat.b2, mat.c2, mat.d2,     // 第 2 列
+                     mat.a3, mat.b3, mat.c3, mat.d3,     // 第 3 列
+                     mat.a4, mat.b4, mat.c4, mat.d4};    // 第 4 列
+}
+
+
+/**
+ * 从 aiMaterial 中提取出特定类型纹理的相对路径
+ */
+std::string get_texture(const aiMaterial& ai_mat, aiTextureType tex_type)
+{
+    if (ai_mat.GetTextureCount(tex_type) == 0)
+        return {};
+
+    aiString out_path;    // 获取到的是相对路径
+    ai_mat.GetTexture(tex_type, 0, &out_path);
+    return out_path.C_Str();
+}
+
+
+Hiss::MaterialDesc get_material(const aiMaterial& ai_mat)
+{
+    Hiss::MaterialDesc mat;
+
+    // 提取出各种颜色
+    aiColor4D out_color;
+    if (ai_mat.Get(AI_MATKEY_COLOR_DIFFUSE, out_color) == aiReturn_SUCCESS)
+        mat.color_diffuse = to_vec4(out_color);
+    if (ai_mat.Get(AI_MATKEY_COLOR_AMBIENT, out_color) == aiReturn_SUCCESS)
+        mat.color_ambient = to_vec4(out_color);
+    if (ai_mat.Get(AI_MATKEY_COLOR_SPECULAR, out_color) == aiReturn_SUCCESS)
+        mat.color_specular = to_vec4(out_color);
+    if (ai_mat.Get(AI_MATKEY_COLOR_EMISSIVE, out_color) == aiReturn_SUCCESS)
+        mat.color_emissive = to_vec4(out_color);
+
+    // 提取出各种纹理
+    mat.tex_diffuse  = get_texture(ai_mat, aiTextureType_DIFFUSE);
+    mat.tex_ambient  = get_texture(ai_mat, aiTextureType_AMBIENT);
+    mat.tex_specular = get_texture(ai_mat, aiTextureType_SPECULAR);
+    mat.tex_emissive = get_texture(ai_mat, aiTextureType_EMISSIVE);
+
+    return mat;
+}
+
+
+/**
+ * 将 Assimp 的 SoA 数组交错写入 AoS 的 Vertex3D
+ * @details 单个循环同时写入一个顶点的所有属性，循环内没有分支（是否有 uv 在编译期确定），
+ *  并且通过 __restrict 告诉编译器源和目标不重叠，编译器可以自动向量化
+ */
+template<bool has_uv>
+void interleave_vertices(const aiMesh& ai_mesh, Hiss::Vertex3D* __restrict dst)
+{
+    const aiVector3D* __restrict position  = ai_mesh.mVertices;
+    const aiVector3D* __restrict normal    = ai_mesh.mNormals;
+    const aiVector3D* __restrict tangent   = ai_mesh.mTangents;
+    const aiVector3D* __restrict bitangent = ai_mesh.mBitangents;
+    const aiVector3D* __restrict uv        = ai_mesh.mTextureCoords[0];
+
+    for (uint32_t i = 0, n = ai_mesh.mNumVertices; i < n; ++i)
+    {
+        dst[i].position  = to_vec3(position[i]);
+        dst[i].normal    = to_vec3(normal[i]);
+        dst[i].tangent   = to_vec3(tangent[i]);
+        dst[i].bitangent = to_vec3(bitangent[i]);
+        if constexpr (has_uv)
+            dst[i].uv = glm::vec2(uv[i].x, uv[i].y);
+        else
+            dst[i].uv = glm::vec2(0.f);
+    }
+}
+
+
+/**
+ * 从 aiMesh 中提取几何信息
+ */
+Hiss::MeshDesc get_geometry(const aiMesh& ai_mesh)
+{
+    Hiss::MeshDesc mesh;
+    mesh.material = ai_mesh.mMaterialIndex;
+
+    auto vert_num = ai_mesh.mNumVertices;
+    mesh.vertices.resize(vert_num);
+
+    auto face_num = ai_mesh.mNumFaces;
+    mesh.faces.resize(face_num);
+
+    // faces
+    for (uint32_t i = 0; i < face_num; ++i)
+    {
+        // 通过 Assimp 的 post-process 保证了这里的 face 都是 triangle
+        assert(ai_mesh.mFaces[i].mNumIndices == 3);
+        mesh.faces[i] = {
+                ai_mesh.mFaces[i].mIndices[0],
+                ai_mesh.mFaces[i].mIndices[1],
+                ai_mesh.mFaces[i].mIndices[2],
+        };
+    }
+
+    // 通过 Assimp 的 post-process 保证了一定会有 normal，tangent
+    assert(ai_mesh.HasNormals() && ai_mesh.HasTangentsAndBitangents());
+
+
+    // vertices；uv: Assimp 最多支持 8 套 uv。我们只需要第一套就好
+    if (ai_mesh.HasTextureCoords(0))
+        interleave_vertices<true>(ai_mesh, mesh.vertices.data());
+    else
+        interleave_vertices<false>(ai_mesh, mesh.vertices.data());
+
+    return mesh;
+}
+
+
+/**
+ * 递归地处理节点，节点中包括多个 mesh，包含子节点
+ */
+Hiss::NodeDesc get_node(const aiNode& ai_node)
+{
+    Hiss::NodeDesc node;
+    node.relative_matrix = to_mat4(ai_node.mTransformation);
+    node.meshes.assign(ai_node.mMeshes, ai_node.mMeshes + ai_node.mNumMeshes);
+
+    node.children.reserve(ai_node.mNumChildren);
+    for (uint32_t i = 0; i < ai_node.mNumChildren; ++i)
+        node.children.push_back(get_node(*ai_node.mChildren[i]));
+
+    return node;
+}
+
+
+/**
+ * 依次进行 vertex cache，overdraw（可选），vertex fetch 的优化
+ * @return 优化前后的 cache 统计数据
+ */
+std::pair<Hiss::MeshOptimizer::CacheStats, Hiss::MeshOptimizer::CacheStats> optimize_mesh(Hiss::MeshDesc& mesh,
+                                                                                          bool overdraw)
+{
+    // FaceTriangle 由 3 个 uint32_t 紧密排列，可以直接视为索引数组
+    auto*  indices    = reinterpret_cast<uint32_t*>(mesh.faces.data());
+    size_t index_num  = mesh.faces.size() * 3;
+    size_t vertex_num = mesh.vertices.size();
+
+    auto before = Hiss::MeshOptimizer::analyze_vertex_cache(indices, index_num, vertex_num);
+
+    Hiss::MeshOptimizer::optimize_vertex_cache(indices, index_num, vertex_num);
+    if (overdraw && vertex_num > 0)
+        Hiss::MeshOptimizer::optimize_overdraw(indices, index_num, &mesh.vertices[0].position.x,
+                                               sizeof(Hiss::Vertex3D), vertex_num);
+    auto remap = Hiss::MeshOptimizer::optimize_vertex_fetch(indices, index_num, vertex_num);
+    Hiss::MeshOptimizer::remap_vertices(mesh.vertices, remap);
+
+    auto after = Hiss::MeshOptimizer::analyze_vertex_cache(indices, index_num, mesh.vertices.size());
+    return {before, after};
+}
+
+
+// 顶点和索引数据在文件中的对齐
+const size_t BLOB_ALIGNMENT = 16;
+
+// 节点层级的上限，损坏的文件不会导致递归时栈溢出
+const uint32_t MAX_NODE_DEPTH = 1024;
+
+
+// 二进制文件的写入
+struct Writer
+{
+    std::ofstream file;
+    size_t        offset = 0;
+
+    void bytes(const void* src, size_t size)
+    {
+        file.write(reinterpret_cast<const char*>(src), (std::streamsize) size);
+        offset += size;
+    }
+
+    template<typename T>
+    void pod(const T& value)
+    {
+        bytes(&value, sizeof(T));
+    }
+
+    // 写入数量之后对齐，这样数据本身的起点是对齐的
+    template<typename T>
+    void blob(const T* values, size_t count)
+    {
+        pod((uint32_t) count);
+        const char zeros[BLOB_ALIGNMENT] = {};
+        bytes(zeros, (BLOB_ALIGNMENT - offset % BLOB_ALIGNMENT) % BLOB_ALIGNMENT);
+        bytes(values, count * sizeof(T));
+    }
+
+    template<typename T>
+    void array(const std::vector<T>& values)
+    {
+        pod((uint32_t) values.size());
+        bytes(values.data(), values.size() * sizeof(T));
+    }
+
+    void string(const std::string& str)
+    {
+        pod((uint32_t) str.size());
+        bytes(str.data(), str.size());
+    }
+
+    void node(const Hiss::NodeDesc& node)
+    {
+        pod(node.relative_matrix);
+        array(node.meshes);
+        pod((uint32_t) node.children.size());
+        for (auto& child: node.children)
+            this->node(child);
+    }
+};
+
+
+// 二进制文件的读取，越界时抛出异常
+struct Reader
+{
+    const uint8_t* data   = nullptr;
+    size_t         size   = 0;
+    size_t         offset = 0;
+
+    const uint8_t* skip(size_t count)
+    {
+        if (offset + count > size)
+            throw std::runtime_error("[model desc] unexpected end of file");
+        auto ptr = data + offset;
+        offset += count;
+        return ptr;
+    }
+
+    void bytes(void* dst, size_t count) { std::memcpy(dst, skip(count), count); }
+
+    template<typename T>
+    T pod()
+    {
+        T value;
+        bytes(&value, sizeof(T));
+        return value;
+    }
+
+    // 不拷贝数据，直接返回指向文件内容的指针
+    template<typename T>
+    const T* blob(size_t& count)
+    {
+        count = pod<uint32_t>();
+        skip((BLOB_ALIGNMENT - offset % BLOB_ALIGNMENT) % BLOB_ALIGNMENT);
+        return reinterpret_cast<const T*>(skip(count * sizeof(T)));
+    }
+
+    // 元素的数量，每个元素至少占用 min_size 个字节：在分配内存之前拒绝损坏的数量
+    uint32_t count(size_t min_size)
+    {
+        auto num = pod<uint32_t>();
+        if ((size_t) num * min_size > size - offset)
+            throw std::runtime_error("[model desc] invalid element count");
+        return num;
+    }
+
+    template<typename T>
+    void array(std::vector<T>& values)
+    {
+        values.resize(count(sizeof(T)));
+        bytes(values.data(), values.size() * sizeof(T));
+    }
+
+    std::string string()
+    {
+        std::string str(count(1), '\0');
+        bytes(str.data(), str.size());
+        return str;
+    }
+
+    // mesh_num 用于检查节点引用的 mesh 索引
+    void node(Hiss::NodeDesc& node, size_t mesh_num, uint32_t depth = 0)
+    {
+        if (depth > MAX_NODE_DEPTH)
+            throw std::runtime_error("[model desc] node hierarchy too deep");
+
+        node.relative_matrix = pod<glm::mat4>();
+        array(node.meshes);
+        for (auto mesh_index: node.meshes)
+            if (mesh_index >= mesh_num)
+                throw std::runtime_error(fmt::format("[model desc] invalid mesh index: {}", mesh_index));
+
+        node.children.resize(count(sizeof(glm::mat4) + 2 * sizeof(uint32_t)));
+        for (auto& child: node.children)
+            this->node(child, mesh_num, depth + 1);
+    }
+};
+
+}    // namespace
+
+
+Hiss::ModelDesc Hiss::ModelDesc::import(const std::filesystem::path& path, bool optimize, JobSystem* jobs)
+{
+    // importer 析构时，会自动回收资源
+    Assimp::Importer assimp_impoter;
+
+    /**
+     * Assimp 导入的后处理操作
+     * @details 默认坐标系是右手系：+x = right, +y = up, +z 朝向观察方向，可以通过 MakeLeftHanded 标志来修改
+     * @details 默认三角形环绕方向是 CCW，可以通过 FlipWindingOrder 标志来修改
+     * @details 默认 UV 以左下角为原点，可以通过 FlipUVs 标志修改为左上角
+     * @details 默认矩阵采用 row major 的存储方式
+     * @flag calcTangentSpace 如果顶点具有法线属性，自动生成 tangent space 属性
+     * @flag JoinIdenticalVertices 如果没有这个 flag，那么渲染时是不需要 index buffer 的
+     * @flag Triangulate 将所有的面三角化
+     * @flag GenNormals 如果没有法线，自动生成面法线
+     * @flag SortByPType 在三角化之后发生，可以去除 point 和 line
+     */
+    auto post_process_flags = aiProcess_CalcTangentSpace | aiProcess_JoinIdenticalVertices | aiProcess_Triangulate
+                            | aiProcess_GenNormals | aiProcess_SortByPType | aiProcess_FlipUVs;
+
+
+    /**
+     * 载入模型文件
+     * @参考 Assimp 的文档：https://assimp-docs.readthedocs.io/en/v5.1.0/usage/use_the_lib.html
+     */
+    const aiScene* scene = assimp_impoter.ReadFile(path.string(), post_process_flags);
+    if (!scene || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) || !scene->mRootNode)
+    {
+        spdlog::error("{}", assimp_impoter.GetErrorString());
+        throw std::runtime_error("fail to _load obj file: " + path.string());
+    }
+
+
+    ModelDesc desc;
+    desc.materials.reserve(scene->mNumMaterials);
+    for (uint32_t i = 0; i < scene->mNumMaterials; ++i)
+        desc.materials.push_back(get_material(*scene->mMaterials[i]));
+
+    // 各个 mesh 之间相互独立，scene 是只读的：转换以及优化索引和顶点的顺序可以并行进行
+    using CacheStatsPair = std::pair<MeshOptimizer::CacheStats, MeshOptimizer::CacheStats>;
+    std::vector<CacheStatsPair> mesh_stats(scene->mNumMeshes);
+    desc.meshes.resize(scene->mNumMeshes);
+    auto process_meshes = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            desc.meshes[i] = get_geometry(*scene->mMeshes[i]);
+            mesh_stats[i]  = optimize_mesh(desc.meshes[i], optimize);
+        }
+    };
+    if (jobs)
+        jobs->parallel_for(0, scene->mNumMeshes, 1, process_meshes);
+    else
+        process_meshes(0, scene->mNumMeshes);
+
+
+    // 统计整个模型优化前后的 ACMR 以及 ATVR（按照三角形数量、顶点数量加权）
+    MeshOptimizer::CacheStats before, after;
+    size_t                    tri_sum = 0, vert_sum = 0;
+    for (size_t i = 0; i < desc.meshes.size(); ++i)
+    {
+        auto& mesh   = desc.meshes[i];
+        auto& [b, a] = mesh_stats[i];
+        before.acmr += b.acmr * (float) mesh.faces.size();
+        before.atvr += b.atvr * (float) mesh.vertices.size();
+        after.acmr += a.acmr * (float) mesh.faces.size();
+        after.atvr += a.atvr * (float) mesh.vertices.size();
+        tri_sum += mesh.faces.size();
+        vert_sum += mesh.vertices.size();
+    }
+    if (tri_sum > 0 && vert_sum > 0)
+        spdlog::info("[mesh optimizer] {}: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", path.filename().string(),
+                     before.acmr / (float) tri_sum, after.acmr / (float) tri_sum, before.atvr / (float) vert_sum,
+                     after.atvr / (float) vert_sum);
+
+    desc.root = get_node(*scene->mRootNode);
+    return desc;
+}
+
+
+Hiss::ModelDesc Hiss::ModelDesc::load(const std::filesystem::path& path)
+{
+    ModelDesc desc;
+    desc.mapped_file = std::make_shared<MappedFile>(path);
+
+    Reader reader{.data = desc.mapped_file->data(), .size = desc.mapped_file->size()};
+
+
+    char magic[4];
+    reader.bytes(magic, sizeof(magic));
+    if (std::memcmp(magic, MODEL_MAGIC, sizeof(magic)) != 0 || reader.pod<uint32_t>() != VERSION)
+        throw std::runtime_error(fmt::format("[model desc] invalid file or version mismatch: {}", path.string()));
+
+
+    /**
+     * 文件可能是旧的、损坏的，或者写入到一半的：所有的数量以及索引都需要检查，失败时抛出异常，
+     * 调用者会退回到重新导入
+     */
+    desc.materials.resize(reader.count(sizeof(glm::vec4) * 4 + sizeof(uint32_t) * 4));
+    for (auto& mat: desc.materials)
+    {
+        mat.color_ambient  = reader.pod<glm::vec4>();
+        mat.color_diffuse  = reader.pod<glm::vec4>();
+        mat.color_specular = reader.pod<glm::vec4>();
+        mat.color_emissive = reader.pod<glm::vec4>();
+        mat.tex_diffuse    = reader.string();
+        mat.tex_ambient    = reader.string();
+        mat.tex_specular   = reader.string();
+        mat.tex_emissive   = reader.string();
+    }
+
+    desc.meshes.resize(reader.count(sizeof(uint32_t) * 3));
+    for (auto& mesh: desc.meshes)
+    {
+        mesh.material        = reader.pod<uint32_t>();
+        mesh.mapped_vertices = reader.blob<Vertex3D>(mesh.mapped_vertex_num);
+        mesh.mapped_faces    = reader.blob<FaceTriangle>(mesh.mapped_face_num);
+        if (mesh.material >= desc.materials.size())
+            throw std::runtime_error(fmt::format("[model desc] invalid material index: {}", path.string()));
+
+        // 越界的索引会直接到达 GPU
+        auto     indices   = reinterpret_cast<const uint32_t*>(mesh.mapped_faces);
+        uint32_t max_index = 0;
+        for (size_t i = 0; i < mesh.mapped_face_num * 3; ++i)
+            max_index = std::max(max_index, indices[i]);
+        if (mesh.mapped_face_num > 0 && max_index >= mesh.mapped_vertex_num)
+            throw std::runtime_error(fmt::format("[model desc] invalid vertex index: {}", path.string()));
+    }
+
+    reader.node(desc.root, desc.meshes.size());
+    if (reader.offset != reader.size)
+        throw std::runtime_error(fmt::format("[model desc] unexpected data at end of file: {}", path.string()));
+    return desc;
+}
+
+
+void Hiss::ModelDesc::save(const std::filesystem::path& path) const
+{
+    std::filesystem::create_directories(path.parent_path());
+
+    // 先写入临时文件再重命名，写入到一半时崩溃不会留下头部完整、内容被截断的文件
+    auto   temp_path = std::filesystem::path(path.string() + ".tmp");
+    Writer writer{std::ofstream(temp_path, std::ios::binary | std::ios::trunc)};
+    if (!writer.file.is_open())
+        throw std::runtime_error(fmt::format("[model desc] failed to write file: {}", temp_path.string()));
+
+    writer.bytes(MODEL_MAGIC, sizeof(MODEL_MAGIC));
+    writer.pod(VERSION);
+
+    writer.pod((uint32_t) materials.size());
+    for (auto& mat: materials)
+    {
+        writer.pod(mat.color_ambient);
+        writer.pod(mat.color_diffuse);
+        writer.pod(mat.color_specular);
+        writer.pod(mat.color_emissive);
+        writer.string(mat.tex_diffuse);
+        writer.string(mat.tex_ambient);
+        writer.string(mat.tex_specular);
+        writer.string(mat.tex_emissive);
+    }
+
+    writer.pod((uint32_t) meshes.size());
+    for (auto& mesh: meshes)
+    {
+        writer.pod(mesh.material);
+        writer.blob(mesh.vertex_data(), mesh.vertex_num());
+        writer.blob(mesh.face_data(), mesh.face_num());
+    }
+
+    writer.node(root);
+
+    writer.file.close();
+    if (writer.file.fail())
+    {
+        std::error_code ec;
+        std::filesystem::remove(temp_path, ec);
+        throw std::runtime_error(fmt::format("[model desc] failed to write file: {}", temp_path.string()));
+    }
+    std::filesystem::rename(temp_path, path);
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <filesystem>
+
+#include "engine/vertex.hpp"
+#include "engine/vertex_buffer.hpp"
+#include "utils/mapped_file.hpp"
+#include "utils/job_system.hpp"
+
+
+namespace Hiss
+{
+
+/**
+ * 材质的 CPU 端描述，不包含任何 GPU 资源
+ * @details 纹理路径是相对于模型文件所在文件夹的路径，为空表示没有该纹理
+ */
+struct MaterialDesc
+{
+    glm::vec4 color_ambient{0.f};
+    glm::vec4 color_diffuse{0.f};
+    glm::vec4 color_specular{0.f};
+    glm::vec4 color_emissive{0.f};
+
+    std::string tex_diffuse;
+    std::string tex_ambient;
+    std::string tex_specular;
+    std::string tex_emissive;
+};
+
+
+/**
+ * 几何信息的 CPU 端描述
+ * @details 导入时数据保存在 vertices 和 faces 中；从 mapped file 读取时，数据直接指向文件的内容，不进行拷贝
+ * @details 使用 vertex_data() 以及 face_data() 来访问数据，不需要关心数据来自哪里
+ */
+struct MeshDesc
+{
+    std::vector<Vertex3D>     vertices;
+    std::vector<FaceTriangle> faces;
+    uint32_t                  material = 0;    // 在 ModelDesc::materials 中的索引
+
+    const Vertex3D*     mapped_vertices   = nullptr;
+    const FaceTriangle* mapped_faces      = nullptr;
+    size_t              mapped_vertex_num = 0;
+    size_t              mapped_face_num   = 0;
+
+
+    const Vertex3D*     vertex_data() const { return mapped_vertices ? mapped_vertices : vertices.data(); }
+    size_t              vertex_num() const { return mapped_vertices ? mapped_vertex_num : vertices.size(); }
+    const FaceTriangle* face_data() const { return mapped_faces ? mapped_faces : faces.data(); }
+    size_t              face_num() const { return mapped_faces ? mapped_face_num : faces.size(); }
+};
+
+
+/**
+ * 场景节点的 CPU 端描述
+ */
+struct NodeDesc
+{
+    glm::mat4             relative_matrix{1.f};
+    std::vector<uint32_t> meshes;    // 在 ModelDesc::meshes 中的索引
+    std::vector<NodeDesc> children;
+};
+
+
+/**
+ * 模型的 CPU 端描述：可以通过 Assimp 导入，也可以从二进制文件（cook 的产物，或者运行时的缓存）中读取
+ * @details 二进制文件是 little-endian 的，直接按照内存布局写入顶点和索引，读取时不需要任何转换
+ * @details 顶点和索引数据在文件中按照 16 byte 对齐，读取时通过 mmap 直接访问
+ */
+struct ModelDesc
+{
+    std::vector<MeshDesc>     meshes;
+    std::vector<MaterialDesc> materials;
+    NodeDesc                  root;
+
+    // 从文件中读取时，持有 mapped file，确保 MeshDesc 中的指针有效
+    std::shared_ptr<MappedFile> mapped_file;
+
+
+    /**
+     * 使用 Assimp 导入模型文件，会生成 tangent space，合并相同的顶点，并三角化
+     * @details 导入之后会对三角形进行 vertex cache 优化，并按照读取顺序重排顶点，参考 MeshOptimizer
+     * @param optimize 是否额外进行 overdraw 的优化（导入会变慢，适合离线使用）
+     * @param jobs 不为空时，各个 mesh 的转换以及优化并行进行
+     */
+    static ModelDesc import(const std::filesystem::path& path, bool optimize = false, JobSystem* jobs = nullptr);
+
+
+    /**
+     * 通过 mmap 读取二进制文件，版本不匹配或者文件损坏时抛出 std::runtime_error
+     * @details 只解析层级结构和材质，顶点和索引直接指向 mapped file
+     */
+    static ModelDesc load(const std::filesystem::path& path);
+
+
+    /**
+     * 写入二进制文件
+     */
+    void save(const std::filesystem::path& path) const;
+
+
+    // 二进制文件的版本，格式发生变化时需要增加
+    static constexpr uint32_t VERSION = 3;
+};
+
+}    // namespace Hiss
@@ -0,0 +1,92 @@
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+
+
+namespace Hiss
+{
+
+/**
+ * 可以被 Defragmenter 移动到新内存位置的资源：Buffer 以及 Image2D
+ * @details 移动之后 vulkan handle 会改变。保存了旧 handle 的使用者需要注册 listener，
+ *  例如 DescriptorSet 会在 listener 中重新写入 descriptor
+ * @details 默认不可移动：只有确认所有使用者都会重新获取 handle，或者注册了 listener 时，才应该设置 movable
+ */
+class Relocatable
+{
+public:
+    enum class Kind
+    {
+        Buffer,
+        Image,
+    };
+
+
+    explicit Relocatable(Kind kind)
+        : relocatable_kind(kind)
+    {}
+
+
+    /**
+     * 资源被移动之后调用 listener
+     * @param owner listener 的生命周期，owner 析构之后 listener 不会再被调用，因此不需要手动移除
+     */
+    void add_relocation_listener(const std::shared_ptr<void>& owner, std::function<void()> listener)
+    {
+        _listeners.push_back({owner, std::move(listener)});
+    }
+
+
+    const Kind relocatable_kind;
+    bool       movable = false;
+
+    /**
+     * 由 Defragmenter 设置：handle 已经替换，但是 VMA 的这一轮移动还没有结束
+     * @details 资源在此期间被销毁时调用，Defragmenter 会让 VMA 在这一轮结束时释放 allocation
+     */
+    std::function<void(Relocatable*)> relocation_abort;
+
+
+protected:
+    /**
+     * 在析构函数中调用：返回 true 表示 allocation 已经交给 Defragmenter 释放，只需要销毁 handle
+     */
+    bool _abort_relocation()
+    {
+        if (!relocation_abort)
+            return false;
+
+        auto abort       = std::move(relocation_abort);
+        relocation_abort = nullptr;
+        abort(this);
+        return true;
+    }
+
+
+    void _notify_relocated()
+    {
+        // 移除已经失效的 listener；listener 中可能会注册新的 listener，因此先复制一份
+        _listeners.erase(std::remove_if(_listeners.begin(), _listeners.end(),
+                                        [](const Listener& listener) { return listener.owner.expired(); }),
+                         _listeners.end());
+
+        auto listeners = _listeners;
+        for (auto& listener: listeners)
+            if (auto owner = listener.owner.lock())
+                listener.callback();
+    }
+
+
+private:
+    struct Listener
+    {
+        std::weak_ptr<void>   owner;
+        std::function<void()> callback;
+    };
+
+    std::vector<Listener> _listeners;
+};
+
+}    // namespace Hiss
@@ -0,0 +1,292 @@
+#include "engine/resource_registry.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <utility>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+
+std::mutex                                                 Hiss::ResourceRegistry::_registry_mutex;
+std::unordered_map<VmaAllocator, Hiss::ResourceRegistry*> Hiss::ResourceRegistry::_registry;
+
+
+namespace
+{
+
+thread_local std::string g_current_owner;
+
+
+double to_mb(vk::DeviceSize bytes)
+{
+    return (double) bytes / 1024.0 / 1024.0;
+}
+
+}    // namespace
+
+
+const char* Hiss::to_string(ResourceCategory category)
+{
+    switch (category)
+    {
+        case ResourceCategory::Geometry: return "geometry";
+        case ResourceCategory::Texture: return "texture";
+        case ResourceCategory::Attachment: return "attachment";
+        case ResourceCategory::Uniform: return "uniform";
+        case ResourceCategory::Storage: return "storage";
+        case ResourceCategory::Staging: return "staging";
+        default: return "other";
+    }
+}
+
+
+Hiss::ResourceRegistry::OwnerScope::OwnerScope(std::string owner)
+    : _prev(std::exchange(g_current_owner, std::move(owner)))
+{}
+
+
+Hiss::ResourceRegistry::OwnerScope::~OwnerScope()
+{
+    g_current_owner = std::move(_prev);
+}
+
+
+const std::string& Hiss::ResourceRegistry::OwnerScope::current()
+{
+    return g_current_owner;
+}
+
+
+Hiss::ResourceRegistry::ResourceRegistry(VmaAllocator allocator)
+    : _allocator(allocator)
+{
+    const VkPhysicalDeviceMemoryProperties* memory_properties = nullptr;
+    vmaGetMemoryProperties(_allocator, &memory_properties);
+    _heap_warned.resize(memory_properties->memoryHeapCount, false);
+
+    std::lock_guard<std::mutex> lock(_registry_mutex);
+    _registry[allocator] = this;
+}
+
+
+Hiss::ResourceRegistry::~ResourceRegistry()
+{
+    {
+        std::lock_guard<std::mutex> lock(_registry_mutex);
+        _registry.erase(_allocator);
+    }
+
+    // 这时候仍然存在的资源都是泄漏
+    for (auto& [key, record]: _records)
+        spdlog::warn("[resource registry] leak: {} ({}, {:.2f} MB, owner: {})", record.name,
+                     to_string(record.category), to_mb(record.size), record.owner);
+}
+
+
+Hiss::ResourceRegistry* Hiss::ResourceRegistry::find(VmaAllocator allocator)
+{
+    std::lock_guard<std::mutex> lock(_registry_mutex);
+    auto                        iter = _registry.find(allocator);
+    return iter == _registry.end() ? nullptr : iter->second;
+}
+
+
+void Hiss::ResourceRegistry::add(VmaAllocator allocator, const void* key, ResourceRecord record,
+                                 const VmaAllocationInfo& alloc_info)
+{
+    auto* registry = find(allocator);
+    if (!registry)
+        return;
+
+    const VkPhysicalDeviceMemoryProperties* memory_properties = nullptr;
+    vmaGetMemoryProperties(allocator, &memory_properties);
+
+    record.owner      = OwnerScope::current();
+    record.size       = alloc_info.size;
+    record.memory     = alloc_info.deviceMemory;
+    record.heap_index = memory_properties->memoryTypes[alloc_info.memoryType].heapIndex;
+
+    std::lock_guard<std::mutex> lock(registry->_mutex);
+    record.create_frame     = registry->_frame_index;
+    registry->_records[key] = std::move(record);
+}
+
+
+void Hiss::ResourceRegistry::remove(VmaAllocator allocator, const void* key)
+{
+    auto* registry = find(allocator);
+    if (!registry)
+        return;
+
+    std::lock_guard<std::mutex> lock(registry->_mutex);
+    registry->_records.erase(key);
+}
+
+
+void Hiss::ResourceRegistry::relocate(VmaAllocator allocator, const void* old_key, const void* new_key,
+                                      const VmaAllocationInfo& alloc_info)
+{
+    auto* registry = find(allocator);
+    if (!registry)
+        return;
+
+    std::lock_guard<std::mutex> lock(registry->_mutex);
+    auto                        node = registry->_records.extract(old_key);
+    if (node.empty())
+        return;
+
+    node.key()           = new_key;
+    node.mapped().memory = alloc_info.deviceMemory;
+    registry->_records.insert(std::move(node));
+}
+
+
+Hiss::ResourceCategory Hiss::ResourceRegistry::buffer_category(vk::BufferUsageFlags usage)
+{
+    if (usage & (vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer))
+        return ResourceCategory::Geometry;
+    if (usage == vk::BufferUsageFlagBits::eTransferSrc)
+        return ResourceCategory::Staging;
+    if (usage & vk::BufferUsageFlagBits::eUniformBuffer)
+        return ResourceCategory::Uniform;
+    if (usage & vk::BufferUsageFlagBits::eStorageBuffer)
+        return ResourceCategory::Storage;
+    return ResourceCategory::Other;
+}
+
+
+Hiss::ResourceCategory Hiss::ResourceRegistry::image_category(vk::ImageUsageFlags usage)
+{
+    if (usage
+        & (vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eDepthStencilAttachment
+           | vk::ImageUsageFlagBits::eStorage))
+        return ResourceCategory::Attachment;
+    if (usage & vk::ImageUsageFlagBits::eSampled)
+        return ResourceCategory::Texture;
+    return ResourceCategory::Other;
+}
+
+
+void Hiss::ResourceRegistry::_heap_stats(Totals& totals) const
+{
+    const VkPhysicalDeviceMemoryProperties* memory_properties = nullptr;
+    vmaGetMemoryProperties(_allocator, &memory_properties);
+
+    std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets;
+    vmaGetHeapBudgets(_allocator, budgets.data());
+
+    totals.heap_num = memory_properties->memoryHeapCount;
+    for (uint32_t i = 0; i < totals.heap_num; ++i)
+    {
+        totals.heaps[i].budget       = budgets[i].budget;
+        totals.heaps[i].usage        = budgets[i].usage;
+        totals.heaps[i].device_local = memory_properties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+    }
+}
+
+
+Hiss::ResourceRegistry::Totals Hiss::ResourceRegistry::totals() const
+{
+    Totals totals;
+    _heap_stats(totals);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto& [key, record]: _records)
+    {
+        totals.heaps[record.heap_index].resource_bytes += record.size;
+        totals.category_bytes[(size_t) record.category] += record.size;
+        totals.category_num[(size_t) record.category]++;
+        totals.resource_num++;
+    }
+    return totals;
+}
+
+
+void Hiss::ResourceRegistry::update(uint64_t frame_index)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _frame_index = frame_index;
+    }
+    vmaSetCurrentFrameIndex(_allocator, (uint32_t) frame_index);
+
+
+    // 只在超过阈值，以及回落到阈值以下时输出日志，避免每一帧都刷屏；每一帧都会调用，不分配内存
+    Totals totals;
+    _heap_stats(totals);
+    auto& heaps = totals.heaps;
+    for (uint32_t i = 0; i < totals.heap_num; ++i)
+    {
+        if (heaps[i].budget == 0)
+            continue;
+
+        bool over = (double) heaps[i].usage > (double) heaps[i].budget * warning_ratio;
+        if (over && !_heap_warned[i])
+            spdlog::warn("[resource registry] heap {} near budget: {:.1f} / {:.1f} MB", i, to_mb(heaps[i].usage),
+                         to_mb(heaps[i].budget));
+        else if (!over && _heap_warned[i])
+            spdlog::info("[resource registry] heap {} back under budget: {:.1f} / {:.1f} MB", i,
+                         to_mb(heaps[i].usage), to_mb(heaps[i].budget));
+        _heap_warned[i] = over;
+    }
+}
+
+
+void Hiss::ResourceRegistry::dump(const std::filesystem::path& path) const
+{
+    auto totals = this->totals();
+
+    std::vector<ResourceRecord> records;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        records.reserve(_records.size());
+        for (auto& [key, record]: _records)
+            records.push_back(record);
+    }
+    std::sort(records.begin(), records.end(), [](auto& a, auto& b) { return a.size > b.size; });
+
+
+    // 只有一个资源使用的 VkDeviceMemory，视为 dedicated
+    std::unordered_map<VkDeviceMemory, uint32_t> memory_users;
+    for (auto& record: records)
+        memory_users[record.memory]++;
+
+
+    std::string text;
+    text += fmt::format("frame {}, {} resources\n\n", _frame_index, totals.resource_num);
+
+    text += "heap    device-local    usage(MB)    budget(MB)    resources(MB)\n";
+    for (uint32_t i = 0; i < totals.heap_num; ++i)
+    {
+        auto& heap = totals.heaps[i];
+        text += fmt::format("{:<8}{:<16}{:<13.1f}{:<14.1f}{:.1f}\n", i, heap.device_local ? "yes" : "no",
+                            to_mb(heap.usage), to_mb(heap.budget), to_mb(heap.resource_bytes));
+    }
+
+    text += "\ncategory      count    size(MB)\n";
+    for (size_t c = 0; c < CATEGORY_NUM; ++c)
+        text += fmt::format("{:<14}{:<9}{:.2f}\n", to_string((ResourceCategory) c), totals.category_num[c],
+                            to_mb(totals.category_bytes[c]));
+
+    text += "\nsize(MB)    category      heap  dedicated  frame    owner                    name  [usage]\n";
+    for (auto& record: records)
+        text += fmt::format("{:<12.3f}{:<14}{:<6}{:<11}{:<9}{:<25}{}  {}\n", to_mb(record.size),
+                            to_string(record.category), record.heap_index,
+                            memory_users[record.memory] == 1 ? "yes" : "no", record.create_frame,
+                            record.owner.empty() ? "-" : record.owner, record.name, record.usage);
+
+
+    std::ofstream file(path);
+    if (!file)
+    {
+        spdlog::error("[resource registry] fail to open {}", path.string());
+        return;
+    }
+    file << text;
+
+
+    for (uint32_t i = 0; i < totals.heap_num; ++i)
+        spdlog::info("[resource registry] heap {}: {:.1f} / {:.1f} MB", i, to_mb(totals.heaps[i].usage),
+                     to_mb(totals.heaps[i].budget));
+    spdlog::info("[resource registry] {} resources dumped to {}", totals.resource_num, path.string());
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include <array>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/vk_include.hpp"
+
+
+namespace Hiss
+{
+
+enum class ResourceCategory
+{
+    Geometry,      // vertex buffer，index buffer
+    Texture,       // 只被采样的 image
+    Attachment,    // render target，storage image
+    Uniform,
+    Storage,
+    Staging,       // 只用于 transfer src 的 buffer
+    Other,
+};
+
+const char* to_string(ResourceCategory category);
+
+
+/**
+ * 一个 Buffer 或者 Image2D 的显存占用
+ */
+struct ResourceRecord
+{
+    std::string      name;
+    std::string      owner;    // 创建资源时的 OwnerScope
+    ResourceCategory category = ResourceCategory::Other;
+    std::string      usage;
+    vk::DeviceSize   size         = 0;    // 实际分配的大小，包括对齐
+    uint32_t         heap_index   = 0;
+    VkDeviceMemory   memory       = VK_NULL_HANDLE;    // 用于判断是否独占一个 VkDeviceMemory
+    uint64_t         create_frame = 0;
+};
+
+
+/**
+ * 记录所有存活的 Buffer 以及 Image2D，并追踪每个 heap 的 budget
+ * @details 与 MemoryPolicy 一样，通过 allocator 找到 registry；没有 registry 时（例如离线工具）不进行记录
+ * @details 启用 VK_EXT_memory_budget 时，budget 以及 usage 来自驱动，包括其他进程的占用；否则是 VMA 的估计值
+ * @details 线程安全
+ */
+class ResourceRegistry
+{
+public:
+    explicit ResourceRegistry(VmaAllocator allocator);
+    ~ResourceRegistry();
+
+
+    static ResourceRegistry* find(VmaAllocator allocator);
+
+
+    /**
+     * 在 Buffer 以及 Image2D 的构造、析构中调用，key 为 vulkan handle
+     * @param record 调用者只需要填写 name，category 以及 usage，其他字段由 alloc_info 以及 OwnerScope 得到
+     */
+    static void add(VmaAllocator allocator, const void* key, ResourceRecord record,
+                    const VmaAllocationInfo& alloc_info);
+    static void remove(VmaAllocator allocator, const void* key);
+
+    /**
+     * 资源被 Defragmenter 移动之后调用：handle 以及 memory 改变，其他信息保持不变
+     */
+    static void relocate(VmaAllocator allocator, const void* old_key, const void* new_key,
+                         const VmaAllocationInfo& alloc_info);
+
+
+    static ResourceCategory buffer_category(vk::BufferUsageFlags usage);
+    static ResourceCategory image_category(vk::ImageUsageFlags usage);
+
+
+    /**
+     * 在当前线程中创建的资源都会记录 owner，可以嵌套
+     * @code
+     * ResourceRegistry::OwnerScope scope{"bloom pass"};
+     * @endcode
+     */
+    class OwnerScope
+    {
+    public:
+        explicit OwnerScope(std::string owner);
+        ~OwnerScope();
+
+        OwnerScope(const OwnerScope&)            = delete;
+        OwnerScope& operator=(const OwnerScope&) = delete;
+
+        static const std::string& current();
+
+    private:
+        std::string _prev;
+    };
+
+
+    static constexpr size_t CATEGORY_NUM = (size_t) ResourceCategory::Other + 1;
+
+
+    struct HeapStats
+    {
+        vk::DeviceSize budget         = 0;    // 当前进程可以使用的大小
+        vk::DeviceSize usage          = 0;    // 当前进程已经使用的大小
+        vk::DeviceSize resource_bytes = 0;    // registry 记录的资源大小
+        bool           device_local   = false;
+    };
+
+    // 固定大小的数组，每一帧查询时不需要分配内存
+    struct Totals
+    {
+        std::array<HeapStats, VK_MAX_MEMORY_HEAPS> heaps{};
+        uint32_t                                   heap_num = 0;
+        std::array<vk::DeviceSize, CATEGORY_NUM>   category_bytes{};
+        std::array<uint32_t, CATEGORY_NUM>         category_num{};
+        uint32_t                                   resource_num = 0;
+    };
+
+    Totals totals() const;
+
+
+    /**
+     * 每一帧调用一次：更新 VMA 的 frame index，查询 budget
+     * @details usage 超过 budget 的 warning_ratio 时给出警告；状态改变时才输出日志
+     */
+    void update(uint64_t frame_index);
+
+
+    /**
+     * 将所有资源按照大小降序写入到文件中，同时输出汇总信息
+     */
+    void dump(const std::filesystem::path& path) const;
+
+
+    float warning_ratio = 0.9f;
+
+
+private:
+    // 只查询每个 heap 的 budget 以及 usage，不遍历资源
+    void _heap_stats(Totals& totals) const;
+
+
+    VmaAllocator _allocator;
+    uint64_t     _frame_index = 0;
+
+    mutable std::mutex                              _mutex;
+    std::unordered_map<const void*, ResourceRecord> _records;
+    std::vector<bool>                               _heap_warned;
+
+    static std::mutex                                           _registry_mutex;
+    static std::unordered_map<VmaAllocator, ResourceRegistry*> _registry;
+};
+
+}    // namespace Hiss
@@ -1,20 +1,39 @@
 #include "swapchain.hpp"
 
-Hiss::Swapchain::Swapchain(Device& device, Window& window, vk::SurfaceKHR surface)
+
+namespace
+{
+
+// 每次 acquire 以及 wait for present 的超时，超时之后释放锁再重试
+constexpr uint64_t SWAPCHAIN_WAIT_SLICE_NS = 10'000'000;
+
+// FifoLowLatency 等待 present 的总时长，超过之后说明 presentation engine 出现了问题（例如窗口被遮挡）
+constexpr uint64_t PRESENT_WAIT_LIMIT_NS = 1'000'000'000;
+
+}    // namespace
+
+
+Hiss::Swapchain::Swapchain(Device& device, Window& window, vk::SurfaceKHR surface, const PresentConfig& config,
+                           vk::SwapchainKHR old_swapchain)
     : _device(device),
       _window(window),
-      _surface(surface)
+      _surface(surface),
+      _config(config)
 {
+    _present_wait = device.is_extension_enabled(VK_KHR_PRESENT_ID_EXTENSION_NAME)
+                 && device.is_extension_enabled(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+
     _present_format = _choose_present_format();
     _present_mode   = _choose_present_mode();
     present_extent  = _choose_surface_extent();
 
     spdlog::info("[swapchain] image format: {}", vk::to_string(_present_format.format));
     spdlog::info("[swapchain] colorspace: {}", vk::to_string(_present_format.colorSpace));
-    spdlog::info("[swapchain] present mode: {}", to_string(_present_mode));
+    spdlog::info("[swapchain] latency mode: {}, present mode: {}", to_string(_config.mode), to_string(_present_mode));
+    spdlog::info("[swapchain] present wait: {}, present thread: {}", _present_wait, _config.present_thread);
     spdlog::info("[swapchain] present extent: ({}, {})", present_extent._value.width, present_extent._value.height);
 
-    create_swapchain();
+    create_swapchain(old_swapchain);
     auto images = device.vkdevice().getSwapchainImagesKHR(_swapchain);
 
     // 在 swapchain 的 vkImage 的基础上创建应用自己的 image 对象
@@ -27,11 +46,18 @@ Hiss::Swapchain::Swapchain(Device& device, Window& window, vk::SurfaceKHR surfac
     }
 
     spdlog::info("[swapchain] image number: {}", _images2.size());
+
+    if (_config.present_thread)
+    {
+        _present_requests.reset(_images2.size());
+        _present_thread = std::thread(&Swapchain::_present_loop, this);
+    }
 }
 
 
 Hiss::Swapchain::~Swapchain()
 {
+    _stop_present_thread();
     _device.vkdevice().destroy(_swapchain);
     for (auto image: _images2)
         delete image;
@@ -59,22 +85,32 @@ vk::SurfaceFormatKHR Hiss::Swapchain::_choose_present_format()
 vk::PresentModeKHR Hiss::Swapchain::_choose_present_mode()
 {
     /**
-     * 优先选择 mailbox（不会画面撕裂，且延迟相对较低）；候补选择 fifo（不会造成画面撕裂）
+     * 根据 latency mode 选择：immediate 优先选择 immediate，其次是 mailbox；
+     * mailbox 优先选择 mailbox（不会画面撕裂，且延迟相对较低）；候补选择 fifo（不会造成画面撕裂）
      */
 
     std::vector<vk::PresentModeKHR> present_mode_list = _device.gpu().vkgpu().getSurfacePresentModesKHR(_surface);
+    auto is_supported = [&present_mode_list](vk::PresentModeKHR mode) {
+        return std::find(present_mode_list.begin(), present_mode_list.end(), mode) != present_mode_list.end();
+    };
 
 
-    for (const auto& present_mode: present_mode_list)
-        /**
-         * Mailbox: presentation engine 会等待 vertical blanking period，在此期间才会将 image 更新到 surface 上
-         * @details 会有个队列用于处理 present 请求，队列长度为 1。新的请求到来时，如果队列是满的，那么新的请求
-         *  会将之前的请求挤出队列，在此之前的 image 都可以被复用了。
-         */
-        if (present_mode == vk::PresentModeKHR::eMailbox)
-        {
-            return present_mode;
-        }
+    /**
+     * Immediate: presentation engine 不会等待 vertical blanking period，image 会立即更新到 surface 上
+     * @details 延迟最低，但是可能会画面撕裂
+     */
+    if (_config.mode == LatencyMode::Immediate && is_supported(vk::PresentModeKHR::eImmediate))
+        return vk::PresentModeKHR::eImmediate;
+
+
+    /**
+     * Mailbox: presentation engine 会等待 vertical blanking period，在此期间才会将 image 更新到 surface 上
+     * @details 会有个队列用于处理 present 请求，队列长度为 1。新的请求到来时，如果队列是满的，那么新的请求
+     *  会将之前的请求挤出队列，在此之前的 image 都可以被复用了。
+     */
+    if ((_config.mode == LatencyMode::Immediate || _config.mode == LatencyMode::Mailbox)
+        && is_supported(vk::PresentModeKHR::eMailbox))
+        return vk::PresentModeKHR::eMailbox;
 
 
     /**
@@ -102,7 +138,7 @@ vk::Extent2D Hiss::Swapchain::_choose_surface_extent()
 }
 
 
-void Hiss::Swapchain::create_swapchain()
+void Hiss::Swapchain::create_swapchain(vk::SwapchainKHR old_swapchain)
 {
     auto     capability = _device.gpu().vkgpu().getSurfaceCapabilitiesKHR(_surface);
     uint32_t image_cnt  = capability.minImageCount + 1;
@@ -115,6 +151,10 @@ void Hiss::Swapchain::create_swapchain()
         image_cnt = capability.maxImageCount;
 
 
+    /**
+     * 传入 oldSwapchain 之后，旧的 swapchain 不能再 acquire image，但是已经提交的 present 请求仍然会被处理，
+     * 因此仍在渲染的 frame 可以正常完成
+     */
     _swapchain = _device.vkdevice().createSwapchainKHR(vk::SwapchainCreateInfoKHR{
             .surface          = _surface,
             .minImageCount    = image_cnt,
@@ -128,16 +168,30 @@ void Hiss::Swapchain::create_swapchain()
             .compositeAlpha   = vk::CompositeAlphaFlagBitsKHR::eOpaque,    // 多个 surface 的情形
             .presentMode      = _present_mode,
             .clipped          = VK_TRUE,
-            .oldSwapchain     = {},
+            .oldSwapchain     = old_swapchain,
     });
 }
 
 
 uint32_t Hiss::Swapchain::acquire_image(vk::Semaphore to_signal_semaphore, vk::Fence to_signal_fence) const
 {
-    uint32_t image_idx;
-    auto     result = static_cast<vk::Result>(vkAcquireNextImageKHR(_device.vkdevice(), _swapchain, UINT64_MAX,
-                                                                    to_signal_semaphore, to_signal_fence, &image_idx));
+    uint32_t   image_idx = 0;
+    vk::Result result;
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_swapchain_mutex);
+            result = static_cast<vk::Result>(vkAcquireNextImageKHR(_device.vkdevice(), _swapchain,
+                                                                   SWAPCHAIN_WAIT_SLICE_NS, to_signal_semaphore,
+                                                                   to_signal_fence, &image_idx));
+        }
+        if (result != vk::Result::eTimeout && result != vk::Result::eNotReady)
+            break;
+
+        // 所有的 image 都在 present 线程的队列中，等待 present 之后再试
+        std::this_thread::yield();
+    }
+
     if (result == vk::Result::eErrorOutOfDateKHR)
     {
         spdlog::warn("swapchain image out of data (acquire image)");
@@ -152,9 +206,38 @@ uint32_t Hiss::Swapchain::acquire_image(vk::Semaphore to_signal_semaphore, vk::F
 }
 
 
-void Hiss::Swapchain::submit_image(uint32_t image_index, vk::Semaphore wait_semaphore) const
+void Hiss::Swapchain::submit_image(uint32_t image_index, vk::Semaphore wait_semaphore)
 {
+    uint64_t present_id = ++_present_id;
+
+    if (!_present_thread.joinable())
+    {
+        _present(image_index, wait_semaphore, present_id);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_present_mutex);
+        _present_requests.push_back(PresentRequest{
+                .image_index    = image_index,
+                .wait_semaphore = wait_semaphore,
+                .present_id     = present_id,
+        });
+    }
+    _present_cv.notify_one();
+}
+
+
+void Hiss::Swapchain::_present(uint32_t image_index, vk::Semaphore wait_semaphore, uint64_t present_id) const
+{
+    /* 通过 present id 标记这一帧，之后可以通过 vkWaitForPresentKHR 等待它被显示出来 */
+    vk::PresentIdKHR present_id_info = {
+            .swapchainCount = 1,
+            .pPresentIds    = &present_id,
+    };
+
     vk::PresentInfoKHR present_info = {
+            .pNext              = _present_wait ? &present_id_info : nullptr,
             .waitSemaphoreCount = 1,
             .pWaitSemaphores    = &wait_semaphore,
             .swapchainCount     = 1,
@@ -162,7 +245,13 @@ void Hiss::Swapchain::submit_image(uint32_t image_index, vk::Semaphore wait_sema
             .pImageIndices      = &image_index,
     };
 
-    vk::Result result = _device.queue().vkqueue().presentKHR(present_info);
+    /* present 可能发生在 present 线程中，需要和其他线程的 submit，以及 acquire 互斥；先 swapchain 再 queue */
+    vk::Result result;
+    {
+        std::lock_guard<std::mutex> swapchain_lock(_swapchain_mutex);
+        auto                        guard = _device.queue().lock();
+        result                            = _device.queue().vkqueue().presentKHR(present_info);
+    }
 
     if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR)
     {
@@ -174,4 +263,72 @@ void Hiss::Swapchain::submit_image(uint32_t image_index, vk::Semaphore wait_sema
         spdlog::error(to_string(result));
         throw std::runtime_error("failed to present swapchain image.");
     }
-}
\ No newline at end of file
+}
+
+
+void Hiss::Swapchain::_present_loop()
+{
+    while (true)
+    {
+        PresentRequest request;
+        {
+            std::unique_lock<std::mutex> lock(_present_mutex);
+            _present_cv.wait(lock, [this] { return _present_stop || !_present_requests.empty(); });
+            if (_present_requests.empty())
+                return;    // 只有在所有请求都处理完成之后才退出
+            request = _present_requests.front();
+            _present_requests.pop_front();
+        }
+
+        try
+        {
+            _present(request.image_index, request.wait_semaphore, request.present_id);
+        }
+        catch (const std::exception& e)
+        {
+            spdlog::error("[swapchain] present thread: {}", e.what());
+        }
+    }
+}
+
+
+void Hiss::Swapchain::_stop_present_thread()
+{
+    if (!_present_thread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(_present_mutex);
+        _present_stop = true;
+    }
+    _present_cv.notify_one();
+    _present_thread.join();
+}
+
+
+bool Hiss::Swapchain::wait_present_queue() const
+{
+    if (_config.mode != LatencyMode::FifoLowLatency || !_present_wait)
+        return false;
+
+    uint64_t current = _present_id.load();
+    if (current <= _config.queue_depth)
+        return true;
+
+    /**
+     * 分段等待，每一段之间释放锁，present 线程可以继续提交
+     * 总时长超时说明 presentation engine 出现了问题（例如窗口被遮挡），不再等待，避免卡住
+     */
+    VkResult result = VK_TIMEOUT;
+    for (uint64_t waited = 0; waited < PRESENT_WAIT_LIMIT_NS && result == VK_TIMEOUT;
+         waited += SWAPCHAIN_WAIT_SLICE_NS)
+    {
+        std::lock_guard<std::mutex> lock(_swapchain_mutex);
+        result = VULKAN_HPP_DEFAULT_DISPATCHER.vkWaitForPresentKHR(_device.vkdevice(), _swapchain,
+                                                                   current - _config.queue_depth,
+                                                                   SWAPCHAIN_WAIT_SLICE_NS);
+    }
+    if (result != VK_SUCCESS && result != VK_TIMEOUT && result != VK_SUBOPTIMAL_KHR)
+        spdlog::warn("[swapchain] wait for present: {}", to_string(static_cast<vk::Result>(result)));
+    return true;
+}
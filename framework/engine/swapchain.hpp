@@ -1,6 +1,12 @@
 #pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include "image.hpp"
 #include "core/device.hpp"
+#include "vk_config.hpp"
+#include "utils/ring_queue.hpp"
 
 
 namespace Hiss
@@ -10,14 +16,25 @@ class Swapchain
 {
 
 public:
-    Swapchain(Device& device, Window& window, vk::SurfaceKHR surface);
+    /**
+     * @param config present mode，是否使用 present 线程等
+     * @param old_swapchain 重新创建时传入旧的 swapchain，驱动可以复用其中的资源
+     */
+    Swapchain(Device& device, Window& window, vk::SurfaceKHR surface, const PresentConfig& config,
+              vk::SwapchainKHR old_swapchain = {});
     ~Swapchain();
 
-    // window 尺寸发生变换，swapchain 的应对
-    static Swapchain* resize(Swapchain* old, Device& device, Window& window, vk::SurfaceKHR surface)
+    /**
+     * window 尺寸发生变换，swapchain 的应对：以 oldSwapchain 的方式创建新的 swapchain，不需要等待 device idle
+     * @details 仍在渲染的 frame 使用的是旧的 image，旧的 swapchain 交给 deletion queue，在这些 frame 完成之后销毁
+     */
+    static Swapchain* resize(Swapchain* old, Device& device, Window& window, vk::SurfaceKHR surface,
+                             const PresentConfig& config)
     {
-        DELETE(old);
-        return new Swapchain(device, window, surface);
+        old->_stop_present_thread();
+        auto swapchain = new Swapchain(device, window, surface, config, old->_swapchain);
+        device.deletion_queue().retire(std::unique_ptr<Swapchain>(old));
+        return swapchain;
     }
 
 
@@ -26,6 +43,7 @@ public:
      * @details 初始情况下，或者将 image 提交给了 swapchian 后，这个 image 的拥有者是 swapchian。
      *  向 swapchain 请求 image 用于渲染时，swapchian 只会返回自己拥有的 image
      * @param to_signal_semaphore image 可用后，回通过该 semaphore 通知
+     * @details 以有限的超时重试，重试之间释放 swapchain 的锁，让 present 线程中的请求可以继续
      */
     uint32_t acquire_image(vk::Semaphore to_signal_semaphore, vk::Fence to_signal_fence) const;
 
@@ -33,23 +51,38 @@ public:
     /**
      * 返回 render 过的 image，让 swapchain 显示
      * @details image 在提交之前，拥有者是 application，提交之后，拥有者就变成了 swapchain
+     * @details 启用 present 线程时，只是将请求放入队列，立即返回
      * @param wait_semaphore image 渲染完成后，通过这个 semaphore 通知
      */
-    void submit_image(uint32_t image_index, vk::Semaphore wait_semaphore) const;
+    void submit_image(uint32_t image_index, vk::Semaphore wait_semaphore);
+
+
+    /**
+     * FifoLowLatency：等待已经提交但还没有显示的帧数不超过 queue_depth
+     * @return 不是 FifoLowLatency，或者不支持 present wait 时返回 false，不会等待
+     */
+    bool wait_present_queue() const;
 
 
 private:
     vk::SurfaceFormatKHR _choose_present_format();
     vk::PresentModeKHR   _choose_present_mode();
     vk::Extent2D         _choose_surface_extent();
-    void                 create_swapchain();
+    void                 create_swapchain(vk::SwapchainKHR old_swapchain);
+
+    void _present(uint32_t image_index, vk::Semaphore wait_semaphore, uint64_t present_id) const;
+    void _present_loop();
+
+    // 等待队列中所有的 present 请求完成，然后结束 present 线程
+    void _stop_present_thread();
 
 
 public:
     // 各种属性 =============================================================
 
-    vk::Format color_format() const { return _present_format.format; }
-    size_t     image_number() const { return _images2.size(); }
+    vk::Format           color_format() const { return _present_format.format; }
+    const PresentConfig& config() const { return _config; }
+    size_t               image_number() const { return _images2.size(); }
 
     Hiss::Image2D* get_image(uint32_t index) const { return _images2[index]; }
 
@@ -66,6 +99,33 @@ private:
     std::vector<Image2D*> _images2        = {};
     vk::SurfaceFormatKHR  _present_format = {};
     vk::PresentModeKHR    _present_mode   = {};
+
+    PresentConfig         _config;
+    bool                  _present_wait = false;    // 是否支持 VK_KHR_present_wait
+    std::atomic<uint64_t> _present_id{0};           // 最近一次提交的 present id，从 1 开始
+
+    /**
+     * acquire，present 以及 wait for present 都需要对 VkSwapchainKHR 进行外部同步
+     * @details 启用 present 线程时，present 和其他两者位于不同的线程；等待都使用有限的超时，并在重试之间释放锁
+     */
+    mutable std::mutex _swapchain_mutex;
+
+
+    // present 线程 ========================================================
+    struct PresentRequest
+    {
+        uint32_t      image_index;
+        vk::Semaphore wait_semaphore;
+        uint64_t      present_id;
+    };
+
+    std::thread             _present_thread;
+    std::mutex              _present_mutex;
+    std::condition_variable _present_cv;
+    bool                    _present_stop = false;
+
+    // 每个请求占用一个已经 acquire 的 image，因此不会超过 image 的数量
+    RingQueue<PresentRequest> _present_requests;
 };
 
 }    // namespace Hiss
\ No newline at end of file
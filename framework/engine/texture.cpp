@@ -3,6 +3,9 @@
 #include <utility>
 #include "utils/tools.hpp"
 #include "utils/stbi.hpp"
+#include "utils/mipmap.hpp"
+#include "utils/cook.hpp"
+#include <fmt/format.h>
 
 
 Hiss::Texture::Texture(Device& device, VmaAllocator allocator, std::string tex_path, vk::Format format)
@@ -10,47 +13,294 @@ Hiss::Texture::Texture(Device& device, VmaAllocator allocator, std::string tex_p
       _device(device),
       _allocator(allocator)
 {
-    _create_image(format);
+    // ktx 容器中的数据可以直接上传，其他格式需要使用 stbi 解码
+    if (KtxFile::is_ktx(path._value))
+        _create_image(KtxFile(path._value), format);
+    else if (!_try_create_cooked(format))
+    {
+        Hiss::Stbi_8Bit_RAII tex_data(path._value, STBI_rgb_alpha);
+        _create_image(tex_data, format);
+    }
     _create_sampler();
 }
 
 
-void Hiss::Texture::_create_image(vk::Format format)
+Hiss::Texture::Texture(Device& device, VmaAllocator allocator, const Stbi_8Bit_RAII& tex_data, std::string tex_path,
+                       vk::Format format)
+    : path(std::move(tex_path)),
+      _device(device),
+      _allocator(allocator)
+{
+    assert(tex_data.channels() == STBI_rgb_alpha);
+
+    _create_image(tex_data, format);
+    _create_sampler();
+}
+
+
+Hiss::Texture::Texture(Device& device, VmaAllocator allocator, const std::vector<std::string>& layer_paths,
+                       vk::Format format, bool cube)
+    : path(layer_paths.at(0)),
+      _device(device),
+      _allocator(allocator)
+{
+    if (cube && layer_paths.size() != 6)
+        throw std::runtime_error(fmt::format("[texture] cube map needs 6 faces, got {}", layer_paths.size()));
+
+    std::vector<std::unique_ptr<Stbi_8Bit_RAII>> layers;
+    layers.reserve(layer_paths.size());
+    for (auto& layer_path: layer_paths)
+        layers.push_back(std::make_unique<Stbi_8Bit_RAII>(layer_path, STBI_rgb_alpha));
+
+    _create_image(layers, format, cube);
+    _create_sampler();
+}
+
+
+void Hiss::Texture::_create_image(const Stbi_8Bit_RAII& tex_data, vk::Format format)
 {
-    // 从 image 文件中读取数据
-    Hiss::Stbi_8Bit_RAII tex_data(path._value, STBI_rgb_alpha);
     channels = tex_data.channels_in_file();
 
+    vk::Extent2D extent     = {(uint32_t) tex_data.width(), (uint32_t) tex_data.height()};
+    uint32_t     mip_levels = Image2D::max_mip_levels(extent);
 
-    // 将数据写入 stage buffer 中
-    vk::DeviceSize    image_size = tex_data.width() * tex_data.height() * 4;
-    Hiss::StageBuffer stage_buffer(_device, _allocator, image_size, "");
-    stage_buffer.mem_copy(tex_data.data, static_cast<size_t>(image_size));
+
+    // 创建空的 iamge，所有 level 都是 transfer dst
+    _image = new Image2D(_allocator, _device,
+                         Hiss::Image2DCreateInfo{
+                                 .format = format,
+                                 .extent = extent,
+                                 .usage  = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst
+                                        | vk::ImageUsageFlagBits::eSampled,
+                                 .mip_levels   = mip_levels,
+                                 .memory_flags = 0,
+                                 .aspect       = vk::ImageAspectFlagBits::eColor,
+                                 .init_layout  = vk::ImageLayout::eTransferDstOptimal,
+                         });
 
 
-    /* 计算 mipmap 的级别 */
-    // _mip_levels = static_cast<uint32_t>(std::floor(std::log2(std::max(_width, _height)))) + 1;
+    /**
+     * 优先使用 GPU 的 blit 生成 mipmap，只需要上传 level 0
+     * 如果 format 不支持 linear blit，就在 CPU 上生成完整的 mipmap 链，一次性上传
+     */
+    if (_device.gpu().is_support_linear_blit(format))
+    {
+        vk::DeviceSize    image_size = (vk::DeviceSize) extent.width * extent.height * 4;
+        Hiss::StageBuffer stage_buffer(_device, _allocator, image_size, "");
+        stage_buffer.mem_copy(tex_data.data, static_cast<size_t>(image_size));
+
+        _image->copy_buffer_to_image(stage_buffer.vkbuffer());
+        _image->generate_mipmap();
+    }
+    else
+    {
+        bool srgb  = is_srgb(format);
+        auto chain = Mipmap::generate_rgba8(tex_data.data, extent.width, extent.height, srgb, mip_levels);
+
+        Hiss::StageBuffer stage_buffer(_device, _allocator, chain.data.size(), "");
+        stage_buffer.mem_copy(chain.data.data(), chain.data.size());
+
+        std::vector<vk::DeviceSize> level_offsets;
+        for (auto& level: chain.levels)
+            level_offsets.push_back(level.offset);
+        _image->copy_buffer_to_image(stage_buffer.vkbuffer(), level_offsets);
+
+        // 最后将 layout 转变为适合 shader 读取的形式
+        _image->transfer_layout_im(vk::ImageLayout::eShaderReadOnlyOptimal);
+    }
+
+
+    // 所有 level 的大小之和
+    vk::DeviceSize total_size = 0;
+    for (uint32_t level = 0; level < mip_levels; ++level)
+        total_size += (vk::DeviceSize) std::max(1u, extent.width >> level) * std::max(1u, extent.height >> level) * 4;
+    size = total_size;
+}
+
+
+void Hiss::Texture::_create_image(const std::vector<std::unique_ptr<Stbi_8Bit_RAII>>& layers, vk::Format format,
+                                  bool cube)
+{
+    channels = layers.front()->channels_in_file();
+
+    vk::Extent2D extent     = {(uint32_t) layers.front()->width(), (uint32_t) layers.front()->height()};
+    uint32_t     mip_levels = Image2D::max_mip_levels(extent);
+    auto         layer_num  = (uint32_t) layers.size();
+    for (auto& layer: layers)
+        if ((uint32_t) layer->width() != extent.width || (uint32_t) layer->height() != extent.height)
+            throw std::runtime_error(fmt::format("[texture] layers have different size: {}", path._value.string()));
 
 
-    // 创建空的 iamge
     _image = new Image2D(_allocator, _device,
                          Hiss::Image2DCreateInfo{
                                  .format = format,
-                                 .extent = {(uint32_t) tex_data.width(), (uint32_t) tex_data.height()},
+                                 .extent = extent,
                                  .usage  = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst
                                         | vk::ImageUsageFlagBits::eSampled,
-                                 .memory_flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
+                                 .mip_levels   = mip_levels,
+                                 .array_layers = layer_num,
+                                 .cube         = cube,
+                                 .memory_flags = 0,
                                  .aspect       = vk::ImageAspectFlagBits::eColor,
                                  .init_layout  = vk::ImageLayout::eTransferDstOptimal,
                          });
 
 
-    // 将 stagebuffer 的数据写入
-    _image->copy_buffer_to_image(stage_buffer.vkbuffer());
+    // 和单个 layer 的纹理相同：优先使用 blit 生成所有 layer 的 mipmap，否则在 CPU 上逐个 layer 生成
+    vk::DeviceSize layer_size = (vk::DeviceSize) extent.width * extent.height * 4;
+    if (_device.gpu().is_support_linear_blit(format))
+    {
+        Hiss::StageBuffer stage_buffer(_device, _allocator, layer_size * layer_num, "");
+        for (uint32_t i = 0; i < layer_num; ++i)
+            stage_buffer.mem_copy(layers[i]->data, layer_size, layer_size * i);
+
+        _image->copy_buffer_to_image(stage_buffer.vkbuffer());
+        _image->generate_mipmap();
+    }
+    else
+    {
+        bool                       srgb       = is_srgb(format);
+        std::vector<Mipmap::Chain> chains;
+        vk::DeviceSize             chain_size = 0;
+        for (auto& layer: layers)
+        {
+            chains.push_back(Mipmap::generate_rgba8(layer->data, extent.width, extent.height, srgb, mip_levels));
+            chain_size += chains.back().data.size();
+        }
+
+        Hiss::StageBuffer    stage_buffer(_device, _allocator, chain_size, "");
+        Hiss::OneTimeCommand command(_device, _device.command_pool());
+        vk::DeviceSize       chain_offset = 0;
+        for (uint32_t i = 0; i < layer_num; ++i)
+        {
+            stage_buffer.mem_copy(chains[i].data.data(), chains[i].data.size(), chain_offset);
+            for (uint32_t level = 0; level < chains[i].levels.size(); ++level)
+                _image->copy_buffer_to_subresource(command(), stage_buffer.vkbuffer(),
+                                                   chain_offset + chains[i].levels[level].offset, level, i);
+            chain_offset += chains[i].data.size();
+        }
+        command.exec();
+
+        _image->transfer_layout_im(vk::ImageLayout::eShaderReadOnlyOptimal);
+    }
+
+
+    vk::DeviceSize total_size = 0;
+    for (uint32_t level = 0; level < mip_levels; ++level)
+        total_size += (vk::DeviceSize) std::max(1u, extent.width >> level) * std::max(1u, extent.height >> level) * 4;
+    size = total_size * layer_num;
+}
+
+
+void Hiss::Texture::_create_image(const KtxFile& ktx, vk::Format format)
+{
+    // KTX1 的 RGBA8 等格式不区分颜色空间，按照调用者的要求以 sRGB 的方式采样
+    vk::Format tex_format = is_srgb(format) ? KtxFile::to_srgb(ktx.format()) : ktx.format();
+    if (!_device.gpu().is_support_linear_filter(tex_format))
+        throw std::runtime_error(fmt::format("[texture] format {} is not supported by gpu: {}",
+                                             vk::to_string(tex_format), path._value.string()));
+    if (tex_format != format)
+        spdlog::info("[texture] {}: use format in ktx {} instead of {}", path._value.string(),
+                     vk::to_string(tex_format), vk::to_string(format));
+
+    channels = 4;
+
+
+    // block 的偏移需要是 block 大小的整数倍，统一对齐到 16 byte
+    std::vector<vk::DeviceSize> level_offsets;
+    vk::DeviceSize              total_size = 0;
+    for (auto& level: ktx.levels())
+    {
+        level_offsets.push_back(total_size);
+        total_size += (level.size + 15) & ~vk::DeviceSize(15);
+    }
+    Hiss::StageBuffer stage_buffer(_device, _allocator, total_size, "");
+    for (size_t i = 0; i < ktx.levels().size(); ++i)
+        stage_buffer.mem_copy(ktx.data.data() + ktx.levels()[i].offset, ktx.levels()[i].size, level_offsets[i]);
 
 
-    // 最后将 layout 转变为适合 shader 读取的形式
-    _image->transfer_layout_im(vk::ImageLayout::eShaderReadOnlyOptimal);
+    // 未压缩并且只有一个 level 的 ktx，仍然可以使用 blit 生成 mipmap
+    bool     gen_mipmap = ktx.levels().size() == 1 && !KtxFile::is_block_compressed(tex_format)
+                   && _device.gpu().is_support_linear_blit(tex_format);
+    uint32_t mip_levels = gen_mipmap ? Image2D::max_mip_levels(ktx.extent()) : (uint32_t) ktx.levels().size();
+
+    _image = new Image2D(_allocator, _device,
+                         Hiss::Image2DCreateInfo{
+                                 .format = tex_format,
+                                 .extent = ktx.extent(),
+                                 .usage  = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst
+                                        | vk::ImageUsageFlagBits::eSampled,
+                                 .mip_levels   = mip_levels,
+                                 .memory_flags = 0,
+                                 .aspect       = vk::ImageAspectFlagBits::eColor,
+                                 .init_layout  = vk::ImageLayout::eTransferDstOptimal,
+                         });
+    _image->copy_buffer_to_image(stage_buffer.vkbuffer(), level_offsets);
+
+    if (gen_mipmap)
+    {
+        _image->generate_mipmap();
+        size = total_size * 4 / 3;    // 完整 mipmap 链的大小约为 level 0 的 4/3
+    }
+    else
+    {
+        _image->transfer_layout_im(vk::ImageLayout::eShaderReadOnlyOptimal);
+        size = total_size;
+    }
+}
+
+
+bool Hiss::Texture::_try_create_cooked(vk::Format format)
+{
+    auto cooked_path = Cook::find_cooked(path._value, Cook::TEXTURE_EXT);
+    if (!cooked_path)
+        return false;
+
+    // 产物损坏或者被截断时，退回到源文件；删除产物，下一次运行 hiss_cook 时会重新生成
+    std::unique_ptr<KtxFile> cooked;
+    try
+    {
+        cooked = std::make_unique<KtxFile>(*cooked_path);
+    }
+    catch (const std::exception& e)
+    {
+        spdlog::warn("[texture] broken cooked texture, fallback to {}: {}", path._value.string(), e.what());
+        std::error_code ec;
+        std::filesystem::remove(*cooked_path, ec);
+        return false;
+    }
+    auto& ktx = *cooked;
+
+    // cook 的产物可能是 GPU 不支持的 block compressed 格式，此时退回到源文件
+
+    // hiss_cook 用 KTX 的格式记录纹理按照颜色还是数据处理，与调用者的要求不一致时使用源文件
+    if (is_srgb(format) != KtxFile::is_srgb(ktx.format()))
+    {
+        spdlog::info("[texture] {} was cooked as {} texture, fallback to {}", cooked_path->string(),
+                     KtxFile::is_srgb(ktx.format()) ? "color" : "data", path._value.string());
+        return false;
+    }
+    if (!_device.gpu().is_support_linear_filter(is_srgb(format) ? KtxFile::to_srgb(ktx.format()) : ktx.format()))
+    {
+        spdlog::warn("[texture] cooked format {} is not supported, fallback to {}", vk::to_string(ktx.format()),
+                     path._value.string());
+        return false;
+    }
+
+    _create_image(ktx, format);
+    return true;
+}
+
+
+bool Hiss::Texture::is_srgb(vk::Format format)
+{
+    switch (format)
+    {
+        case vk::Format::eR8G8B8A8Srgb:
+        case vk::Format::eB8G8R8A8Srgb:
+        case vk::Format::eA8B8G8R8SrgbPack32: return true;
+        default: return false;
+    }
 }
 
 
@@ -77,7 +327,7 @@ void Hiss::Texture::_create_sampler()
 
             // 用于 clamp LOD 级别的
             .minLod = 0.f,
-            .maxLod = static_cast<float>(1),
+            .maxLod = static_cast<float>(_image->mip_levels()),
 
             .borderColor             = vk::BorderColor::eIntOpaqueBlack,
             .unnormalizedCoordinates = VK_FALSE,
@@ -2,6 +2,8 @@
 
 #include "image.hpp"
 #include "utils/tools.hpp"
+#include "utils/stbi.hpp"
+#include "utils/ktx.hpp"
 
 
 namespace Hiss
@@ -11,22 +13,53 @@ class Texture
 
 public:
     /**
-     * 会将所有 level 都设为 shader read only layout
-     * @details 不支持 mipmap
+     * 会生成完整的 mipmap，并将所有 level 都设为 shader read only layout
+     * @details format 支持 linear blit 时在 GPU 上生成 mipmap，否则在 CPU 上生成
+     * @details .ktx 以及 .ktx2 文件会直接上传其中的数据（包括 block compressed 的数据以及 mipmap），
+     *  此时 format 只用于决定是否以 sRGB 的方式采样，实际的 format 由文件决定
+     * @details 其他格式的文件如果有 hiss_cook 生成的产物，会优先使用产物
      */
     Texture(Device& device, VmaAllocator allocator, std::string tex_path, vk::Format format);
+
+
+    /**
+     * 使用已经解码好的数据创建纹理，只进行 GPU 的上传
+     * @details 解码可以在其他线程完成，参考 ImageDecoder
+     * @param tex_data 需要是 RGBA 4 通道的数据
+     */
+    Texture(Device& device, VmaAllocator allocator, const Stbi_8Bit_RAII& tex_data, std::string tex_path,
+            vk::Format format);
+
+
+    /**
+     * 多个文件组成的 texture array 或者 cube map，每个文件是一个 layer，会生成完整的 mipmap
+     * @details 所有文件的尺寸需要相同；path 记录第一个文件
+     * @param cube 为 true 时需要 6 个文件，依次是 +X，-X，+Y，-Y，+Z，-Z 面；默认的 view 类型为 cube
+     */
+    Texture(Device& device, VmaAllocator allocator, const std::vector<std::string>& layer_paths, vk::Format format,
+            bool cube = false);
+
     ~Texture();
 
 
 private:
-    void _create_image(vk::Format format);
+    void _create_image(const Stbi_8Bit_RAII& tex_data, vk::Format format);
+    void _create_image(const KtxFile& ktx, vk::Format format);
+    void _create_image(const std::vector<std::unique_ptr<Stbi_8Bit_RAII>>& layers, vk::Format format, bool cube);
+
+    // 如果存在 cook 之后的产物，并且 GPU 支持其格式，就直接使用产物
+    bool _try_create_cooked(vk::Format format);
     void _create_sampler();
 
+    // format 是否是 sRGB 编码的，CPU 生成 mipmap 时需要在线性空间滤波
+    static bool is_srgb(vk::Format format);
+
     // members =======================================================
 
 public:
     Prop<uint32_t, Texture>              channels{0};    // 实际的通道数
     Prop<std::filesystem::path, Texture> path;
+    Prop<vk::DeviceSize, Texture>        size{0};    // 占用的显存大小（包括所有 mip level），单位是 byte
 
     Image2D&    image() const { return *_image; }
     vk::Sampler sampler() const { return _sampler; }
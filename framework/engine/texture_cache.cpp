@@ -0,0 +1,175 @@
+#include "texture_cache.hpp"
+#include "utils/cook.hpp"
+#include <algorithm>
+
+
+Hiss::TextureCache::TextureCache(Device& device, VmaAllocator allocator, JobSystem& jobs, vk::DeviceSize budget)
+    : budget(budget),
+      _device(device),
+      _allocator(allocator),
+      _decoder(jobs)
+{
+    spdlog::info("[texture cache] budget: {} MB", budget / (1024 * 1024));
+}
+
+
+Hiss::TextureCache::~TextureCache()
+{
+    log_stats();
+    clear();
+}
+
+
+std::shared_ptr<Hiss::Texture> Hiss::TextureCache::get(const std::filesystem::path& path, vk::Format format)
+{
+    Key key{_canonical(path), format};
+
+
+    // 命中：移动到 LRU 的头部
+    auto iter = _map.find(key);
+    if (iter != _map.end())
+    {
+        auto& entry = *iter->second;
+        _lru.splice(_lru.begin(), _lru, iter->second);
+
+        // 预先载入的纹理，第一次使用时已经计入了 miss
+        if (entry.touched)
+        {
+            stats._value.hit++;
+            stats._value.bytes_saved += entry.texture->size();
+        }
+        entry.touched = true;
+        return entry.texture;
+    }
+
+
+    // 未命中：创建新的纹理
+    auto texture = std::make_shared<Texture>(_device, _allocator, key.path, format);
+    _insert(key, texture, true);
+    _evict();
+    return texture;
+}
+
+
+void Hiss::TextureCache::preload(const std::vector<std::pair<std::filesystem::path, vk::Format>>& requests)
+{
+    // 找出还不在缓存中的纹理，并去除重复的请求
+    std::vector<Key>                   keys;
+    std::vector<std::filesystem::path> paths;
+    for (auto& [path, format]: requests)
+    {
+        Key key{_canonical(path), format};
+        if (_map.count(key) || std::find(keys.begin(), keys.end(), key) != keys.end())
+            continue;
+
+        // ktx 以及 cook 过的纹理不需要解码，直接上传
+        if (KtxFile::is_ktx(key.path) || Cook::find_cooked(key.path, Cook::TEXTURE_EXT))
+        {
+            _insert(key, std::make_shared<Texture>(_device, _allocator, key.path, format), false);
+            continue;
+        }
+        keys.push_back(key);
+        paths.emplace_back(key.path);
+    }
+    if (keys.empty())
+    {
+        _evict();
+        return;
+    }
+
+
+    // 在 worker 线程上解码，然后在当前线程上传
+    auto results = _decoder.decode(paths, STBI_rgb_alpha);
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        // 解码失败的纹理留给 get 去报错
+        if (!results[i].image)
+            continue;
+        _insert(keys[i], std::make_shared<Texture>(_device, _allocator, *results[i].image, keys[i].path, keys[i].format),
+                false);
+    }
+    _evict();
+}
+
+
+void Hiss::TextureCache::_insert(const Key& key, std::shared_ptr<Texture> texture, bool touched)
+{
+    stats._value.miss++;
+    stats._value.bytes_resident += texture->size();
+
+    // 缓存中的纹理只通过 material 的 DescriptorSet 使用，移动之后 descriptor 会被重新写入
+    texture->image().movable = true;
+
+    _lru.push_front(Entry{key, std::move(texture), touched});
+    _map[key] = _lru.begin();
+}
+
+
+void Hiss::TextureCache::set_budget(vk::DeviceSize new_budget)
+{
+    budget._value = new_budget;
+    _evict();
+}
+
+
+void Hiss::TextureCache::clear()
+{
+    _map.clear();
+    _lru.clear();
+    stats._value.bytes_resident = 0;
+}
+
+
+void Hiss::TextureCache::log_stats() const
+{
+    spdlog::info("[texture cache] hit: {}, miss: {}, evict: {}, saved: {:.2f} MB, resident: {:.2f} MB", stats().hit,
+                 stats().miss, stats().evict, (double) stats().bytes_saved / (1024.0 * 1024.0),
+                 (double) stats().bytes_resident / (1024.0 * 1024.0));
+}
+
+
+void Hiss::TextureCache::_evict()
+{
+    /**
+     * 先淘汰使用过的纹理，再淘汰预先载入之后一直没有被使用的纹理
+     * @details 后者通常是刚刚 preload、即将被 get 的纹理，但也可能来自加载失败或者从不绘制的模型，
+     *  如果永远不淘汰，预算就无法保证。被淘汰之后，下一次 get 会重新创建
+     */
+    for (bool untouched_pass: {false, true})
+    {
+        // 从最久未使用的纹理开始检查
+        auto iter = _lru.end();
+        while (stats().bytes_resident > budget() && iter != _lru.begin())
+        {
+            --iter;
+
+            // 纹理仍然被外部引用，淘汰之后并不会释放显存
+            if (iter->texture.use_count() > 1 || iter->touched == untouched_pass)
+                continue;
+
+            spdlog::info("[texture cache] evict{}: {}", untouched_pass ? " (never used)" : "", iter->key.path);
+            stats._value.bytes_resident -= iter->texture->size();
+            stats._value.evict++;
+
+            // 之前提交的 frame 可能仍然在使用
+            _device.deletion_queue().retire(std::move(iter->texture));
+            _map.erase(iter->key);
+            iter = _lru.erase(iter);
+        }
+    }
+
+    if (stats().bytes_resident > budget())
+        spdlog::warn("[texture cache] over budget, resident: {} MB, budget: {} MB",
+                     stats().bytes_resident / (1024 * 1024), budget() / (1024 * 1024));
+}
+
+
+std::string Hiss::TextureCache::_canonical(const std::filesystem::path& path)
+{
+    // 文件不存在时，weakly_canonical 仍然可以得到规范化的路径，交给 Texture 去报错
+    std::error_code ec;
+    auto            canonical_path = std::filesystem::weakly_canonical(path, ec);
+    if (ec)
+        return path.lexically_normal().string();
+    return canonical_path.string();
+}
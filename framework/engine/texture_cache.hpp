@@ -0,0 +1,119 @@
+#pragma once
+#include <list>
+#include <memory>
+#include <filesystem>
+#include <unordered_map>
+
+#include "texture.hpp"
+#include "utils/tools.hpp"
+#include "utils/image_decoder.hpp"
+
+
+namespace Hiss
+{
+
+/**
+ * 以文件路径为 key 的纹理缓存，避免同一张图片被多次解码、上传，以及在显存中保存多份
+ * @details key 由规范化之后的路径以及 format 组成，同一个文件以不同的 format 读取会得到不同的纹理
+ * @details 总显存超出预算时，按照 LRU 的顺序淘汰只被缓存自己持有的纹理；仍然被外部引用的纹理不会被淘汰
+ * @example
+ * \n - auto tex = engine.texture_cache().get(path, vk::Format::eR8G8B8A8Srgb);
+ */
+class TextureCache
+{
+public:
+    struct Stats
+    {
+        uint64_t       hit            = 0;    // 命中次数
+        uint64_t       miss           = 0;    // 未命中次数，即实际创建的纹理数量
+        uint64_t       evict          = 0;    // 被淘汰的纹理数量
+        vk::DeviceSize bytes_saved    = 0;    // 由于命中而避免的显存占用以及上传量
+        vk::DeviceSize bytes_resident = 0;    // 当前缓存中所有纹理的显存占用
+    };
+
+
+    /**
+     * @param jobs 用于 preload 时并行地解码
+     */
+    TextureCache(Device& device, VmaAllocator allocator, JobSystem& jobs, vk::DeviceSize budget);
+    ~TextureCache();
+
+
+    /**
+     * 获取纹理，如果缓存中没有，就从文件中读取并创建
+     */
+    std::shared_ptr<Texture> get(const std::filesystem::path& path, vk::Format format);
+
+
+    /**
+     * 预先载入一批纹理：在 worker 线程上并行解码，在调用者的线程上传到 GPU
+     * @details 已经在缓存中的纹理，以及重复的请求会被跳过。之后的 get 可以直接命中
+     */
+    void preload(const std::vector<std::pair<std::filesystem::path, vk::Format>>& requests);
+
+
+    /**
+     * 修改显存预算，会立即按照新的预算进行淘汰
+     */
+    void set_budget(vk::DeviceSize new_budget);
+
+
+    /**
+     * 放弃缓存对所有纹理的引用
+     */
+    void clear();
+
+
+    void log_stats() const;
+
+
+private:
+    struct Key
+    {
+        std::string path;    // 规范化之后的路径
+        vk::Format  format;
+
+        bool operator==(const Key& other) const { return path == other.path && format == other.format; }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const
+        {
+            return std::hash<std::string>()(key.path) ^ (std::hash<uint32_t>()((uint32_t) key.format) << 1);
+        }
+    };
+
+    struct Entry
+    {
+        Key                      key;
+        std::shared_ptr<Texture> texture;
+        bool                     touched = true;    // 预先载入的纹理在第一次 get 之前为 false，最后才被淘汰
+    };
+
+
+    // 将新创建的纹理加入缓存
+    void _insert(const Key& key, std::shared_ptr<Texture> texture, bool touched);
+
+    // 淘汰纹理，直到满足显存预算，或者没有可以淘汰的纹理
+    void _evict();
+
+    static std::string _canonical(const std::filesystem::path& path);
+
+
+public:
+    Prop<Stats, TextureCache>          stats{};
+    Prop<vk::DeviceSize, TextureCache> budget{0};
+
+
+private:
+    Device&      _device;
+    VmaAllocator _allocator;
+    ImageDecoder _decoder;
+
+    // 头部是最近使用的纹理，尾部是最久未使用的纹理
+    std::list<Entry>                                                _lru;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> _map;
+};
+
+}    // namespace Hiss
@@ -0,0 +1,115 @@
+#include "engine/uniform_ring.hpp"
+#include "utils/vk_func.hpp"
+
+#include <algorithm>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+
+Hiss::UniformRing::UniformRing(Device& device, VmaAllocator allocator, vk::DescriptorPool descriptor_pool,
+                               uint32_t segment_num, const Config& config)
+    : _device(device),
+      _config(config),
+      _segment_num(segment_num),
+      _descriptor_pool(descriptor_pool)
+{
+    assert(segment_num > 0);
+
+    auto& limits          = device.gpu().properties().limits;
+    _config.uniform_range = std::min<vk::DeviceSize>(_config.uniform_range, limits.maxUniformBufferRange);
+    _config.storage_range = std::min<vk::DeviceSize>(_config.storage_range, limits.maxStorageBufferRange);
+    _uniform_alignment    = limits.minUniformBufferOffsetAlignment;
+    _storage_alignment    = limits.minStorageBufferOffsetAlignment;
+
+
+    // 末尾额外保留一个 range，使得任何 offset 加上 descriptor 的 range 都不会越界
+    vk::DeviceSize size = _config.frame_size * segment_num + std::max(_config.uniform_range, _config.storage_range);
+
+    // usage 为 FRAME_BUFFER_USAGE，memory policy 会从 frame pool 中分配；放不下时退回到默认的分配方式
+    _buffer = std::make_unique<Buffer>(
+            device, allocator, size, MemoryPolicy::FRAME_BUFFER_USAGE,
+            VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+            "uniform ring");
+
+
+    _layout = Initial::descriptor_set_layout(
+            device.vkdevice(), {{vk::DescriptorType::eUniformBufferDynamic, vk::ShaderStageFlagBits::eAll},
+                                {vk::DescriptorType::eStorageBufferDynamic, vk::ShaderStageFlagBits::eAll}});
+
+    _descriptor_set = device.vkdevice()
+                              .allocateDescriptorSets(vk::DescriptorSetAllocateInfo{
+                                      .descriptorPool     = descriptor_pool,
+                                      .descriptorSetCount = 1,
+                                      .pSetLayouts        = &_layout,
+                              })
+                              .front();
+    device.set_debug_name(vk::ObjectType::eDescriptorSet, (VkDescriptorSet) _descriptor_set, "uniform ring");
+
+
+    // 两个 binding 的 offset 都是 0，实际的位置由 dynamic offset 决定
+    vk::DescriptorBufferInfo uniform_info = {.buffer = _buffer->vkbuffer(), .range = _config.uniform_range};
+    vk::DescriptorBufferInfo storage_info = {.buffer = _buffer->vkbuffer(), .range = _config.storage_range};
+    device.vkdevice().updateDescriptorSets(
+            {
+                    vk::WriteDescriptorSet{
+                            .dstSet          = _descriptor_set,
+                            .dstBinding      = 0,
+                            .descriptorCount = 1,
+                            .descriptorType  = vk::DescriptorType::eUniformBufferDynamic,
+                            .pBufferInfo     = &uniform_info,
+                    },
+                    vk::WriteDescriptorSet{
+                            .dstSet          = _descriptor_set,
+                            .dstBinding      = 1,
+                            .descriptorCount = 1,
+                            .descriptorType  = vk::DescriptorType::eStorageBufferDynamic,
+                            .pBufferInfo     = &storage_info,
+                    },
+            },
+            {});
+
+    spdlog::info("[uniform ring] {} segments x {:.1f} MB, uniform range: {} KB, storage range: {} KB", segment_num,
+                 (double) _config.frame_size / 1024.0 / 1024.0, _config.uniform_range / 1024,
+                 _config.storage_range / 1024);
+}
+
+
+Hiss::UniformRing::~UniformRing()
+{
+    _device.vkdevice().freeDescriptorSets(_descriptor_pool, _descriptor_set);
+    _device.vkdevice().destroy(_layout);
+}
+
+
+void Hiss::UniformRing::begin_frame(uint32_t frame_id)
+{
+    _last_frame_usage = _head - _segment_begin;
+    _segment_begin    = (vk::DeviceSize) (frame_id % _segment_num) * _config.frame_size;
+    _head             = _segment_begin;
+}
+
+
+Hiss::UniformRing::Allocation Hiss::UniformRing::allocate(vk::DeviceSize size, vk::DescriptorType type)
+{
+    bool is_uniform = type == vk::DescriptorType::eUniformBufferDynamic;
+    assert(is_uniform || type == vk::DescriptorType::eStorageBufferDynamic);
+
+    if (size > (is_uniform ? _config.uniform_range : _config.storage_range))
+        throw std::runtime_error(
+                fmt::format("[uniform ring] allocation of {} bytes exceeds the descriptor range", size));
+
+
+    // alignment 都是 2 的幂
+    vk::DeviceSize alignment = is_uniform ? _uniform_alignment : _storage_alignment;
+    vk::DeviceSize offset    = (_head + alignment - 1) & ~(alignment - 1);
+    if (offset + size > _segment_begin + _config.frame_size)
+        throw std::runtime_error(fmt::format("[uniform ring] out of space: frame size is {} bytes, increase "
+                                             "UniformRing::Config::frame_size",
+                                             _config.frame_size));
+
+    _head = offset + size;
+    return Allocation{
+            .data   = static_cast<uint8_t*>(_buffer->mapped_data()) + offset,
+            .offset = (uint32_t) offset,
+    };
+}
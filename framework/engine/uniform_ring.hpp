@@ -0,0 +1,125 @@
+#pragma once
+#include <cstring>
+#include <memory>
+
+#include "engine/buffer.hpp"
+
+
+namespace Hiss
+{
+
+/**
+ * 所有 pass 共享的、每一帧的常量数据：一个持久映射的 buffer，以及一个 descriptor set
+ * @details buffer 被分为若干段，每个 frame 使用一段（frame_id 取模）。frame 开始时，
+ *  FrameManager 已经等待了这个 frame 之前的 fence，因此可以直接覆盖这一段的内容
+ * @details 在一帧之内线性地分配，通过 dynamic offset 绑定，不需要为每个 pass 创建 buffer 和 descriptor set
+ * @details buffer 从 MemoryPolicy::frame_pool 中分配，不会单独占用一个 VkDeviceMemory
+ * @details descriptor set 的布局：
+ *  - binding 0：UNIFORM_BUFFER_DYNAMIC，shader 可见的大小为 uniform_range
+ *  - binding 1：STORAGE_BUFFER_DYNAMIC，shader 可见的大小为 storage_range
+ * @example
+ * \n - uint32_t offset = engine.uniform_ring().push(frame_data);
+ * \n - engine.uniform_ring().bind(command_buffer, bind_point, pipeline_layout, 0, offset);
+ */
+class UniformRing
+{
+public:
+    struct Config
+    {
+        vk::DeviceSize frame_size    = 1024 * 1024;    // 每一帧可以分配的大小
+        vk::DeviceSize uniform_range = 64 * 1024;      // 会被限制在 maxUniformBufferRange 以内
+        vk::DeviceSize storage_range = 256 * 1024;
+    };
+
+
+    /**
+     * @param segment_num 分段的数量，至少为 frame 的数量
+     */
+    UniformRing(Device& device, VmaAllocator allocator, vk::DescriptorPool descriptor_pool, uint32_t segment_num,
+                const Config& config);
+    UniformRing(Device& device, VmaAllocator allocator, vk::DescriptorPool descriptor_pool, uint32_t segment_num)
+        : UniformRing(device, allocator, descriptor_pool, segment_num, Config{})
+    {}
+    ~UniformRing();
+
+
+    /**
+     * 在 frame 开始时调用，回收这个 frame 在上一次使用时分配的所有空间
+     */
+    void begin_frame(uint32_t frame_id);
+
+
+    struct Allocation
+    {
+        void*    data   = nullptr;    // 可以直接写入
+        uint32_t offset = 0;          // 作为 dynamic offset 使用
+    };
+
+
+    /**
+     * 在当前帧中分配一段空间，满足 uniform 或者 storage 的对齐要求
+     * @details 写入之后需要调用 flush
+     * @param type eUniformBufferDynamic 或者 eStorageBufferDynamic
+     */
+    Allocation allocate(vk::DeviceSize size, vk::DescriptorType type = vk::DescriptorType::eUniformBufferDynamic);
+
+
+    void flush(const Allocation& allocation, vk::DeviceSize size) const
+    {
+        _buffer->flush(allocation.offset, size);
+    }
+
+
+    /**
+     * 分配并写入数据
+     * @return dynamic offset
+     */
+    template<typename T>
+    uint32_t push(const T& data, vk::DescriptorType type = vk::DescriptorType::eUniformBufferDynamic)
+    {
+        auto allocation = allocate(sizeof(T), type);
+        std::memcpy(allocation.data, &data, sizeof(T));
+        flush(allocation, sizeof(T));
+        return allocation.offset;
+    }
+
+
+    /**
+     * 绑定 ring 的 descriptor set，两个 binding 都需要 dynamic offset
+     */
+    void bind(vk::CommandBuffer command_buffer, vk::PipelineBindPoint bind_point, vk::PipelineLayout pipeline_layout,
+              uint32_t set_index, uint32_t uniform_offset, uint32_t storage_offset = 0) const
+    {
+        command_buffer.bindDescriptorSets(bind_point, pipeline_layout, set_index, {_descriptor_set},
+                                          {uniform_offset, storage_offset});
+    }
+
+
+    vk::DescriptorSetLayout layout() const { return _layout; }
+    vk::DescriptorSet       descriptor_set() const { return _descriptor_set; }
+    uint32_t                segment_num() const { return _segment_num; }
+
+    // 上一帧使用了多少空间，可以用于调整 frame_size
+    vk::DeviceSize last_frame_usage() const { return _last_frame_usage; }
+
+
+private:
+    Device& _device;
+    Config  _config;
+
+    uint32_t                _segment_num;
+    std::unique_ptr<Buffer> _buffer;
+
+    vk::DeviceSize _uniform_alignment;
+    vk::DeviceSize _storage_alignment;
+
+    vk::DeviceSize _segment_begin    = 0;
+    vk::DeviceSize _head             = 0;    // 当前帧下一次分配的位置，相对于 buffer 的起点
+    vk::DeviceSize _last_frame_usage = 0;
+
+    vk::DescriptorPool      _descriptor_pool;
+    vk::DescriptorSetLayout _layout;
+    vk::DescriptorSet       _descriptor_set;
+};
+
+}    // namespace Hiss
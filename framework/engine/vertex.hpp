@@ -102,6 +102,194 @@ struct Vertex3DNormalUV
     }
 };
 
+
+/**
+ * 模型使用的顶点格式，包含完整的 tangent space
+ */
+struct Vertex3D
+{
+    glm::vec3 position;     // location 0
+    glm::vec3 normal;       // location 1
+    glm::vec3 tangent;      // location 2
+    glm::vec3 bitangent;    // location 3
+    glm::vec2 uv;           // location 4
+
+    static std::vector<vk::VertexInputBindingDescription> binding_description(uint32_t bindind)
+    {
+        return {
+                vk::VertexInputBindingDescription{
+                        // 表示一个 vertex buffer，一次渲染的顶点数据可能位于多个 vertex buffer 中
+                        .binding   = bindind,
+                        .stride    = sizeof(Hiss::Vertex3D),
+                        .inputRate = vk::VertexInputRate::eVertex,
+                },
+        };
+    }
+
+
+    static std::vector<vk::VertexInputAttributeDescription> attribute_description(uint32_t binding)
+    {
+        return {
+                vk::VertexInputAttributeDescription{
+                        .location = 0,
+                        .binding  = binding,
+                        .format   = vk::Format::eR32G32B32Sfloat,    // signed float
+                        .offset   = offsetof(Vertex3D, position),
+                },
+                vk::VertexInputAttributeDescription{
+                        .location = 1,
+                        .binding  = binding,
+                        .format   = vk::Format::eR32G32B32Sfloat,
+                        .offset   = offsetof(Vertex3D, normal),
+                },
+                vk::VertexInputAttributeDescription{
+                        .location = 2,
+                        .binding  = binding,
+                        .format   = vk::Format::eR32G32B32Sfloat,
+                        .offset   = offsetof(Vertex3D, tangent),
+                },
+                vk::VertexInputAttributeDescription{
+                        .location = 3,
+                        .binding  = binding,
+                        .format   = vk::Format::eR32G32B32Sfloat,
+                        .offset   = offsetof(Vertex3D, bitangent),
+                },
+                vk::VertexInputAttributeDescription{
+                        .location = 4,
+                        .binding  = binding,
+                        .format   = vk::Format::eR32G32Sfloat,
+                        .offset   = offsetof(Vertex3D, uv),
+                },
+        };
+    }
+};
+
+
+
+/**
+ * 压缩的顶点格式：28 byte，是 Vertex3D 的一半
+ * @details normal 和 tangent 使用 octahedral 编码，只需要 2 个 snorm16；bitangent 由 cross(normal, tangent) * w 得到
+ * @details uv 使用 half float，超出 [-2048, 2048] 的 uv 精度会明显下降
+ * @details shader 中的解码参考 shader/shader/vertex_decode.glsl
+ */
+struct Vertex3DPacked
+{
+    glm::vec3 position;      // location 0
+    int16_t   normal[2];     // location 1, octahedral
+    int16_t   tangent[4];    // location 2, xy: octahedral, z: 0, w: bitangent 的方向（-1 或 1）
+    uint16_t  uv[2];         // location 3, half float
+
+    static std::vector<vk::VertexInputBindingDescription> binding_description(uint32_t binding)
+    {
+        return {
+                vk::VertexInputBindingDescription{
+                        .binding   = binding,
+                        .stride    = sizeof(Hiss::Vertex3DPacked),
+                        .inputRate = vk::VertexInputRate::eVertex,
+                },
+        };
+    }
+
+
+    static std::vector<vk::VertexInputAttributeDescription> attribute_description(uint32_t binding)
+    {
+        return {
+                vk::VertexInputAttributeDescription{
+                        .location = 0,
+                        .binding  = binding,
+                        .format   = vk::Format::eR32G32B32Sfloat,
+                        .offset   = offsetof(Vertex3DPacked, position),
+                },
+                vk::VertexInputAttributeDescription{
+                        .location = 1,
+                        .binding  = binding,
+                        .format   = vk::Format::eR16G16Snorm,
+                        .offset   = offsetof(Vertex3DPacked, normal),
+                },
+                vk::VertexInputAttributeDescription{
+                        .location = 2,
+                        .binding  = binding,
+                        .format   = vk::Format::eR16G16B16A16Snorm,
+                        .offset   = offsetof(Vertex3DPacked, tangent),
+                },
+                vk::VertexInputAttributeDescription{
+                        .location = 3,
+                        .binding  = binding,
+                        .format   = vk::Format::eR16G16Sfloat,
+                        .offset   = offsetof(Vertex3DPacked, uv),
+                },
+        };
+    }
+};
+
+
+/**
+ * 量化的顶点格式：20 byte
+ * @details position 是相对于 mesh AABB 的 unorm16：position = aabb_min + in_position.xyz * aabb_extent
+ * @details position 的 w 分量表示 bitangent 的方向：0 为 -1，1 为 1
+ * @details 其他属性与 Vertex3DPacked 相同
+ */
+struct Vertex3DQuantized
+{
+    uint16_t position[4];    // location 0, unorm16
+    int16_t  normal[2];      // location 1, octahedral
+    int16_t  tangent[2];     // location 2, octahedral
+    uint16_t uv[2];          // location 3, half float
+
+    static std::vector<vk::VertexInputBindingDescription> binding_description(uint32_t binding)
+    {
+        return {
+                vk::VertexInputBindingDescription{
+                        .binding   = binding,
+                        .stride    = sizeof(Hiss::Vertex3DQuantized),
+                        .inputRate = vk::VertexInputRate::eVertex,
+                },
+        };
+    }
+
+
+    static std::vector<vk::VertexInputAttributeDescription> attribute_description(uint32_t binding)
+    {
+        return {
+                vk::VertexInputAttributeDescription{
+                        .location = 0,
+                        .binding  = binding,
+                        .format   = vk::Format::eR16G16B16A16Unorm,
+                        .offset   = offsetof(Vertex3DQuantized, position),
+                },
+                vk::VertexInputAttributeDescription{
+                        .location = 1,
+                        .binding  = binding,
+                        .format   = vk::Format::eR16G16Snorm,
+                        .offset   = offsetof(Vertex3DQuantized, normal),
+                },
+                vk::VertexInputAttributeDescription{
+                        .location = 2,
+                        .binding  = binding,
+                        .format   = vk::Format::eR16G16Snorm,
+                        .offset   = offsetof(Vertex3DQuantized, tangent),
+                },
+                vk::VertexInputAttributeDescription{
+                        .location = 3,
+                        .binding  = binding,
+                        .format   = vk::Format::eR16G16Sfloat,
+                        .offset   = offsetof(Vertex3DQuantized, uv),
+                },
+        };
+    }
+};
+
+
+/**
+ * 模型在 GPU 端使用的顶点格式
+ */
+enum class VertexFormat
+{
+    Full,         // Vertex3D
+    Packed,       // Vertex3DPacked
+    Quantized,    // Vertex3DQuantized
+};
+
 }    // namespace Hiss
 
 
@@ -1,4 +1,5 @@
 #pragma once
+#include <algorithm>
 #include "core/device.hpp"
 #include "buffer.hpp"
 #include "vertex.hpp"
@@ -14,55 +15,85 @@ struct FaceTriangle
     uint32_t b;
     uint32_t c;
 };
+// 可以直接视为 uint32_t 的索引数组
+static_assert(sizeof(FaceTriangle) == 3 * sizeof(uint32_t));
 
 
+/**
+ * 索引的数量以及类型由构造时的数据决定
+ * @details 所有的索引都小于 65535 时（大多数 mesh 都满足），GPU 端使用 uint16 存储，内存和带宽都减半
+ * @details 绑定时需要使用 index_type，不能假设是 uint32
+ */
 class IndexBuffer2 : public Buffer
 {
 public:
-    using element_t = uint32_t;
+    using element_t = uint32_t;    // CPU 端数据的类型
 
 
-    // memory flags 表示：DEVICE_LOCAL
+    // memory flags 表示：DEVICE_LOCAL，可能是 host visible 的
     IndexBuffer2(Device& device, VmaAllocator allocator, const std::vector<uint32_t>& indices,
                  const std::string& name = "")
-        : Buffer(device, allocator, sizeof(uint32_t) * indices.size(),
-                 vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer,
-                 VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT, name),
-          index_num(indices.size())
-    {
-        // 创建 stage buffer，向其中写入数据
-        StageBuffer stage_buffer(device, allocator, size(), fmt::format("{}-stage-buffer", name));
-        stage_buffer.mem_copy(indices.data(), size());
+        : IndexBuffer2(device, allocator, indices.data(), indices.size(), name)
+    {}
 
 
-        // 立即向 indices 中写入
-        OneTimeCommand command_buffer{device, device.command_pool()};
-        command_buffer().copyBuffer(stage_buffer.vkbuffer(), vkbuffer(), {vk::BufferCopy{.size = size()}});
-        command_buffer.exec();
-    }
+    IndexBuffer2(Device& device, VmaAllocator allocator, const std::vector<FaceTriangle>& faces,
+                 const std::string& name = "")
+        : IndexBuffer2(device, allocator, faces.data(), faces.size(), name)
+    {}
 
 
-    IndexBuffer2(Device& device, VmaAllocator allocator, const std::vector<FaceTriangle>& faces,
+    /**
+     * 直接从指针读取数据，数据可以来自 mapped file，不需要先拷贝到 std::vector 中
+     */
+    IndexBuffer2(Device& device, VmaAllocator allocator, const FaceTriangle* faces, size_t face_num,
                  const std::string& name = "")
-        : Buffer(device, allocator, sizeof(FaceTriangle) * faces.size(),
-                 vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer,
-                 VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT, name),
-          index_num(faces.size() * 3)
+        : IndexBuffer2(device, allocator, reinterpret_cast<const uint32_t*>(faces), face_num * 3, name)
+    {}
+
+
+    IndexBuffer2(Device& device, VmaAllocator allocator, const uint32_t* indices, size_t index_num,
+                 const std::string& name = "")
+        : IndexBuffer2(device, allocator, indices, index_num, choose_index_type(indices, index_num), name)
+    {}
+
+
+    /**
+     * 最大的索引小于 65535 时使用 uint16（0xFFFF 保留给 primitive restart）
+     */
+    static vk::IndexType choose_index_type(const uint32_t* indices, size_t index_num)
     {
-        // 创建 stage buffer，向其中写入数据
-        StageBuffer stage_buffer(device, allocator, size(), fmt::format("{}-stage-buffer", name));
-        stage_buffer.mem_copy(faces.data(), size());
+        uint32_t max_index = 0;
+        for (size_t i = 0; i < index_num; ++i)
+            max_index = std::max(max_index, indices[i]);
+        return max_index < UINT16_MAX ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+    }
 
 
-        // 立即向 indices 中写入
-        OneTimeCommand command_buffer{device, device.command_pool()};
-        command_buffer().copyBuffer(stage_buffer.vkbuffer(), vkbuffer(), {vk::BufferCopy{.size = size()}});
-        command_buffer.exec();
+private:
+    IndexBuffer2(Device& device, VmaAllocator allocator, const uint32_t* indices, size_t index_num,
+                 vk::IndexType index_type, const std::string& name)
+        : Buffer(device, allocator,
+                 (index_type == vk::IndexType::eUint16 ? sizeof(uint16_t) : sizeof(uint32_t)) * index_num,
+                 vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer,
+                 DIRECT_UPLOAD_FLAGS, name),
+          index_num(index_num),
+          index_type(index_type)
+    {
+        // uint16 需要先进行转换
+        if (index_type == vk::IndexType::eUint16)
+        {
+            std::vector<uint16_t> indices_16(indices, indices + index_num);
+            upload(indices_16.data(), size());
+        }
+        else
+            upload(indices, size());
     }
 
 
 public:
-    const size_t index_num;
+    const size_t        index_num;
+    const vk::IndexType index_type;
 };
 
 
@@ -70,23 +101,25 @@ template<typename VertexType>
 class VertexBuffer2 : public Buffer
 {
 public:
-    // memory flags: DEVICE_LOCAL
+    // memory flags: DEVICE_LOCAL，可能是 host visible 的
     VertexBuffer2(Device& device, VmaAllocator allocator, const std::vector<VertexType>& vertices,
                   const std::string& name = "")
-        : Buffer(device, allocator, sizeof(VertexType) * vertices.size(),
-                 vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer,
-                 VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT, name),
-          vertex_num(vertices.size())
-    {
-        // 创建 stage buffer，向其中写入数据
-        StageBuffer stage_buffer(device, allocator, size(), fmt::format("{}-stage-buffer", name));
-        stage_buffer.mem_copy(vertices.data(), size());
+        : VertexBuffer2(device, allocator, vertices.data(), vertices.size(), name)
+    {}
 
 
-        // 立即向 vertices bufffer 中写入
-        OneTimeCommand command_buffer{device, device.command_pool()};
-        command_buffer().copyBuffer(stage_buffer.vkbuffer(), vkbuffer(), {vk::BufferCopy{.size = size()}});
-        command_buffer.exec();
+    /**
+     * 直接从指针读取数据，数据可以来自 mapped file，不需要先拷贝到 std::vector 中
+     */
+    VertexBuffer2(Device& device, VmaAllocator allocator, const VertexType* vertices, size_t vertex_num,
+                  const std::string& name = "")
+        : Buffer(device, allocator, sizeof(VertexType) * vertex_num,
+                 vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer,
+                 DIRECT_UPLOAD_FLAGS, name),
+          vertex_num(vertex_num)
+    {
+        // host visible 时直接写入，否则通过 stage buffer
+        upload(vertices, size());
     }
 
 
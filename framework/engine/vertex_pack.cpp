@@ -0,0 +1,303 @@
+#include "engine/vertex_pack.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+
+namespace
+{
+
+const float SNORM16_MAX = 32767.f;
+const float UNORM16_MAX = 65535.f;
+const float RAD_TO_DEG  = 57.29577951f;
+
+
+float sign_not_zero(float v)
+{
+    return v >= 0.f ? 1.f : -1.f;
+}
+
+
+float snorm16_to_float(int16_t v)
+{
+    return std::max((float) v / SNORM16_MAX, -1.f);
+}
+
+
+float length(const glm::vec3& v)
+{
+    return std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+}
+
+
+/**
+ * 两个向量之间的夹角，单位是 degree；原向量的长度为 0 时（例如没有 uv 时的 tangent），认为没有误差
+ */
+float angle_error(const glm::vec3& origin, const glm::vec3& decoded)
+{
+    if (length(origin) < 1e-6f || length(decoded) < 1e-6f)
+        return 0.f;
+
+    // 误差很小时，acos 受限于 float 的精度，使用 atan2 更准确
+    glm::vec3 c   = {origin.y * decoded.z - origin.z * decoded.y, origin.z * decoded.x - origin.x * decoded.z,
+                     origin.x * decoded.y - origin.y * decoded.x};
+    float     dot = origin.x * decoded.x + origin.y * decoded.y + origin.z * decoded.z;
+    return std::atan2(length(c), dot) * RAD_TO_DEG;
+}
+
+
+/**
+ * bitangent 相对于 cross(normal, tangent) 的方向
+ */
+float bitangent_sign(const Hiss::Vertex3D& v)
+{
+    glm::vec3 c = {v.normal.y * v.tangent.z - v.normal.z * v.tangent.y,
+                   v.normal.z * v.tangent.x - v.normal.x * v.tangent.z,
+                   v.normal.x * v.tangent.y - v.normal.y * v.tangent.x};
+    return c.x * v.bitangent.x + c.y * v.bitangent.y + c.z * v.bitangent.z < 0.f ? -1.f : 1.f;
+}
+
+
+void encode_uv(const glm::vec2& uv, uint16_t out[2])
+{
+    out[0] = Hiss::VertexPack::float_to_half(uv.x);
+    out[1] = Hiss::VertexPack::float_to_half(uv.y);
+}
+
+
+float uv_error(const glm::vec2& uv, const uint16_t encoded[2])
+{
+    return std::max(std::abs(Hiss::VertexPack::half_to_float(encoded[0]) - uv.x),
+                    std::abs(Hiss::VertexPack::half_to_float(encoded[1]) - uv.y));
+}
+
+}    // namespace
+
+
+void Hiss::VertexPack::PackError::merge(const PackError& other)
+{
+    position = std::max(position, other.position);
+    normal   = std::max(normal, other.normal);
+    tangent  = std::max(tangent, other.tangent);
+    uv       = std::max(uv, other.uv);
+}
+
+
+Hiss::VertexPack::Quantization Hiss::VertexPack::compute_quantization(const Vertex3D* vertices, size_t vertex_num)
+{
+    if (vertex_num == 0)
+        return {};
+
+    glm::vec3 min = vertices[0].position;
+    glm::vec3 max = vertices[0].position;
+    for (size_t i = 1; i < vertex_num; ++i)
+    {
+        auto& p = vertices[i].position;
+        min     = {std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z)};
+        max     = {std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z)};
+    }
+
+    return Quantization{
+            .aabb_min    = min,
+            .aabb_extent = {max.x - min.x, max.y - min.y, max.z - min.z},
+    };
+}
+
+
+void Hiss::VertexPack::oct_encode(const glm::vec3& n, int16_t out[2])
+{
+    // 投影到八面体 |x| + |y| + |z| = 1 上，下半部分沿着对角线翻折
+    float sum = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (sum == 0.f)
+    {
+        out[0] = out[1] = 0;
+        return;
+    }
+
+    float x = n.x / sum;
+    float y = n.y / sum;
+    if (n.z < 0.f)
+    {
+        float fx = (1.f - std::abs(y)) * sign_not_zero(x);
+        float fy = (1.f - std::abs(x)) * sign_not_zero(y);
+        x        = fx;
+        y        = fy;
+    }
+
+
+    // 简单的四舍五入不一定误差最小，在相邻的 4 个值中选择解码后与原向量最接近的
+    float   best_dot = -2.f;
+    float   base_x   = std::floor(std::clamp(x, -1.f, 1.f) * SNORM16_MAX);
+    float   base_y   = std::floor(std::clamp(y, -1.f, 1.f) * SNORM16_MAX);
+    int16_t candidate[2];
+    for (int dx = 0; dx < 2; ++dx)
+    {
+        for (int dy = 0; dy < 2; ++dy)
+        {
+            candidate[0] = (int16_t) std::clamp(base_x + (float) dx, -SNORM16_MAX, SNORM16_MAX);
+            candidate[1] = (int16_t) std::clamp(base_y + (float) dy, -SNORM16_MAX, SNORM16_MAX);
+
+            glm::vec3 d   = oct_decode(candidate);
+            float     dot = (d.x * n.x + d.y * n.y + d.z * n.z) / sum;
+            if (dot > best_dot)
+            {
+                best_dot = dot;
+                out[0]   = candidate[0];
+                out[1]   = candidate[1];
+            }
+        }
+    }
+}
+
+
+glm::vec3 Hiss::VertexPack::oct_decode(const int16_t in[2])
+{
+    float x = snorm16_to_float(in[0]);
+    float y = snorm16_to_float(in[1]);
+    float z = 1.f - std::abs(x) - std::abs(y);
+    if (z < 0.f)
+    {
+        float fx = (1.f - std::abs(y)) * sign_not_zero(x);
+        float fy = (1.f - std::abs(x)) * sign_not_zero(y);
+        x        = fx;
+        y        = fy;
+    }
+
+    float len = std::sqrt(x * x + y * y + z * z);
+    return {x / len, y / len, z / len};
+}
+
+
+uint16_t Hiss::VertexPack::float_to_half(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    auto     sign = (uint16_t) ((bits >> 16) & 0x8000u);
+    uint32_t abs  = bits & 0x7fffffffu;
+
+    // inf 以及 nan
+    if (abs >= 0x7f800000u)
+        return sign | 0x7c00u | (abs > 0x7f800000u ? 0x200u : 0u);
+
+    // 超出 half 的范围（舍入之后大于 65504）
+    if (abs >= 0x477ff000u)
+        return sign | 0x7c00u;
+
+    // half 的 subnormal：小于 2^-14
+    if (abs < 0x38800000u)
+    {
+        if (abs < 0x33000000u)
+            return sign;
+
+        uint32_t exponent = abs >> 23;
+        uint32_t mantissa = (abs & 0x7fffffu) | 0x800000u;
+        uint32_t shift    = 126 - exponent;
+        uint32_t result   = mantissa >> shift;
+        uint32_t rest     = mantissa & ((1u << shift) - 1);
+        uint32_t halfway  = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (result & 1u)))
+            result++;
+        return sign | (uint16_t) result;
+    }
+
+    // 调整 exponent 的偏移量（127 -> 15），截断 mantissa 的低 13 位
+    uint32_t result = (abs - 0x38000000u) >> 13;
+    uint32_t rest   = abs & 0x1fffu;
+    if (rest > 0x1000u || (rest == 0x1000u && (result & 1u)))
+        result++;
+    return sign | (uint16_t) result;
+}
+
+
+float Hiss::VertexPack::half_to_float(uint16_t value)
+{
+    uint32_t sign     = (uint32_t) (value & 0x8000u) << 16;
+    uint32_t exponent = (value >> 10) & 0x1fu;
+    uint32_t mantissa = value & 0x3ffu;
+
+    if (exponent == 0)
+    {
+        float result = std::ldexp((float) mantissa, -24);
+        return sign ? -result : result;
+    }
+
+    uint32_t bits = exponent == 0x1fu ? (sign | 0x7f800000u | (mantissa << 13))
+                                      : (sign | ((exponent + 112) << 23) | (mantissa << 13));
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+
+std::vector<Hiss::Vertex3DPacked> Hiss::VertexPack::pack(const Vertex3D* vertices, size_t vertex_num,
+                                                         PackError* error)
+{
+    std::vector<Vertex3DPacked> result(vertex_num);
+    for (size_t i = 0; i < vertex_num; ++i)
+    {
+        auto& src = vertices[i];
+        auto& dst = result[i];
+
+        dst.position = src.position;
+        oct_encode(src.normal, dst.normal);
+        oct_encode(src.tangent, dst.tangent);
+        dst.tangent[2] = 0;
+        dst.tangent[3] = (int16_t) (bitangent_sign(src) * SNORM16_MAX);
+        encode_uv(src.uv, dst.uv);
+
+        if (error)
+        {
+            error->normal  = std::max(error->normal, angle_error(src.normal, oct_decode(dst.normal)));
+            error->tangent = std::max(error->tangent, angle_error(src.tangent, oct_decode(dst.tangent)));
+            error->uv      = std::max(error->uv, uv_error(src.uv, dst.uv));
+        }
+    }
+    return result;
+}
+
+
+std::vector<Hiss::Vertex3DQuantized> Hiss::VertexPack::quantize(const Vertex3D* vertices, size_t vertex_num,
+                                                                const Quantization& quantization, PackError* error)
+{
+    auto& min    = quantization.aabb_min;
+    auto& extent = quantization.aabb_extent;
+
+    // extent 为 0 的维度（例如平面），量化结果总是 0
+    auto quantize_axis = [](float p, float min, float extent) -> uint16_t {
+        if (extent <= 0.f)
+            return 0;
+        return (uint16_t) std::lround(std::clamp((p - min) / extent, 0.f, 1.f) * UNORM16_MAX);
+    };
+
+
+    std::vector<Vertex3DQuantized> result(vertex_num);
+    for (size_t i = 0; i < vertex_num; ++i)
+    {
+        auto& src = vertices[i];
+        auto& dst = result[i];
+
+        dst.position[0] = quantize_axis(src.position.x, min.x, extent.x);
+        dst.position[1] = quantize_axis(src.position.y, min.y, extent.y);
+        dst.position[2] = quantize_axis(src.position.z, min.z, extent.z);
+        dst.position[3] = bitangent_sign(src) > 0.f ? (uint16_t) UNORM16_MAX : 0;
+        oct_encode(src.normal, dst.normal);
+        oct_encode(src.tangent, dst.tangent);
+        encode_uv(src.uv, dst.uv);
+
+        if (error)
+        {
+            glm::vec3 decoded = {min.x + (float) dst.position[0] / UNORM16_MAX * extent.x,
+                                 min.y + (float) dst.position[1] / UNORM16_MAX * extent.y,
+                                 min.z + (float) dst.position[2] / UNORM16_MAX * extent.z};
+            glm::vec3 diff    = {decoded.x - src.position.x, decoded.y - src.position.y, decoded.z - src.position.z};
+
+            error->position = std::max(error->position, length(diff));
+            error->normal   = std::max(error->normal, angle_error(src.normal, oct_decode(dst.normal)));
+            error->tangent  = std::max(error->tangent, angle_error(src.tangent, oct_decode(dst.tangent)));
+            error->uv       = std::max(error->uv, uv_error(src.uv, dst.uv));
+        }
+    }
+    return result;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "engine/vertex.hpp"
+
+
+/**
+ * 将 Vertex3D 转换为压缩或者量化的顶点格式，并统计精度的损失
+ * @details 编码方式与 shader/shader/vertex_decode.glsl 中的解码一一对应
+ */
+namespace Hiss::VertexPack
+{
+
+/**
+ * 压缩带来的最大误差
+ */
+struct PackError
+{
+    float position = 0.f;    // 位置的最大误差，单位与模型相同
+    float normal   = 0.f;    // normal 的最大角度误差，单位是 degree
+    float tangent  = 0.f;    // tangent 的最大角度误差，单位是 degree
+    float uv       = 0.f;    // uv 的最大绝对误差
+
+    // 取两者中较大的误差
+    void merge(const PackError& other);
+};
+
+
+/**
+ * 量化位置所需的参数：position = aabb_min + q * aabb_extent，q 位于 [0, 1]
+ */
+struct Quantization
+{
+    glm::vec3 aabb_min{0.f};
+    glm::vec3 aabb_extent{0.f};
+};
+
+
+/**
+ * 计算 mesh 的 AABB，作为量化的参数
+ */
+Quantization compute_quantization(const Vertex3D* vertices, size_t vertex_num);
+
+
+/**
+ * 转换为 Vertex3DPacked
+ * @param error 不为空时，解码并统计误差
+ */
+std::vector<Vertex3DPacked> pack(const Vertex3D* vertices, size_t vertex_num, PackError* error = nullptr);
+
+
+/**
+ * 转换为 Vertex3DQuantized，位置根据 quantization 进行量化
+ * @param error 不为空时，解码并统计误差
+ */
+std::vector<Vertex3DQuantized> quantize(const Vertex3D* vertices, size_t vertex_num, const Quantization& quantization,
+                                        PackError* error = nullptr);
+
+
+// 以下是基础的编解码函数
+
+// normal 需要是单位向量，结果为 snorm16
+void      oct_encode(const glm::vec3& n, int16_t out[2]);
+glm::vec3 oct_decode(const int16_t in[2]);
+
+// 舍入方式为 round to nearest even，超出范围时为 inf
+uint16_t float_to_half(float value);
+float    half_to_float(uint16_t value);
+
+}    // namespace Hiss::VertexPack
@@ -50,6 +50,12 @@ int run(const std::string& app_name)
         log_end_region("application init");
 
 
+        // 模拟线程在主循环之外运行，只通过快照和渲染交换数据
+        Hiss::ISimulation* simulation = app->simulation();
+        if (simulation)
+            simulation->start();
+
+
         // 主循环
         while (!g_engine->should_close())
         {
@@ -57,8 +63,8 @@ int run(const std::string& app_name)
 
             if (g_engine->should_resize())
             {
+                // 不需要等待 device idle：仍在渲染的 frame 使用旧的资源，由 deletion queue 在之后销毁
                 log_begin_region("on_resize");
-                g_engine->wait_idle();
                 g_engine->resize();
                 app->resize();
                 log_end_region("on_resize");
@@ -66,6 +72,8 @@ int run(const std::string& app_name)
             }
 
             g_engine->preupdate();
+            if (simulation)
+                simulation->advance();
             app->update();
             g_engine->postupdate();
         }
@@ -73,6 +81,8 @@ int run(const std::string& app_name)
 
         // 退出
         log_begin_region("exit");
+        if (simulation)
+            simulation->stop();
         g_engine->wait_idle();
         app->clean();
         delete app;
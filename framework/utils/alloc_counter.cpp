@@ -0,0 +1,89 @@
+#include "utils/alloc_counter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+
+namespace
+{
+
+std::atomic<uint64_t> g_alloc_count{0};
+std::atomic<uint64_t> g_alloc_bytes{0};
+
+}    // namespace
+
+
+bool Hiss::AllocCounter::enabled()
+{
+#ifdef HISS_COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+uint64_t Hiss::AllocCounter::count()
+{
+    return g_alloc_count.load(std::memory_order_relaxed);
+}
+
+
+uint64_t Hiss::AllocCounter::bytes()
+{
+    return g_alloc_bytes.load(std::memory_order_relaxed);
+}
+
+
+#ifdef HISS_COUNT_ALLOCATIONS
+
+/**
+ * 替换全局的 operator new / delete：和 AllocCounter 在同一个编译单元中，
+ * 链接静态库时，只要使用了 AllocCounter，这里的替换就会生效
+ */
+
+namespace
+{
+
+void* counted_alloc(std::size_t size)
+{
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+
+void* counted_aligned_alloc(std::size_t size, std::align_val_t alignment)
+{
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+
+    // aligned_alloc 要求 size 是 alignment 的倍数
+    auto align = static_cast<std::size_t>(alignment);
+    size       = (size + align - 1) / align * align;
+    if (void* ptr = std::aligned_alloc(align, size ? size : align))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+}    // namespace
+
+
+void* operator new(std::size_t size) { return counted_alloc(size); }
+void* operator new[](std::size_t size) { return counted_alloc(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return counted_aligned_alloc(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return counted_aligned_alloc(size, alignment); }
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+
+namespace Hiss
+{
+
+/**
+ * 统计全局的 operator new 调用，用于检查稳定运行时每一帧的堆分配次数
+ * @details 只有定义了 HISS_COUNT_ALLOCATIONS（cmake 选项 HISS_COUNT_ALLOCATIONS）时，才会替换全局的 operator new，
+ *  否则 enabled() 返回 false，计数始终为 0
+ * @details 计数是所有线程的总和，包括驱动之外的所有 C++ 分配（malloc 不计入）
+ * @example
+ * \n - auto before = AllocCounter::count();
+ * \n - run_one_frame();
+ * \n - assert(AllocCounter::count() - before == 0);
+ */
+struct AllocCounter
+{
+    static bool enabled();
+
+    // 从程序启动开始，operator new 的调用次数
+    static uint64_t count();
+
+    // 从程序启动开始，operator new 分配的字节数
+    static uint64_t bytes();
+};
+
+}    // namespace Hiss
@@ -1,5 +1,6 @@
 #pragma once
 #include "engine/engine.hpp"
+#include "utils/simulation.hpp"
 
 
 namespace Hiss
@@ -18,6 +19,11 @@ public:
     virtual void update(){};
     virtual void clean(){};
 
+    /**
+     * 固定步长的模拟，由 run() 启动以及停止；返回空表示模拟直接在 update 中进行
+     */
+    virtual ISimulation* simulation() { return nullptr; }
+
 
 public:
     Engine& engine;
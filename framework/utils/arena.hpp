@@ -0,0 +1,284 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+
+namespace Hiss
+{
+
+/**
+ * 线性分配器：只移动指针，不能单独释放，通过 reset 或者 rewind 一次性回收
+ * @details 空间不足时追加新的 block；回收之后 block 会被保留，因此稳定之后不会再向系统申请内存
+ * @details 不是线程安全的：每个 Frame 有一个（参考 Frame::arena），每个 worker 线程有一个（参考 JobSystem::scratch）
+ * @details 不会调用析构函数，只适合存放 trivially destructible 的数据，或者配合 ArenaVector 使用
+ */
+class LinearArena
+{
+public:
+    // 回退的位置
+    struct Marker
+    {
+        size_t block;
+        size_t offset;
+    };
+
+
+    explicit LinearArena(size_t block_size = 64 * 1024)
+        : _block_size(block_size)
+    {}
+
+    LinearArena(const LinearArena&)            = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+
+    void* alloc(size_t size, size_t alignment = alignof(std::max_align_t))
+    {
+        assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+        while (true)
+        {
+            if (_block < _blocks.size())
+            {
+                auto&     block   = _blocks[_block];
+                uintptr_t base    = reinterpret_cast<uintptr_t>(block.data.get());
+                uintptr_t address = (base + _offset + alignment - 1) & ~(uintptr_t) (alignment - 1);
+                if (address + size <= base + block.size)
+                {
+                    _offset = address + size - base;
+                    _used += size;
+                    _peak = std::max(_peak, _used);
+                    return reinterpret_cast<void*>(address);
+                }
+
+                // 当前 block 不够，尝试下一个保留的 block
+                if (_block + 1 < _blocks.size() && _blocks[_block + 1].size >= size + alignment)
+                {
+                    _block++;
+                    _offset = 0;
+                    continue;
+                }
+            }
+
+            // 在当前 block 之后插入新的 block，较小的保留 block 移到后面
+            size_t block_size = std::max(_block_size, size + alignment);
+            size_t index      = _blocks.empty() ? 0 : _block + 1;
+            _blocks.insert(_blocks.begin() + (std::ptrdiff_t) index,
+                           Block{std::unique_ptr<std::byte[]>(new std::byte[block_size]), block_size});
+            _block  = index;
+            _offset = 0;
+        }
+    }
+
+
+    template<typename T>
+    T* alloc_array(size_t num)
+    {
+        static_assert(std::is_trivially_destructible_v<T>);
+        return static_cast<T*>(alloc(sizeof(T) * num, alignof(T)));
+    }
+
+
+    /**
+     * 在 arena 中构造对象，不会调用析构函数
+     */
+    template<typename T, typename... Args>
+    T* create(Args&&... args)
+    {
+        static_assert(std::is_trivially_destructible_v<T>);
+        return new (alloc(sizeof(T), alignof(T))) T{std::forward<Args>(args)...};
+    }
+
+
+    Marker marker() const { return Marker{_block, _offset}; }
+
+    /**
+     * 回到 marker 的位置，之后分配的内存全部失效
+     * @details 用量只是近似地回退：跳过的 block 末尾的空间不计入
+     */
+    void rewind(const Marker& marker)
+    {
+        assert(marker.block < _blocks.size() || (marker.block == 0 && marker.offset == 0));
+        _block  = marker.block;
+        _offset = marker.offset;
+        _used   = _offset;
+        for (size_t i = 0; i < _block; ++i)
+            _used += _blocks[i].size;
+    }
+
+    void reset() { rewind(Marker{0, 0}); }
+
+
+    size_t used() const { return _used; }
+    size_t peak() const { return _peak; }    // 历史最大的用量，可以用于调整 block 的大小
+
+    size_t capacity() const
+    {
+        size_t sum = 0;
+        for (auto& block: _blocks)
+            sum += block.size;
+        return sum;
+    }
+
+
+private:
+    struct Block
+    {
+        std::unique_ptr<std::byte[]> data;
+        size_t                       size;
+    };
+
+    size_t             _block_size;
+    std::vector<Block> _blocks;
+    size_t             _block  = 0;    // 当前使用的 block
+    size_t             _offset = 0;    // 在当前 block 中的偏移
+    size_t             _used   = 0;
+    size_t             _peak   = 0;
+};
+
+
+/**
+ * 从 LinearArena 中分配内存的 std allocator，deallocate 什么都不做
+ * @details 容器的生命周期不能超过 arena 的下一次 reset
+ */
+template<typename T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(LinearArena& arena)
+        : _arena(&arena)
+    {}
+
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other)
+        : _arena(other.arena())
+    {}
+
+    T*   allocate(size_t n) { return static_cast<T*>(_arena->alloc(sizeof(T) * n, alignof(T))); }
+    void deallocate(T*, size_t) {}
+
+    LinearArena* arena() const { return _arena; }
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>& other) const
+    {
+        return _arena == other.arena();
+    }
+
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const
+    {
+        return _arena != other.arena();
+    }
+
+
+private:
+    LinearArena* _arena;
+};
+
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+
+/**
+ * 前 N 个元素存放在对象内部的 vector，超出时才在堆上分配
+ * @details 用于每一帧都会构造的小数组，例如 submit 的 semaphore 列表，descriptor 的 write 列表
+ * @details 只支持 trivially copyable 的类型（vulkan 的 handle 以及 struct）
+ */
+template<typename T, size_t N>
+class SmallVector
+{
+    static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>);
+
+public:
+    SmallVector() = default;
+
+    SmallVector(std::initializer_list<T> list) { assign(list.begin(), list.end()); }
+
+    template<typename Iter>
+    SmallVector(Iter first, Iter last)
+    {
+        assign(first, last);
+    }
+
+    SmallVector(const SmallVector& other) { assign(other.begin(), other.end()); }
+
+    SmallVector& operator=(const SmallVector& other)
+    {
+        if (this != &other)
+            assign(other.begin(), other.end());
+        return *this;
+    }
+
+
+    template<typename Iter>
+    void assign(Iter first, Iter last)
+    {
+        clear();
+        reserve((size_t) std::distance(first, last));
+        for (; first != last; ++first)
+            push_back(*first);
+    }
+
+    void push_back(const T& value)
+    {
+        if (_size == _capacity)
+            reserve(_capacity * 2);
+        data()[_size++] = value;
+    }
+
+    // 新的元素是值初始化的
+    void resize(size_t size)
+    {
+        reserve(size);
+        for (size_t i = _size; i < size; ++i)
+            data()[i] = T{};
+        _size = size;
+    }
+
+    void reserve(size_t capacity)
+    {
+        if (capacity <= _capacity)
+            return;
+
+        std::unique_ptr<T[]> heap(new T[capacity]);
+        std::memcpy(heap.get(), data(), sizeof(T) * _size);
+        _heap     = std::move(heap);
+        _capacity = capacity;
+    }
+
+    void clear() { _size = 0; }
+
+
+    T*       data() { return _heap ? _heap.get() : reinterpret_cast<T*>(_inline); }
+    const T* data() const { return _heap ? _heap.get() : reinterpret_cast<const T*>(_inline); }
+    size_t   size() const { return _size; }
+    bool     empty() const { return _size == 0; }
+    bool     is_inline() const { return !_heap; }
+
+    T&       operator[](size_t i) { return data()[i]; }
+    const T& operator[](size_t i) const { return data()[i]; }
+
+    T*       begin() { return data(); }
+    T*       end() { return data() + _size; }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + _size; }
+
+
+private:
+    alignas(T) std::byte _inline[sizeof(T) * N];
+    std::unique_ptr<T[]> _heap;
+    size_t               _size     = 0;
+    size_t               _capacity = N;
+};
+
+}    // namespace Hiss
@@ -0,0 +1,198 @@
+#include "utils/block_compress.hpp"
+
+#include <array>
+#include <algorithm>
+
+
+namespace
+{
+
+using Block = std::array<uint8_t, 16 * 4>;    // 4x4 个 RGBA 像素
+
+
+// 取出以 (bx, by) 为左上角的 4x4 block，超出边界的像素使用边缘的像素
+void fetch_block(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, Block& block)
+{
+    for (uint32_t y = 0; y < 4; ++y)
+    {
+        uint32_t sy = std::min(by + y, height - 1);
+        for (uint32_t x = 0; x < 4; ++x)
+        {
+            uint32_t       sx  = std::min(bx + x, width - 1);
+            const uint8_t* src = rgba + ((size_t) sy * width + sx) * 4;
+            std::copy(src, src + 4, block.data() + (y * 4 + x) * 4);
+        }
+    }
+}
+
+
+uint16_t to_565(const uint8_t* c)
+{
+    return (uint16_t) (((c[0] >> 3) << 11) | ((c[1] >> 2) << 5) | (c[2] >> 3));
+}
+
+
+void from_565(uint16_t v, uint8_t* c)
+{
+    uint8_t r = (v >> 11) & 0x1F, g = (v >> 5) & 0x3F, b = v & 0x1F;
+    c[0] = (uint8_t) ((r << 3) | (r >> 2));
+    c[1] = (uint8_t) ((g << 2) | (g >> 4));
+    c[2] = (uint8_t) ((b << 3) | (b >> 2));
+}
+
+
+/**
+ * 编码 color block（8 byte），总是使用 4 色模式（c0 > c1）
+ */
+void encode_color_block(const Block& block, uint8_t* out)
+{
+    // 使用 bounding box 作为端点，并向内收缩，减少端点处的误差
+    uint8_t lo[3] = {255, 255, 255}, hi[3] = {0, 0, 0};
+    for (uint32_t i = 0; i < 16; ++i)
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            lo[c] = std::min(lo[c], block[i * 4 + c]);
+            hi[c] = std::max(hi[c], block[i * 4 + c]);
+        }
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+        uint8_t inset = (uint8_t) ((hi[c] - lo[c]) >> 4);
+        lo[c]         = (uint8_t) (lo[c] + inset);
+        hi[c]         = (uint8_t) (hi[c] - inset);
+    }
+
+    uint16_t c0 = to_565(hi), c1 = to_565(lo);
+    if (c0 < c1)
+        std::swap(c0, c1);
+
+
+    // 调色板：c0，c1，2/3 c0 + 1/3 c1，1/3 c0 + 2/3 c1
+    uint8_t palette[4][3];
+    from_565(c0, palette[0]);
+    from_565(c1, palette[1]);
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+        palette[2][c] = (uint8_t) ((2 * palette[0][c] + palette[1][c]) / 3);
+        palette[3][c] = (uint8_t) ((palette[0][c] + 2 * palette[1][c]) / 3);
+    }
+
+
+    // 每个像素选择距离最近的颜色，c0 == c1 时所有的索引都是 0
+    uint32_t indices = 0;
+    if (c0 != c1)
+    {
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            uint32_t best = 0, best_dist = UINT32_MAX;
+            for (uint32_t p = 0; p < 4; ++p)
+            {
+                uint32_t dist = 0;
+                for (uint32_t c = 0; c < 3; ++c)
+                {
+                    int d = (int) block[i * 4 + c] - (int) palette[p][c];
+                    dist += (uint32_t) (d * d);
+                }
+                if (dist < best_dist)
+                {
+                    best      = p;
+                    best_dist = dist;
+                }
+            }
+            indices |= best << (i * 2);
+        }
+    }
+
+    out[0] = (uint8_t) (c0 & 0xFF);
+    out[1] = (uint8_t) (c0 >> 8);
+    out[2] = (uint8_t) (c1 & 0xFF);
+    out[3] = (uint8_t) (c1 >> 8);
+    for (uint32_t i = 0; i < 4; ++i)
+        out[4 + i] = (uint8_t) (indices >> (i * 8));
+}
+
+
+/**
+ * 编码 BC3 的 alpha block（8 byte），使用 8 个 alpha 值的模式（a0 > a1）
+ */
+void encode_alpha_block(const Block& block, uint8_t* out)
+{
+    uint8_t a0 = 0, a1 = 255;
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        a0 = std::max(a0, block[i * 4 + 3]);
+        a1 = std::min(a1, block[i * 4 + 3]);
+    }
+
+    uint64_t indices = 0;
+    if (a0 != a1)
+    {
+        // 调色板：a0，a1，以及 6 个插值
+        uint8_t palette[8] = {a0, a1};
+        for (uint32_t p = 1; p < 7; ++p)
+            palette[p + 1] = (uint8_t) (((7 - p) * a0 + p * a1) / 7);
+
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            uint32_t best = 0, best_dist = UINT32_MAX;
+            for (uint32_t p = 0; p < 8; ++p)
+            {
+                int      d    = (int) block[i * 4 + 3] - (int) palette[p];
+                uint32_t dist = (uint32_t) (d * d);
+                if (dist < best_dist)
+                {
+                    best      = p;
+                    best_dist = dist;
+                }
+            }
+            indices |= (uint64_t) best << (i * 3);
+        }
+    }
+
+    out[0] = a0;
+    out[1] = a1;
+    for (uint32_t i = 0; i < 6; ++i)
+        out[2 + i] = (uint8_t) (indices >> (i * 8));
+}
+
+
+template<size_t BLOCK_BYTES, typename F>
+std::vector<uint8_t> encode(const uint8_t* rgba, uint32_t width, uint32_t height, F&& encode_block)
+{
+    uint32_t             block_w = (width + 3) / 4, block_h = (height + 3) / 4;
+    std::vector<uint8_t> out((size_t) block_w * block_h * BLOCK_BYTES);
+
+    Block block;
+    for (uint32_t by = 0; by < block_h; ++by)
+        for (uint32_t bx = 0; bx < block_w; ++bx)
+        {
+            fetch_block(rgba, width, height, bx * 4, by * 4, block);
+            encode_block(block, out.data() + ((size_t) by * block_w + bx) * BLOCK_BYTES);
+        }
+    return out;
+}
+
+}    // namespace
+
+
+std::vector<uint8_t> Hiss::BlockCompress::encode_bc1(const uint8_t* rgba, uint32_t width, uint32_t height)
+{
+    return encode<8>(rgba, width, height, [](const Block& block, uint8_t* out) { encode_color_block(block, out); });
+}
+
+
+std::vector<uint8_t> Hiss::BlockCompress::encode_bc3(const uint8_t* rgba, uint32_t width, uint32_t height)
+{
+    return encode<16>(rgba, width, height, [](const Block& block, uint8_t* out) {
+        encode_alpha_block(block, out);
+        encode_color_block(block, out + 8);
+    });
+}
+
+
+bool Hiss::BlockCompress::has_alpha(const uint8_t* rgba, size_t pixel_num)
+{
+    for (size_t i = 0; i < pixel_num; ++i)
+        if (rgba[i * 4 + 3] != 255)
+            return true;
+    return false;
+}
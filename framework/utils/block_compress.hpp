@@ -0,0 +1,29 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace Hiss::BlockCompress
+{
+
+/**
+ * 将 RGBA8 的图片编码为 BC1（不透明，8 byte / 4x4 block）
+ * @details 端点使用 bounding box 并向内收缩 1/16，速度很快，质量略低于 PCA 的方法，适合离线批量处理
+ * @details 尺寸不是 4 的倍数时，边缘的 block 会重复使用边缘的像素
+ */
+std::vector<uint8_t> encode_bc1(const uint8_t* rgba, uint32_t width, uint32_t height);
+
+
+/**
+ * 将 RGBA8 的图片编码为 BC3（带 alpha，16 byte / 4x4 block）
+ */
+std::vector<uint8_t> encode_bc3(const uint8_t* rgba, uint32_t width, uint32_t height);
+
+
+/**
+ * 图片中是否有不透明度小于 255 的像素
+ */
+bool has_alpha(const uint8_t* rgba, size_t pixel_num);
+
+}    // namespace Hiss::BlockCompress
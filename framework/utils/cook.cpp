@@ -0,0 +1,67 @@
+#include "utils/cook.hpp"
+
+#include <fstream>
+#include <vector>
+#include "proj_config.hpp"
+
+
+std::filesystem::path Hiss::Cook::cooked_path(const std::filesystem::path& source, const std::string& ext)
+{
+    std::error_code ec;
+    auto            abs_source = std::filesystem::weakly_canonical(source, ec);
+    if (ec)
+        return {};
+    auto abs_assets = std::filesystem::weakly_canonical(assets, ec);
+    if (ec)
+        return {};
+
+    // 源文件需要在 assets 中，并且不能是 cook 的产物
+    auto relative = abs_source.lexically_relative(abs_assets);
+    if (relative.empty() || *relative.begin() == ".." || *relative.begin() == cooked.filename())
+        return {};
+
+    auto result = cooked / relative;
+    result += ext;
+    return result;
+}
+
+
+std::optional<std::filesystem::path> Hiss::Cook::find_cooked(const std::filesystem::path& source,
+                                                             const std::string&           ext)
+{
+    auto path = cooked_path(source, ext);
+    if (path.empty())
+        return std::nullopt;
+
+    std::error_code ec;
+    auto            cooked_time = std::filesystem::last_write_time(path, ec);
+    if (ec)
+        return std::nullopt;
+    auto source_time = std::filesystem::last_write_time(source, ec);
+    if (ec || cooked_time < source_time)
+        return std::nullopt;
+
+    return path;
+}
+
+
+uint64_t Hiss::Cook::hash_file(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("[cook] failed to open file: " + path.string());
+
+    uint64_t          hash = 0xcbf29ce484222325ull;    // FNV offset basis
+    std::vector<char> buffer(64 * 1024);
+    while (file)
+    {
+        file.read(buffer.data(), (std::streamsize) buffer.size());
+        auto count = file.gcount();
+        for (std::streamsize i = 0; i < count; ++i)
+        {
+            hash ^= (uint8_t) buffer[i];
+            hash *= 0x100000001b3ull;    // FNV prime
+        }
+    }
+    return hash;
+}
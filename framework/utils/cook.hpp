@@ -0,0 +1,38 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <optional>
+#include <filesystem>
+
+
+/**
+ * 离线 cook（参考 tools/hiss_cook）的产物与源文件之间的对应关系
+ * @details 源文件 assets/xxx/yyy.png 对应的产物是 assets/.cooked/xxx/yyy.png.ktx2
+ * @details 纹理的产物是带有完整 mipmap 的 KTX2，模型的产物是 ModelDesc 的二进制文件（.hmdl）
+ */
+namespace Hiss::Cook
+{
+
+const char* const TEXTURE_EXT = ".ktx2";
+const char* const MODEL_EXT   = ".hmdl";
+
+
+/**
+ * 源文件对应的产物的路径，源文件不在 assets 文件夹中时返回空的路径
+ */
+std::filesystem::path cooked_path(const std::filesystem::path& source, const std::string& ext);
+
+
+/**
+ * 如果产物存在，并且不比源文件旧，返回产物的路径
+ * @details 运行时只比较修改时间；hiss_cook 使用源文件的 hash 来决定是否需要重新 cook
+ */
+std::optional<std::filesystem::path> find_cooked(const std::filesystem::path& source, const std::string& ext);
+
+
+/**
+ * 文件内容的 64-bit FNV-1a hash
+ */
+uint64_t hash_file(const std::filesystem::path& path);
+
+}    // namespace Hiss::Cook
@@ -0,0 +1,107 @@
+#include "utils/deletion_queue.hpp"
+#include "core/device.hpp"
+
+
+Hiss::DeletionQueue::DeletionQueue(Device& device)
+    : _device(device),
+      _vkdevice(device.vkdevice())
+{}
+
+
+Hiss::DeletionQueue::~DeletionQueue()
+{
+    flush();
+}
+
+
+void Hiss::DeletionQueue::push(std::function<void()> deleter)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _current.push_back(std::move(deleter));
+}
+
+
+void Hiss::DeletionQueue::end_frame()
+{
+    std::vector<std::function<void()>> deleters;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_current.empty())
+            return;
+        deleters.swap(_current);
+    }
+
+    // 没有 command buffer 的 submit：fence 在之前提交的所有命令完成之后 signal
+    vk::Fence fence = _device.fence_pool().acquire(false);
+    {
+        auto guard = _device.queue().lock();
+        _device.vkqueue().submit({}, fence);
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _batches.push_back(Batch{.fence = fence, .deleters = std::move(deleters)});
+}
+
+
+void Hiss::DeletionQueue::collect()
+{
+    while (true)
+    {
+        Batch batch;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_batches.empty() || _vkdevice.getFenceStatus(_batches.front().fence) != vk::Result::eSuccess)
+                return;
+            batch = std::move(_batches.front());
+            _batches.pop_front();
+        }
+
+        // deleter 中可能会再次交给 queue（例如 Texture 析构时），不能持有锁
+        for (auto& deleter: batch.deleters)
+            deleter();
+        _device.fence_pool().revert(batch.fence);
+    }
+}
+
+
+void Hiss::DeletionQueue::flush()
+{
+    {
+        auto guard = _device.queue().lock();
+        _vkdevice.waitIdle();
+    }
+
+    // deleter 中交给 queue 的资源也需要销毁
+    while (true)
+    {
+        std::deque<Batch>                  batches;
+        std::vector<std::function<void()>> current;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            batches.swap(_batches);
+            current.swap(_current);
+        }
+        if (batches.empty() && current.empty())
+            return;
+
+        for (auto& batch: batches)
+        {
+            for (auto& deleter: batch.deleters)
+                deleter();
+            _device.fence_pool().revert(batch.fence);
+        }
+        for (auto& deleter: current)
+            deleter();
+    }
+}
+
+
+size_t Hiss::DeletionQueue::pending_num() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    size_t num = _current.size();
+    for (auto& batch: _batches)
+        num += batch.deleters.size();
+    return num;
+}
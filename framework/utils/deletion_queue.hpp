@@ -0,0 +1,114 @@
+#pragma once
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "core/vk_common.hpp"
+
+
+namespace Hiss
+{
+class Device;
+
+
+/**
+ * 延迟销毁 GPU 资源：资源交给 queue 之后，等到之前提交的所有命令都执行完成，再真正销毁
+ * @details 每一帧结束时（end_frame），将这一帧中交给 queue 的资源打包为一批，并向 queue 提交一个只有 fence 的 submit；
+ *  fence 会在之前提交的所有命令完成之后 signal，因此不需要知道资源具体被哪些 command buffer 使用
+ * @details fence 按照提交的顺序 signal，collect 只需要检查最早的几批
+ * @details 线程安全，可以在加载线程中交给 queue；end_frame 以及 collect 需要在提交命令的线程中调用
+ * @example
+ * \n - device.deletion_queue().retire(std::move(old_buffer));
+ * \n - device.deletion_queue().destroy(old_pipeline);
+ */
+class DeletionQueue
+{
+public:
+    explicit DeletionQueue(Device& device);
+    ~DeletionQueue();
+
+
+    /**
+     * 在 GPU 不再使用之后调用 deleter
+     */
+    void push(std::function<void()> deleter);
+
+
+    /**
+     * 接管对象的所有权，例如 Buffer，Image2D，Texture
+     */
+    template<typename T>
+    void retire(std::shared_ptr<T> object)
+    {
+        if (object)
+            push([object = std::move(object)]() mutable { object.reset(); });
+    }
+
+    template<typename T>
+    void retire(std::unique_ptr<T> object)
+    {
+        retire(std::shared_ptr<T>(std::move(object)));
+    }
+
+
+    /**
+     * 销毁 vulkan handle，例如 image view，pipeline，sampler
+     */
+    template<typename handle_t>
+    void destroy(handle_t handle)
+    {
+        if (handle)
+            push([vkdevice = _vkdevice, handle] { vkdevice.destroy(handle); });
+    }
+
+
+    /**
+     * 释放 descriptor set，pool 需要有 FREE_DESCRIPTOR_SET 的 flag
+     */
+    void free(vk::DescriptorSet descriptor_set, vk::DescriptorPool pool)
+    {
+        if (descriptor_set)
+            push([vkdevice = _vkdevice, descriptor_set, pool] { vkdevice.freeDescriptorSets(pool, descriptor_set); });
+    }
+
+
+    /**
+     * 在一帧的所有命令提交之后调用：为这一帧交给 queue 的资源插入 fence
+     */
+    void end_frame();
+
+
+    /**
+     * 销毁 fence 已经 signal 的资源，不会等待
+     */
+    void collect();
+
+
+    /**
+     * 等待 device idle，然后销毁所有的资源。用于退出，以及需要立即释放显存的时候
+     */
+    void flush();
+
+
+    // 还没有被销毁的资源数量
+    size_t pending_num() const;
+
+
+private:
+    struct Batch
+    {
+        vk::Fence                          fence;
+        std::vector<std::function<void()>> deleters;
+    };
+
+
+    Device&    _device;
+    vk::Device _vkdevice;
+
+    mutable std::mutex                 _mutex;
+    std::vector<std::function<void()>> _current;    // 当前帧交给 queue 的资源，还没有 fence
+    std::deque<Batch>                  _batches;    // 按照提交的顺序排列
+};
+
+}    // namespace Hiss
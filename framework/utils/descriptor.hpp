@@ -2,6 +2,9 @@
 #include "engine/engine.hpp"
 #include "vk_func.hpp"
 
+#include <utility>
+#include <unordered_map>
+
 
 namespace Hiss
 {
@@ -50,6 +53,7 @@ struct DescriptorLayout
 
 /**
  * 对 descriptor set 的简单包装
+ * @details 析构时释放 set，因此不能拷贝；移动之后，原来的对象不再持有 set
  */
 struct DescriptorSet
 {
@@ -65,11 +69,57 @@ struct DescriptorSet
     explicit DescriptorSet(Hiss::Engine& engine, const std::shared_ptr<DescriptorLayout>& layout,
                            const std::string& name)
         : device(layout->device),
-          layout(layout)
+          layout(layout),
+          pool(engine.descriptor_pool()),
+          _name(name)
     {
         vk_descriptor_set = engine.create_descriptor_set(layout->layout, name);
     }
 
+    // 之前提交的 frame 可能仍然在使用这个 set
+    ~DescriptorSet()
+    {
+        if (vk_descriptor_set)
+            device.deletion_queue().free(vk_descriptor_set, pool);
+    }
+
+    DescriptorSet(const DescriptorSet&)            = delete;
+    DescriptorSet& operator=(const DescriptorSet&) = delete;
+
+    DescriptorSet(DescriptorSet&& other) noexcept
+        : device(other.device),
+          layout(std::move(other.layout)),
+          pool(other.pool),
+          vk_descriptor_set(std::exchange(other.vk_descriptor_set, VK_NULL_HANDLE)),
+          _name(std::move(other._name)),
+          _contents(std::move(other._contents)),
+          _alive(std::move(other._alive))
+    {
+        // 已经注册的 listener 通过 _alive 找到当前的对象
+        if (_alive)
+            *_alive = this;
+    }
+
+    DescriptorSet& operator=(DescriptorSet&& other) noexcept
+    {
+        assert(&device == &other.device);
+        if (this == &other)
+            return *this;
+
+        if (vk_descriptor_set)
+            device.deletion_queue().free(vk_descriptor_set, pool);
+
+        layout            = std::move(other.layout);
+        pool              = other.pool;
+        vk_descriptor_set = std::exchange(other.vk_descriptor_set, VK_NULL_HANDLE);
+        _name             = std::move(other._name);
+        _contents         = std::move(other._contents);
+        _alive            = std::move(other._alive);
+        if (_alive)
+            *_alive = this;
+        return *this;
+    }
+
 
     void write(const std::vector<WriteContent>& contents)
     {
@@ -82,7 +132,63 @@ struct DescriptorSet
     }
 
 
+    /**
+     * 写入 descriptor，并且在资源被 Defragmenter 移动之后重新写入
+     * @details 移动时之前提交的 frame 可能仍然在使用这个 set，因此重新分配一个 set，而不是原地更新
+     */
     void write(const WriteContent& content, uint32_t idx)
+    {
+        _update(content, idx);
+
+        Relocatable* resource = _resource(content);
+        bool         rebound  = !_contents.count(idx) || _resource(_contents[idx]) != resource;
+        _contents[idx]        = content;
+        if (!resource || !rebound)
+            return;
+
+        // binding 之后被写入了其他资源时，旧资源的 listener 不再生效；移动之后 self 指向新的对象
+        resource->add_relocation_listener(_alive, [self = _alive.get(), resource, idx] {
+            auto& set  = **self;
+            auto  iter = set._contents.find(idx);
+            if (iter != set._contents.end() && _resource(iter->second) == resource)
+                set._reallocate();
+        });
+    }
+
+
+    Hiss::Device&                     device;
+    std::shared_ptr<DescriptorLayout> layout;
+    vk::DescriptorPool                pool;
+    vk::DescriptorSet                 vk_descriptor_set;
+
+
+private:
+    static Relocatable* _resource(const WriteContent& content)
+    {
+        return content.buffer ? static_cast<Relocatable*>(content.buffer) : static_cast<Relocatable*>(content.image);
+    }
+
+
+    // 分配新的 set 并写入所有的 binding，旧的 set 交给 deletion queue
+    void _reallocate()
+    {
+        device.deletion_queue().free(vk_descriptor_set, pool);
+        vk_descriptor_set = device.vkdevice()
+                                    .allocateDescriptorSets(vk::DescriptorSetAllocateInfo{
+                                            .descriptorPool     = pool,
+                                            .descriptorSetCount = 1,
+                                            .pSetLayouts        = &layout->layout,
+                                    })
+                                    .front();
+        if (!_name.empty())
+            device.set_debug_name(vk::ObjectType::eDescriptorSet, (VkDescriptorSet) vk_descriptor_set, _name);
+
+        for (auto& [idx, content]: _contents)
+            _update(content, idx);
+    }
+
+
+    void _update(const WriteContent& content, uint32_t idx)
     {
         assert(layout->bindings.size() > idx);
 
@@ -131,9 +237,11 @@ struct DescriptorSet
     }
 
 
-    Hiss::Device&                     device;
-    std::shared_ptr<DescriptorLayout> layout;
-    vk::DescriptorSet                 vk_descriptor_set;
+    std::string                                _name;
+    std::unordered_map<uint32_t, WriteContent> _contents;    // 每个 binding 当前的内容
+
+    // listener 的生命周期，set 析构之后 listener 失效；指向当前的对象，移动时更新
+    std::shared_ptr<DescriptorSet*> _alive = std::make_shared<DescriptorSet*>(this);
 };
 
 }    // namespace Hiss
\ No newline at end of file
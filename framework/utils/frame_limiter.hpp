@@ -0,0 +1,65 @@
+#pragma once
+#include <chrono>
+#include <thread>
+
+
+namespace Hiss
+{
+
+
+/**
+ * CPU 端的帧率限制：每一帧调用一次 wait，使得相邻两次 wait 返回的间隔不小于 1 / fps
+ * @details 先 sleep 到截止时间之前约 1ms，剩下的时间通过 yield 自旋，避免 sleep 的精度不够导致帧时间抖动
+ * @details 截止时间按照固定的间隔推进，偶尔某一帧较慢时，之后的帧会追上；落后超过一帧时重新计时
+ * @details 应该在采样输入之前调用，这样输入到显示的延迟最短
+ */
+class FrameLimiter
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+
+    /**
+     * @param fps 0 表示不限制
+     */
+    void set_fps(double fps)
+    {
+        _fps      = fps > 0.0 ? fps : 0.0;
+        _deadline = {};
+        if (_fps > 0.0)
+            _interval = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / _fps));
+    }
+
+    double fps() const { return _fps; }
+
+
+    void wait()
+    {
+        if (_fps <= 0.0)
+            return;
+
+        auto now = clock::now();
+        if (_deadline == clock::time_point{} || now > _deadline + _interval)
+        {
+            _deadline = now + _interval;
+            return;
+        }
+
+        if (now < _deadline - SPIN_TIME)
+            std::this_thread::sleep_for(_deadline - SPIN_TIME - now);
+        while (clock::now() < _deadline)
+            std::this_thread::yield();
+
+        _deadline += _interval;
+    }
+
+
+private:
+    static constexpr std::chrono::milliseconds SPIN_TIME{1};
+
+    double            _fps      = 0.0;
+    clock::duration   _interval = {};
+    clock::time_point _deadline = {};
+};
+
+}    // namespace Hiss
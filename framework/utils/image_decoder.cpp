@@ -0,0 +1,65 @@
+#include "utils/image_decoder.hpp"
+
+#include <chrono>
+#include <spdlog/spdlog.h>
+
+
+Hiss::ImageDecoder::ImageDecoder(JobSystem& jobs)
+    : thread_num(jobs.worker_num() + 1),
+      _jobs(jobs)
+{}
+
+
+std::vector<Hiss::ImageDecoder::Result> Hiss::ImageDecoder::decode(const std::vector<std::filesystem::path>& paths,
+                                                                   int desired_channels)
+{
+    std::vector<Result> results(paths.size());
+    if (paths.empty())
+        return results;
+
+    auto start = std::chrono::steady_clock::now();
+
+
+    // 每张图片一个 job，图片大小差异很大时通过窃取保持负载均衡；调用者所在的线程也参与解码
+    _jobs.parallel_for(0, paths.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            results[i].path = paths[i];
+            try
+            {
+                results[i].image = std::make_unique<Stbi_8Bit_RAII>(paths[i].string(), desired_channels);
+            }
+            catch (const std::exception& e)
+            {
+                results[i].error = e.what();
+            }
+        }
+    });
+    uint32_t worker_num = std::min<uint32_t>(thread_num(), (uint32_t) paths.size());
+
+
+    // 统计吞吐量
+    Stats stats{.image_num = (uint32_t) paths.size(), .thread_num = worker_num};
+    stats.duration_ms =
+            std::chrono::duration<double, std::chrono::milliseconds::period>(std::chrono::steady_clock::now() - start)
+                    .count();
+    for (auto& result: results)
+    {
+        if (!result.image)
+        {
+            spdlog::error("[image decoder] {}", result.error);
+            continue;
+        }
+        std::error_code ec;
+        auto            file_size = std::filesystem::file_size(result.path, ec);
+        stats.file_bytes += ec ? 0 : file_size;
+        stats.decoded_bytes += result.image->size();
+    }
+    last_stats = stats;
+
+    spdlog::info("[image decoder] {} images, {} threads, {:.2f} MB -> {:.2f} MB in {:.1f} ms ({:.1f} MB/s)",
+                 stats.image_num, stats.thread_num, (double) stats.file_bytes / (1024.0 * 1024.0),
+                 (double) stats.decoded_bytes / (1024.0 * 1024.0), stats.duration_ms, stats.throughput());
+
+    return results;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <filesystem>
+
+#include "utils/tools.hpp"
+#include "utils/stbi.hpp"
+#include "utils/job_system.hpp"
+
+
+namespace Hiss
+{
+
+/**
+ * 在 JobSystem 的 worker 线程上并行地解码图片，只进行 CPU 的工作，不涉及 GPU
+ * @details 解码使用 stb_image，其 JPEG 的 IDCT 以及 YCbCr 转换在 x86 上使用 SSE2，在 ARM 上使用 NEON
+ * @details 解码之后的数据交给调用者所在的线程去上传到 GPU
+ */
+class ImageDecoder
+{
+public:
+    struct Result
+    {
+        std::filesystem::path           path;
+        std::unique_ptr<Stbi_8Bit_RAII> image;    // 解码失败时为空
+        std::string                     error;
+    };
+
+    struct Stats
+    {
+        uint32_t image_num     = 0;
+        uint32_t thread_num    = 0;
+        size_t   file_bytes    = 0;     // 压缩数据的大小
+        size_t   decoded_bytes = 0;     // 解码之后的数据大小
+        double   duration_ms   = 0.0;
+
+        // 以解码之后的数据量来计算吞吐量，单位是 MB/s
+        double throughput() const
+        {
+            return duration_ms > 0.0 ? (double) decoded_bytes / (1024.0 * 1024.0) / (duration_ms / 1000.0) : 0.0;
+        }
+    };
+
+
+    explicit ImageDecoder(JobSystem& jobs);
+
+
+    /**
+     * 并行地解码所有图片，阻塞直到全部完成。结果的顺序和 paths 的顺序一致
+     * @param desired_channels 参考 Stbi_8Bit_RAII
+     */
+    std::vector<Result> decode(const std::vector<std::filesystem::path>& paths, int desired_channels = STBI_rgb_alpha);
+
+
+public:
+    Prop<uint32_t, ImageDecoder> thread_num{0};    // worker 的数量，加上调用者所在的线程
+    Prop<Stats, ImageDecoder>    last_stats{};     // 最近一次 decode 的统计数据
+
+
+private:
+    JobSystem& _jobs;
+};
+
+}    // namespace Hiss
@@ -0,0 +1,415 @@
+#include "utils/job_system.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <exception>
+#include <spdlog/spdlog.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+
+namespace
+{
+
+// 当前线程是哪个 JobSystem 的第几个 worker
+thread_local Hiss::JobSystem*   t_owner        = nullptr;
+thread_local int                t_worker_index = -1;
+thread_local Hiss::LinearArena* t_scratch      = nullptr;
+
+
+int64_t elapsed_ns(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+}    // namespace
+
+
+Hiss::JobSystem::JobSystem(const Config& config)
+    : _config(config),
+      _main_thread(std::this_thread::get_id())
+{
+    // 至少有一个 worker，这样 Affinity::Any 的 job 不依赖于调用者去 wait
+    uint32_t worker_num = config.worker_num;
+    if (worker_num == 0)
+        worker_num = std::max(1u, std::thread::hardware_concurrency() - 1);
+
+    _workers.reserve(worker_num);
+    for (uint32_t i = 0; i < worker_num; ++i)
+        _workers.push_back(std::make_unique<Worker>(config.scratch_bytes));
+
+    // 所有的 worker 都创建之后才启动线程，worker 之间会互相访问队列
+    for (uint32_t i = 0; i < worker_num; ++i)
+    {
+        _workers[i]->thread = std::thread(&JobSystem::_worker_loop, this, i);
+        if (config.pin_threads)
+            _pin_thread(i);
+    }
+
+    spdlog::info("[job system] {} workers, pin threads: {}, scratch {} KB", worker_num, config.pin_threads,
+                 config.scratch_bytes / 1024);
+}
+
+
+Hiss::JobSystem::~JobSystem()
+{
+    // 主线程的 job 也需要执行，其他 job 可能依赖于它们
+    run_main_thread_jobs();
+
+    {
+        std::lock_guard<std::mutex> lock(_sleep_mutex);
+        _stop = true;
+    }
+    _sleep_cv.notify_all();
+    for (auto& worker: _workers)
+        worker->thread.join();
+}
+
+
+void Hiss::JobSystem::_pin_thread(uint32_t index)
+{
+#ifdef __linux__
+    // 主线程通常在 0 号核心上，worker 从 1 号核心开始
+    uint32_t core_num = std::max(1u, std::thread::hardware_concurrency());
+
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET((index + 1) % core_num, &cpu_set);
+    if (pthread_setaffinity_np(_workers[index]->thread.native_handle(), sizeof(cpu_set_t), &cpu_set) != 0)
+        spdlog::warn("[job system] fail to pin worker {} to core {}", index, (index + 1) % core_num);
+#else
+    if (index == 0)
+        spdlog::warn("[job system] thread pinning is not supported on this platform");
+#endif
+}
+
+
+Hiss::JobSystem::JobHandle Hiss::JobSystem::create(std::function<void()> func, Affinity affinity)
+{
+    return std::make_shared<Job>(std::move(func), affinity);
+}
+
+
+void Hiss::JobSystem::depend(const JobHandle& job, const JobHandle& dependency)
+{
+    job->pending.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(dependency->mutex);
+        if (!dependency->done)
+        {
+            dependency->continuations.push_back(job);
+            return;
+        }
+    }
+
+    // 依赖已经完成了
+    job->pending.fetch_sub(1);
+}
+
+
+Hiss::JobSystem::JobHandle Hiss::JobSystem::then(const JobHandle& job, std::function<void()> func, Affinity affinity)
+{
+    auto continuation = create(std::move(func), affinity);
+    depend(continuation, job);
+    submit(continuation);
+    return continuation;
+}
+
+
+void Hiss::JobSystem::submit(const JobHandle& job)
+{
+    if (job->pending.fetch_sub(1) == 1)
+        _enqueue(job);
+}
+
+
+bool Hiss::JobSystem::is_done(const JobHandle& job)
+{
+    return job->done.load();
+}
+
+
+void Hiss::JobSystem::wait(const JobHandle& job)
+{
+    _wait_done(job);
+    if (job->error)
+        std::rethrow_exception(job->error);
+}
+
+
+void Hiss::JobSystem::_wait_done(const JobHandle& job)
+{
+    int  self    = t_owner == this ? t_worker_index : -1;
+    bool is_main = std::this_thread::get_id() == _main_thread;
+
+    while (!job->done.load())
+    {
+        if (is_main && run_main_thread_jobs() > 0)
+            continue;
+        if (_try_run_one(self))
+            continue;
+
+        // 等待的 job 正在其他线程上执行
+        std::this_thread::yield();
+    }
+}
+
+
+void Hiss::JobSystem::parallel_for(size_t begin, size_t end, size_t grain,
+                                   const std::function<void(size_t, size_t)>& func)
+{
+    if (end <= begin)
+        return;
+
+    // 每个线程大约分到 4 段，段的大小不均匀时也能通过窃取保持负载均衡
+    size_t count = end - begin;
+    if (grain == 0)
+        grain = std::max<size_t>(1, count / ((worker_num() + 1) * 4));
+    if (count <= grain)
+    {
+        func(begin, end);
+        return;
+    }
+
+
+    std::vector<JobHandle> jobs;
+    jobs.reserve((count + grain - 1) / grain);
+    for (size_t first = begin; first < end; first += grain)
+    {
+        size_t last = std::min(end, first + grain);
+        jobs.push_back(run([&func, first, last] { func(first, last); }));
+    }
+
+    // job 引用了 func，所有的段都完成之后才能抛出
+    std::exception_ptr error;
+    for (auto& job: jobs)
+    {
+        _wait_done(job);
+        if (job->error && !error)
+            error = job->error;
+    }
+    if (error)
+        std::rethrow_exception(error);
+}
+
+
+uint32_t Hiss::JobSystem::run_main_thread_jobs()
+{
+    assert(std::this_thread::get_id() == _main_thread);
+
+    std::deque<JobHandle> jobs;
+    {
+        std::lock_guard<std::mutex> lock(_main_mutex);
+        jobs.swap(_main_queue);
+    }
+
+    for (auto& job: jobs)
+        _execute(job, nullptr);
+    return (uint32_t) jobs.size();
+}
+
+
+Hiss::LinearArena& Hiss::JobSystem::scratch()
+{
+    if (t_scratch)
+        return *t_scratch;
+
+    static thread_local LinearArena arena{Config{}.scratch_bytes};
+    return arena;
+}
+
+
+void Hiss::JobSystem::_worker_loop(uint32_t index)
+{
+    auto& worker   = *_workers[index];
+    t_owner        = this;
+    t_worker_index = (int) index;
+    t_scratch      = &worker.scratch;
+
+    while (true)
+    {
+        if (_try_run_one((int) index))
+            continue;
+
+        auto idle_start = std::chrono::steady_clock::now();
+        {
+            std::unique_lock<std::mutex> lock(_sleep_mutex);
+            _sleep_cv.wait(lock, [this] { return _stop || _queued_num.load() > 0; });
+
+            // 退出之前，需要执行完队列中剩余的 job
+            if (_stop && _queued_num.load() == 0)
+                return;
+        }
+        worker.idle_ns += elapsed_ns(idle_start);
+    }
+}
+
+
+void Hiss::JobSystem::_enqueue(JobHandle job)
+{
+    if (job->affinity == Affinity::Main)
+    {
+        std::lock_guard<std::mutex> lock(_main_mutex);
+        _main_queue.push_back(std::move(job));
+        return;
+    }
+
+    // worker 提交的 job 放入自己的队列，其他线程提交的 job 轮流放入各个队列
+    size_t target = t_owner == this ? (size_t) t_worker_index : _next_queue.fetch_add(1) % _workers.size();
+    {
+        std::lock_guard<std::mutex> lock(_workers[target]->mutex);
+        _workers[target]->queue.push_back(std::move(job));
+    }
+
+    // 先持有 sleep mutex 再通知，避免 worker 在检查条件之后、休眠之前错过通知
+    {
+        std::lock_guard<std::mutex> lock(_sleep_mutex);
+        _queued_num.fetch_add(1);
+    }
+    _sleep_cv.notify_one();
+}
+
+
+bool Hiss::JobSystem::_try_run_one(int self_index)
+{
+    if (_queued_num.load() <= 0)
+        return false;
+
+    JobHandle job;
+    Worker*   self = self_index >= 0 ? _workers[self_index].get() : nullptr;
+
+
+    // 自己的队列：从尾部取出最近放入的 job
+    if (self)
+    {
+        std::lock_guard<std::mutex> lock(self->mutex);
+        if (!self->queue.empty())
+        {
+            job = std::move(self->queue.back());
+            self->queue.pop_back();
+        }
+    }
+
+
+    // 从其他队列的头部窃取
+    if (!job)
+    {
+        size_t start = self_index >= 0 ? (size_t) self_index + 1 : 0;
+        for (size_t i = 0; i < _workers.size() && !job; ++i)
+        {
+            auto& victim = *_workers[(start + i) % _workers.size()];
+            if (&victim == self)
+                continue;
+
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.queue.empty())
+            {
+                job = std::move(victim.queue.front());
+                victim.queue.pop_front();
+                if (self)
+                    self->steal_num++;
+            }
+        }
+    }
+
+    if (!job)
+        return false;
+
+    _queued_num.fetch_sub(1);
+    _execute(job, self);
+    return true;
+}
+
+
+void Hiss::JobSystem::_execute(const JobHandle& job, Worker* worker)
+{
+    auto& arena  = scratch();
+    auto  marker = arena.marker();
+    auto  start  = std::chrono::steady_clock::now();
+
+    try
+    {
+        job->func();
+    }
+    catch (const std::exception& e)
+    {
+        job->error = std::current_exception();
+        spdlog::debug("[job system] exception in job: {}", e.what());
+    }
+    catch (...)
+    {
+        job->error = std::current_exception();
+        spdlog::debug("[job system] unknown exception in job");
+    }
+
+    arena.rewind(marker);
+    if (worker)
+    {
+        worker->busy_ns += elapsed_ns(start);
+        worker->job_num++;
+    }
+
+    _finish(job);
+}
+
+
+void Hiss::JobSystem::_finish(const JobHandle& job)
+{
+    // 释放 func 中捕获的资源
+    job->func = nullptr;
+
+    std::vector<JobHandle> continuations;
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->done = true;
+        continuations.swap(job->continuations);
+    }
+
+    for (auto& continuation: continuations)
+        submit(continuation);
+}
+
+
+std::vector<Hiss::JobSystem::WorkerStats> Hiss::JobSystem::stats() const
+{
+    std::vector<WorkerStats> result;
+    result.reserve(_workers.size());
+    for (auto& worker: _workers)
+    {
+        result.push_back(WorkerStats{
+                .busy_ms   = (double) worker->busy_ns.load() / 1e6,
+                .idle_ms   = (double) worker->idle_ns.load() / 1e6,
+                .job_num   = worker->job_num.load(),
+                .steal_num = worker->steal_num.load(),
+        });
+    }
+    return result;
+}
+
+
+void Hiss::JobSystem::log_stats() const
+{
+    auto all = stats();
+    for (size_t i = 0; i < all.size(); ++i)
+    {
+        auto& s = all[i];
+        spdlog::info("[job system] worker {}: busy {:.1f} ms, idle {:.1f} ms, {} jobs, {} steals", i, s.busy_ms,
+                     s.idle_ms, s.job_num, s.steal_num);
+    }
+}
+
+
+void Hiss::JobSystem::reset_stats()
+{
+    for (auto& worker: _workers)
+    {
+        worker->busy_ns   = 0;
+        worker->idle_ns   = 0;
+        worker->job_num   = 0;
+        worker->steal_num = 0;
+    }
+}
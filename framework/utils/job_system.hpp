@@ -0,0 +1,214 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "utils/arena.hpp"
+
+
+namespace Hiss
+{
+
+/**
+ * work stealing 的线程池
+ * @details 每个 worker 有自己的双端队列：worker 在自己的队列尾部放入、取出 job（LIFO，cache 友好），
+ *  空闲时从其他队列的头部窃取（FIFO，窃取到的通常是较大的任务）
+ * @details job 之间可以有依赖：job 在所有依赖完成之后才会被放入队列；then 可以为 job 添加 continuation
+ * @details Affinity::Main 的 job 只会在主线程上执行（例如需要调用 GLFW 的任务），由主线程调用 run_main_thread_jobs
+ * @details wait 不会阻塞线程：等待期间会执行其他的 job，因此可以在 job 中嵌套地 wait，也可以嵌套 parallel_for
+ * @details job 中抛出的异常保存在 job 上，由 wait 重新抛出；continuation 仍然会执行
+ * @example
+ * \n - auto load = jobs.create([] { ... });
+ * \n - auto upload = jobs.then(load, [] { ... }, JobSystem::Affinity::Main);
+ * \n - jobs.submit(load); ... jobs.wait(upload);
+ */
+class JobSystem
+{
+public:
+    struct Config
+    {
+        uint32_t worker_num    = 0;        // 0 表示 CPU 核心数 - 1，调用者所在的线程在 wait 时也会执行 job
+        bool     pin_threads   = false;    // 将 worker 绑定到固定的 CPU 核心上，只在 Linux 上有效
+        size_t   scratch_bytes = 256 * 1024;
+    };
+
+
+    enum class Affinity
+    {
+        Any,
+        Main,    // 只在主线程（创建 JobSystem 的线程）上执行
+    };
+
+
+    struct WorkerStats
+    {
+        double   busy_ms   = 0.0;    // 执行 job 的时间
+        double   idle_ms   = 0.0;    // 没有 job 可以执行，休眠的时间
+        uint64_t job_num   = 0;
+        uint64_t steal_num = 0;      // 从其他 worker 的队列中窃取的 job 数量
+    };
+
+
+    class Job;
+    using JobHandle = std::shared_ptr<Job>;
+
+
+    explicit JobSystem(const Config& config);
+    JobSystem()
+        : JobSystem(Config{})
+    {}
+    ~JobSystem();
+
+
+    /**
+     * 创建 job，但是不会执行：添加依赖之后，调用 submit 才会被放入队列
+     */
+    JobHandle create(std::function<void()> func, Affinity affinity = Affinity::Any);
+
+
+    /**
+     * job 在 dependency 完成之后才会执行，需要在 submit(job) 之前调用
+     */
+    void depend(const JobHandle& job, const JobHandle& dependency);
+
+
+    /**
+     * continuation：创建在 job 完成之后执行的 job，并且 submit
+     */
+    JobHandle then(const JobHandle& job, std::function<void()> func, Affinity affinity = Affinity::Any);
+
+
+    /**
+     * 依赖都完成之后，job 会被放入队列；每个 job 只能 submit 一次
+     */
+    void submit(const JobHandle& job);
+
+
+    // create 并且 submit
+    JobHandle run(std::function<void()> func, Affinity affinity = Affinity::Any)
+    {
+        auto job = create(std::move(func), affinity);
+        submit(job);
+        return job;
+    }
+
+
+    /**
+     * 等待 job 完成，等待期间会执行其他的 job
+     * @details 在主线程上等待时，也会执行 Affinity::Main 的 job
+     * @details job 抛出了异常时，在完成之后重新抛出
+     */
+    void wait(const JobHandle& job);
+
+
+    static bool is_done(const JobHandle& job);
+
+
+    /**
+     * 将 [begin, end) 分为若干段，每段不超过 grain 个元素，并行地调用 func(begin, end)，阻塞直到全部完成
+     * @details 调用者所在的线程也会参与执行；func 中的异常会在所有的段完成之后重新抛出（只保留第一个）
+     * @param grain 为 0 时，根据 worker 的数量自动选择
+     */
+    void parallel_for(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& func);
+
+
+    /**
+     * 在主线程上执行所有 Affinity::Main 的 job，每一帧调用一次
+     * @return 执行的 job 数量
+     */
+    uint32_t run_main_thread_jobs();
+
+
+    /**
+     * 当前线程的 scratch arena，用于 job 中的临时数据；job 执行完成之后，会回退到执行之前的位置
+     * @details 不是 worker 的线程（例如主线程）使用 thread local 的 arena
+     */
+    static LinearArena& scratch();
+
+
+    // 每个 worker 的统计数据，按照 worker 的索引排列
+    std::vector<WorkerStats> stats() const;
+    void                     log_stats() const;
+    void                     reset_stats();
+
+    uint32_t worker_num() const { return (uint32_t) _workers.size(); }
+
+
+private:
+    struct Worker
+    {
+        std::thread           thread;
+        std::mutex            mutex;
+        std::deque<JobHandle> queue;
+        LinearArena           scratch;
+        std::atomic<int64_t>  busy_ns{0};
+        std::atomic<int64_t>  idle_ns{0};
+        std::atomic<uint64_t> job_num{0};
+        std::atomic<uint64_t> steal_num{0};
+
+        explicit Worker(size_t scratch_bytes)
+            : scratch(scratch_bytes)
+        {}
+    };
+
+
+    void _worker_loop(uint32_t index);
+    void _pin_thread(uint32_t index);
+
+    void _enqueue(JobHandle job);
+
+    // 从自己的队列，或者其他 worker 的队列中取出一个 job，并执行
+    bool _try_run_one(int self_index);
+    void _execute(const JobHandle& job, Worker* worker);
+    void _wait_done(const JobHandle& job);    // 与 wait 相同，但是不会重新抛出 job 中的异常
+    void _finish(const JobHandle& job);
+
+
+    Config                               _config;
+    std::thread::id                      _main_thread;
+    std::vector<std::unique_ptr<Worker>> _workers;
+
+    // 主线程的 job
+    std::mutex            _main_mutex;
+    std::deque<JobHandle> _main_queue;
+
+    // 没有 job 时，worker 在这里休眠
+    std::mutex              _sleep_mutex;
+    std::condition_variable _sleep_cv;
+    std::atomic<int64_t>    _queued_num{0};    // 所有 worker 队列中 job 的数量
+    std::atomic<uint32_t>   _next_queue{0};    // 非 worker 线程提交 job 时，轮流放入各个 worker 的队列
+    bool                    _stop = false;
+};
+
+
+class JobSystem::Job
+{
+public:
+    explicit Job(std::function<void()> func, Affinity affinity)
+        : func(std::move(func)),
+          affinity(affinity)
+    {}
+
+
+private:
+    friend JobSystem;
+
+    std::function<void()> func;
+    Affinity              affinity;
+    std::exception_ptr    error;    // 在 done 之前写入
+
+    // 还没有完成的依赖数量，初始的 1 表示还没有 submit
+    std::atomic<int>  pending{1};
+    std::atomic<bool> done{false};
+
+    std::mutex             mutex;    // 保护 continuations 以及 done 的写入
+    std::vector<JobHandle> continuations;
+};
+
+}    // namespace Hiss
@@ -0,0 +1,382 @@
+#include "utils/ktx.hpp"
+
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <fmt/format.h>
+
+
+namespace
+{
+
+const std::array<uint8_t, 12> KTX1_IDENTIFIER = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31,
+                                                 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+const std::array<uint8_t, 12> KTX2_IDENTIFIER = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32,
+                                                 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+const uint32_t KTX1_ENDIANNESS = 0x04030201;
+
+
+// 从 data 中读取一个值，越界时抛出异常
+template<typename T>
+T read(const std::vector<uint8_t>& data, size_t offset)
+{
+    if (offset + sizeof(T) > data.size())
+        throw std::runtime_error("[ktx] unexpected end of file");
+    T value;
+    std::memcpy(&value, data.data() + offset, sizeof(T));
+    return value;
+}
+
+}    // namespace
+
+
+Hiss::KtxFile::KtxFile(const std::filesystem::path& path)
+    : path(path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        throw std::runtime_error(fmt::format("[ktx] failed to open file: {}", path.string()));
+
+    data.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+
+
+    if (data.size() >= 12 && std::equal(KTX1_IDENTIFIER.begin(), KTX1_IDENTIFIER.end(), data.begin()))
+        _parse_ktx1();
+    else if (data.size() >= 12 && std::equal(KTX2_IDENTIFIER.begin(), KTX2_IDENTIFIER.end(), data.begin()))
+        _parse_ktx2();
+    else
+        throw std::runtime_error(fmt::format("[ktx] not a ktx file: {}", path.string()));
+
+
+    // 检查每个 level 都在文件的范围内
+    for (auto& level: levels._value)
+        if (level.offset + level.size > data.size())
+            throw std::runtime_error(fmt::format("[ktx] level data out of range: {}", path.string()));
+}
+
+
+/**
+ * KTX1 的布局：
+ *  - identifier(12) | header(13 x uint32) | key value data
+ *  - loop(level)
+ *      |_ imageSize(uint32) | data | mipPadding（对齐到 4 byte）
+ */
+void Hiss::KtxFile::_parse_ktx1()
+{
+    if (read<uint32_t>(data, 12) != KTX1_ENDIANNESS)
+        throw std::runtime_error(fmt::format("[ktx] big-endian ktx is not supported: {}", path._value.string()));
+
+    uint32_t gl_internal_format = read<uint32_t>(data, 12 + 4 * 4);
+    uint32_t width              = read<uint32_t>(data, 12 + 4 * 6);
+    uint32_t height             = read<uint32_t>(data, 12 + 4 * 7);
+    uint32_t depth              = read<uint32_t>(data, 12 + 4 * 8);
+    uint32_t array_num          = read<uint32_t>(data, 12 + 4 * 9);
+    uint32_t face_num           = read<uint32_t>(data, 12 + 4 * 10);
+    uint32_t level_num          = std::max(1u, read<uint32_t>(data, 12 + 4 * 11));
+    uint32_t kv_bytes           = read<uint32_t>(data, 12 + 4 * 12);
+
+    if (depth > 1 || array_num > 0 || face_num != 1)
+        throw std::runtime_error(fmt::format("[ktx] only 2d texture is supported: {}", path._value.string()));
+
+    format = _gl_to_vk(gl_internal_format);
+    if (format._value == vk::Format::eUndefined)
+        throw std::runtime_error(fmt::format("[ktx] unsupported glInternalFormat: {:#x}, {}", gl_internal_format,
+                                             path._value.string()));
+    extent = vk::Extent2D{width, std::max(1u, height)};
+
+
+    size_t offset = 12 + 4 * 13 + kv_bytes;
+    for (uint32_t i = 0; i < level_num; ++i)
+    {
+        auto image_size = read<uint32_t>(data, offset);
+        offset += 4;
+        levels._value.push_back(Level{
+                .offset = offset,
+                .size   = image_size,
+                .width  = std::max(1u, width >> i),
+                .height = std::max(1u, extent._value.height >> i),
+        });
+        offset += (image_size + 3) & ~3u;
+    }
+}
+
+
+/**
+ * KTX2 的布局：
+ *  - identifier(12) | header(9 x uint32) | index(4 x uint32 + 2 x uint64) | level index(levelCount x 3 x uint64)
+ *  - level index 中记录了每个 level 在文件中的位置
+ */
+void Hiss::KtxFile::_parse_ktx2()
+{
+    auto     vk_format     = read<uint32_t>(data, 12);
+    uint32_t width         = read<uint32_t>(data, 12 + 4 * 2);
+    uint32_t height        = read<uint32_t>(data, 12 + 4 * 3);
+    uint32_t depth         = read<uint32_t>(data, 12 + 4 * 4);
+    uint32_t layer_num     = read<uint32_t>(data, 12 + 4 * 5);
+    uint32_t face_num      = read<uint32_t>(data, 12 + 4 * 6);
+    uint32_t level_num     = std::max(1u, read<uint32_t>(data, 12 + 4 * 7));
+    uint32_t supercompress = read<uint32_t>(data, 12 + 4 * 8);
+
+    if (depth > 1 || layer_num > 0 || face_num != 1)
+        throw std::runtime_error(fmt::format("[ktx] only 2d texture is supported: {}", path._value.string()));
+
+    // BasisLZ(1)，zstd(2)，zlib(3)；vkFormat 为 undefined 时是 UASTC 或者 ETC1S，同样需要 transcoder
+    if (supercompress != 0 || vk_format == VK_FORMAT_UNDEFINED)
+        throw std::runtime_error(fmt::format("[ktx] supercompressed or basis universal ktx2 is not supported: {}",
+                                             path._value.string()));
+
+    format = static_cast<vk::Format>(vk_format);
+    extent = vk::Extent2D{width, std::max(1u, height)};
+
+
+    const size_t level_index_offset = 12 + 4 * 9 + 4 * 4 + 8 * 2;
+    for (uint32_t i = 0; i < level_num; ++i)
+    {
+        size_t entry = level_index_offset + i * 3 * sizeof(uint64_t);
+        levels._value.push_back(Level{
+                .offset = static_cast<size_t>(read<uint64_t>(data, entry)),
+                .size   = static_cast<size_t>(read<uint64_t>(data, entry + 8)),
+                .width  = std::max(1u, width >> i),
+                .height = std::max(1u, extent._value.height >> i),
+        });
+    }
+}
+
+
+bool Hiss::KtxFile::is_ktx(const std::filesystem::path& path)
+{
+    auto ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return ext == ".ktx" || ext == ".ktx2";
+}
+
+
+vk::Format Hiss::KtxFile::_gl_to_vk(uint32_t gl_internal_format)
+{
+    switch (gl_internal_format)
+    {
+        // 未压缩的格式
+        case 0x8058: return vk::Format::eR8G8B8A8Unorm;         // GL_RGBA8
+        case 0x8C43: return vk::Format::eR8G8B8A8Srgb;          // GL_SRGB8_ALPHA8
+        case 0x881A: return vk::Format::eR16G16B16A16Sfloat;    // GL_RGBA16F
+        case 0x8814: return vk::Format::eR32G32B32A32Sfloat;    // GL_RGBA32F
+
+        // S3TC，RGTC，BPTC（BC1-BC7）
+        case 0x83F0: return vk::Format::eBc1RgbUnormBlock;     // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+        case 0x83F1: return vk::Format::eBc1RgbaUnormBlock;    // GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+        case 0x83F2: return vk::Format::eBc2UnormBlock;        // GL_COMPRESSED_RGBA_S3TC_DXT3_EXT
+        case 0x83F3: return vk::Format::eBc3UnormBlock;        // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+        case 0x8C4C: return vk::Format::eBc1RgbSrgbBlock;
+        case 0x8C4D: return vk::Format::eBc1RgbaSrgbBlock;
+        case 0x8C4E: return vk::Format::eBc2SrgbBlock;
+        case 0x8C4F: return vk::Format::eBc3SrgbBlock;
+        case 0x8DBB: return vk::Format::eBc4UnormBlock;        // GL_COMPRESSED_RED_RGTC1
+        case 0x8DBC: return vk::Format::eBc4SnormBlock;
+        case 0x8DBD: return vk::Format::eBc5UnormBlock;        // GL_COMPRESSED_RG_RGTC2
+        case 0x8DBE: return vk::Format::eBc5SnormBlock;
+        case 0x8E8E: return vk::Format::eBc6HSfloatBlock;      // GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT
+        case 0x8E8F: return vk::Format::eBc6HUfloatBlock;
+        case 0x8E8C: return vk::Format::eBc7UnormBlock;        // GL_COMPRESSED_RGBA_BPTC_UNORM
+        case 0x8E8D: return vk::Format::eBc7SrgbBlock;
+
+        // ETC2
+        case 0x9274: return vk::Format::eEtc2R8G8B8UnormBlock;      // GL_COMPRESSED_RGB8_ETC2
+        case 0x9275: return vk::Format::eEtc2R8G8B8SrgbBlock;
+        case 0x9278: return vk::Format::eEtc2R8G8B8A8UnormBlock;    // GL_COMPRESSED_RGBA8_ETC2_EAC
+        case 0x9279: return vk::Format::eEtc2R8G8B8A8SrgbBlock;
+
+        // ASTC
+        case 0x93B0: return vk::Format::eAstc4x4UnormBlock;    // GL_COMPRESSED_RGBA_ASTC_4x4_KHR
+        case 0x93B4: return vk::Format::eAstc6x6UnormBlock;
+        case 0x93B7: return vk::Format::eAstc8x8UnormBlock;
+        case 0x93D0: return vk::Format::eAstc4x4SrgbBlock;     // GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR
+        case 0x93D4: return vk::Format::eAstc6x6SrgbBlock;
+        case 0x93D7: return vk::Format::eAstc8x8SrgbBlock;
+
+        default: return vk::Format::eUndefined;
+    }
+}
+
+
+vk::Format Hiss::KtxFile::to_srgb(vk::Format format)
+{
+    switch (format)
+    {
+        case vk::Format::eR8G8B8A8Unorm: return vk::Format::eR8G8B8A8Srgb;
+        case vk::Format::eBc1RgbUnormBlock: return vk::Format::eBc1RgbSrgbBlock;
+        case vk::Format::eBc1RgbaUnormBlock: return vk::Format::eBc1RgbaSrgbBlock;
+        case vk::Format::eBc2UnormBlock: return vk::Format::eBc2SrgbBlock;
+        case vk::Format::eBc3UnormBlock: return vk::Format::eBc3SrgbBlock;
+        case vk::Format::eBc7UnormBlock: return vk::Format::eBc7SrgbBlock;
+        case vk::Format::eEtc2R8G8B8UnormBlock: return vk::Format::eEtc2R8G8B8SrgbBlock;
+        case vk::Format::eEtc2R8G8B8A8UnormBlock: return vk::Format::eEtc2R8G8B8A8SrgbBlock;
+        case vk::Format::eAstc4x4UnormBlock: return vk::Format::eAstc4x4SrgbBlock;
+        case vk::Format::eAstc6x6UnormBlock: return vk::Format::eAstc6x6SrgbBlock;
+        case vk::Format::eAstc8x8UnormBlock: return vk::Format::eAstc8x8SrgbBlock;
+        default: return format;
+    }
+}
+
+
+bool Hiss::KtxFile::is_srgb(vk::Format format)
+{
+    switch (format)
+    {
+        case vk::Format::eR8G8B8A8Srgb:
+        case vk::Format::eBc1RgbSrgbBlock:
+        case vk::Format::eBc1RgbaSrgbBlock:
+        case vk::Format::eBc2SrgbBlock:
+        case vk::Format::eBc3SrgbBlock:
+        case vk::Format::eBc7SrgbBlock:
+        case vk::Format::eEtc2R8G8B8SrgbBlock:
+        case vk::Format::eEtc2R8G8B8A8SrgbBlock:
+        case vk::Format::eAstc4x4SrgbBlock:
+        case vk::Format::eAstc6x6SrgbBlock:
+        case vk::Format::eAstc8x8SrgbBlock: return true;
+        default: return false;
+    }
+}
+
+
+bool Hiss::KtxFile::is_block_compressed(vk::Format format)
+{
+    auto value = static_cast<uint32_t>(format);
+
+    // BC1 - BC7，ETC2，EAC，ASTC 在 vulkan 中的取值是连续的
+    return value >= static_cast<uint32_t>(vk::Format::eBc1RgbUnormBlock)
+        && value <= static_cast<uint32_t>(vk::Format::eAstc12x12SrgbBlock);
+}
+
+
+/**
+ * KTX2 的写入：
+ *  - identifier | header | index | level index | DFD | level n-1 | ... | level 0
+ *  - level 按照从小到大的顺序存放，每个 level 都对齐到 lcm(texel block size, 4)
+ *  - DFD（data format descriptor）只包含一个 basic block
+ */
+void Hiss::KtxFile::write_ktx2(const std::filesystem::path& path, vk::Format format, vk::Extent2D extent,
+                               const std::vector<std::vector<uint8_t>>& levels)
+{
+    /**
+     * 根据 format 确定 DFD 的内容
+     * @details sample 的格式：(bitOffset, bitLength - 1, channelType, upper)
+     */
+    struct Sample
+    {
+        uint16_t bit_offset;
+        uint8_t  bit_length;
+        uint8_t  channel;
+        uint32_t upper;
+    };
+    uint8_t             color_model = 0;
+    uint8_t             block_dim   = 0;    // texel block 的尺寸 - 1
+    uint8_t             block_bytes = 0;
+    std::vector<Sample> samples;
+    bool                srgb = false;
+    switch (format)
+    {
+        case vk::Format::eR8G8B8A8Srgb: srgb = true; [[fallthrough]];
+        case vk::Format::eR8G8B8A8Unorm:
+            color_model = 1;    // KHR_DF_MODEL_RGBSDA
+            block_bytes = 4;
+            samples     = {{0, 7, 0, 255}, {8, 7, 1, 255}, {16, 7, 2, 255}, {24, 7, 15, 255}};
+            break;
+        case vk::Format::eBc1RgbSrgbBlock: srgb = true; [[fallthrough]];
+        case vk::Format::eBc1RgbUnormBlock:
+            color_model = 128;    // KHR_DF_MODEL_BC1A
+            block_dim   = 3;
+            block_bytes = 8;
+            samples     = {{0, 63, 0, UINT32_MAX}};
+            break;
+        case vk::Format::eBc3SrgbBlock: srgb = true; [[fallthrough]];
+        case vk::Format::eBc3UnormBlock:
+            color_model = 130;    // KHR_DF_MODEL_BC3
+            block_dim   = 3;
+            block_bytes = 16;
+            samples     = {{0, 63, 15, UINT32_MAX}, {64, 63, 0, UINT32_MAX}};
+            break;
+        default:
+            throw std::runtime_error(fmt::format("[ktx] unsupported format for writing: {}", vk::to_string(format)));
+    }
+
+
+    // DFD：dfdTotalSize | basic block header(6 x uint32) | samples(4 x uint32)
+    std::vector<uint32_t> dfd;
+    dfd.push_back(0);
+    dfd.push_back(0);                                                        // vendorId，descriptorType
+    dfd.push_back(2u | (uint32_t) (24 + 16 * samples.size()) << 16);       // versionNumber，descriptorBlockSize
+    dfd.push_back(color_model | 1u << 8 | (srgb ? 2u : 1u) << 16);          // colorPrimaries BT709，transfer
+    dfd.push_back(block_dim | block_dim << 8);                               // texelBlockDimension
+    dfd.push_back(block_bytes);                                              // bytesPlane0
+    dfd.push_back(0);
+    for (auto& sample: samples)
+    {
+        // sRGB 格式中 alpha 是线性的
+        uint8_t qualifier = (srgb && sample.channel == 15) ? 0x10 : 0;
+        dfd.push_back(sample.bit_offset | (uint32_t) sample.bit_length << 16
+                      | (uint32_t) (sample.channel | qualifier) << 24);
+        dfd.push_back(0);
+        dfd.push_back(0);
+        dfd.push_back(sample.upper);
+    }
+    dfd[0] = (uint32_t) (dfd.size() * sizeof(uint32_t));
+
+
+    // 计算各个部分在文件中的位置
+    const size_t level_num   = levels.size();
+    const size_t dfd_offset  = 12 + 4 * 9 + 4 * 4 + 8 * 2 + level_num * 3 * sizeof(uint64_t);
+    const size_t alignment   = block_bytes % 4 == 0 ? block_bytes : 4;
+    auto         align_up    = [](size_t v, size_t a) { return (v + a - 1) / a * a; };
+    size_t       data_offset = dfd_offset + dfd[0];
+
+    std::vector<uint64_t> level_offsets(level_num);
+    for (size_t i = level_num; i-- > 0;)
+    {
+        data_offset      = align_up(data_offset, alignment);
+        level_offsets[i] = data_offset;
+        data_offset += levels[i].size();
+    }
+
+
+    std::vector<uint8_t> out(data_offset, 0);
+    auto                 put = [&out](size_t offset, const void* src, size_t size) {
+        std::memcpy(out.data() + offset, src, size);
+    };
+
+    put(0, KTX2_IDENTIFIER.data(), KTX2_IDENTIFIER.size());
+    const uint32_t header[9] = {
+            static_cast<uint32_t>(format),
+            1,    // typeSize
+            extent.width,
+            extent.height,
+            0,    // pixelDepth
+            0,    // layerCount
+            1,    // faceCount
+            (uint32_t) level_num,
+            0,    // supercompressionScheme
+    };
+    put(12, header, sizeof(header));
+    const uint32_t index[4] = {(uint32_t) dfd_offset, dfd[0], 0, 0};    // dfd，kvd
+    put(12 + sizeof(header), index, sizeof(index));
+    // sgdByteOffset，sgdByteLength 都是 0
+
+    for (size_t i = 0; i < level_num; ++i)
+    {
+        const uint64_t entry[3] = {level_offsets[i], levels[i].size(), levels[i].size()};
+        put(12 + 4 * 9 + 4 * 4 + 8 * 2 + i * sizeof(entry), entry, sizeof(entry));
+        put(level_offsets[i], levels[i].data(), levels[i].size());
+    }
+    put(dfd_offset, dfd.data(), dfd[0]);
+
+
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+        throw std::runtime_error(fmt::format("[ktx] failed to write file: {}", path.string()));
+    file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+}
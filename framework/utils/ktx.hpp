@@ -0,0 +1,83 @@
+#pragma once
+#include <vector>
+#include <filesystem>
+
+#include "core/vk_include.hpp"
+#include "utils/tools.hpp"
+
+
+namespace Hiss
+{
+
+/**
+ * 读取 KTX（1.1）以及 KTX2 容器，其中的数据可以不经过解码，直接上传到 GPU
+ * @details 支持 RGBA8、BC1-BC7、ETC2、ASTC 等格式，以及预先生成好的 mipmap
+ * @details 只支持 2D 纹理：不支持 array，cubemap 以及 3D 纹理
+ * @details KTX2 的 supercompression（BasisLZ，zstd，zlib）以及 UASTC 需要 transcoder，目前会抛出异常
+ */
+class KtxFile
+{
+public:
+    struct Level
+    {
+        size_t   offset = 0;    // 在 data 中的位置，单位是 byte
+        size_t   size   = 0;
+        uint32_t width  = 0;
+        uint32_t height = 0;
+    };
+
+
+    /**
+     * 读取整个文件，解析失败时抛出 std::runtime_error
+     */
+    explicit KtxFile(const std::filesystem::path& path);
+
+
+    /**
+     * 文件的扩展名是否是 .ktx 或者 .ktx2
+     */
+    static bool is_ktx(const std::filesystem::path& path);
+
+
+    /**
+     * 将 format 转换为对应的 sRGB 格式，如果没有对应的 sRGB 格式，返回原来的 format
+     * @details KTX1 的 GL_RGBA8 等格式并不区分颜色空间，由使用者决定是否以 sRGB 的方式采样
+     */
+    static vk::Format to_srgb(vk::Format format);
+
+
+    // 是否是 sRGB 格式，只识别 to_srgb 能够得到的格式
+    static bool is_srgb(vk::Format format);
+
+
+    // 是否是 block compressed 的格式
+    static bool is_block_compressed(vk::Format format);
+
+
+    /**
+     * 写入 KTX2 文件，不进行 supercompression
+     * @details 目前只支持 RGBA8、BC1（RGB）以及 BC3 格式（包括 sRGB 的变体）
+     * @param levels 每个 level 的数据，第 0 个是最大的 level
+     */
+    static void write_ktx2(const std::filesystem::path& path, vk::Format format, vk::Extent2D extent,
+                           const std::vector<std::vector<uint8_t>>& levels);
+
+
+private:
+    void _parse_ktx1();
+    void _parse_ktx2();
+
+    // 将 KTX1 的 glInternalFormat 转换为 vulkan 的 format
+    static vk::Format _gl_to_vk(uint32_t gl_internal_format);
+
+
+public:
+    Prop<std::filesystem::path, KtxFile> path;
+    Prop<vk::Format, KtxFile>            format{vk::Format::eUndefined};
+    Prop<vk::Extent2D, KtxFile>          extent{};
+    Prop<std::vector<Level>, KtxFile>    levels{};
+
+    std::vector<uint8_t> data;    // 整个文件的内容
+};
+
+}    // namespace Hiss
@@ -0,0 +1,44 @@
+#include "utils/mapped_file.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fmt/format.h>
+
+
+Hiss::MappedFile::MappedFile(const std::filesystem::path& path)
+    : path(path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error(fmt::format("[mapped file] failed to open file: {}", path.string()));
+
+    struct stat file_stat = {};
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+    {
+        close(fd);
+        throw std::runtime_error(fmt::format("[mapped file] empty or invalid file: {}", path.string()));
+    }
+    _size = static_cast<size_t>(file_stat.st_size);
+
+
+    // map 之后就可以关闭文件，mapping 仍然有效
+    _data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (_data == MAP_FAILED)
+    {
+        _data = nullptr;
+        throw std::runtime_error(fmt::format("[mapped file] failed to map file: {}", path.string()));
+    }
+
+    // 数据会被顺序地读取一遍
+    madvise(_data, _size, MADV_SEQUENTIAL);
+}
+
+
+Hiss::MappedFile::~MappedFile()
+{
+    if (_data)
+        munmap(_data, _size);
+}
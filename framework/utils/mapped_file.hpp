@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include "utils/tools.hpp"
+
+
+namespace Hiss
+{
+
+/**
+ * 以只读的方式将整个文件 map 到内存中，析构时 unmap
+ * @details 数据在第一次访问时才会从磁盘读取（page fault），适合将文件中的数据直接拷贝到 stage buffer
+ * @details 基于 POSIX 的 mmap，支持 macOS 和 Linux
+ */
+class MappedFile
+{
+public:
+    /**
+     * 失败时抛出 std::runtime_error
+     */
+    explicit MappedFile(const std::filesystem::path& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+
+    const uint8_t* data() const { return static_cast<const uint8_t*>(_data); }
+    size_t         size() const { return _size; }
+
+
+public:
+    Prop<std::filesystem::path, MappedFile> path;
+
+
+private:
+    void*  _data = nullptr;
+    size_t _size = 0;
+};
+
+}    // namespace Hiss
@@ -0,0 +1,310 @@
+#include "utils/mesh_optimizer.hpp"
+
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+
+
+namespace
+{
+
+// Forsyth 算法的参数
+const uint32_t FORSYTH_CACHE_SIZE = 32;
+const float    CACHE_DECAY_POWER  = 1.5f;
+const float    LAST_TRI_SCORE     = 0.75f;
+const float    VALENCE_BOOST_SCALE = 2.f;
+const float    VALENCE_BOOST_POWER = 0.5f;
+
+
+/**
+ * 顶点的分数：在 cache 中越靠前，分数越高；剩余的三角形越少，分数越高（尽快将其完成）
+ * @param cache_pos 不在 cache 中为 -1
+ */
+float vertex_score(int cache_pos, uint32_t remaining)
+{
+    if (remaining == 0)
+        return -1.f;
+
+    float score = 0.f;
+    if (cache_pos >= 0)
+    {
+        // 最近使用的三角形的 3 个顶点的分数是固定的，避免重复使用相同的三角形
+        if (cache_pos < 3)
+            score = LAST_TRI_SCORE;
+        else
+            score = std::pow(1.f - (float) (cache_pos - 3) / (float) (FORSYTH_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+    }
+
+    score += VALENCE_BOOST_SCALE * std::pow((float) remaining, -VALENCE_BOOST_POWER);
+    return score;
+}
+
+}    // namespace
+
+
+Hiss::MeshOptimizer::CacheStats Hiss::MeshOptimizer::analyze_vertex_cache(const uint32_t* indices, size_t index_num,
+                                                                          size_t vertex_num, uint32_t cache_size)
+{
+    CacheStats stats;
+    if (index_num == 0)
+        return stats;
+
+    // FIFO cache：记录每个顶点进入 cache 时的时间戳
+    std::vector<size_t> timestamps(vertex_num, 0);
+    size_t              time = cache_size + 1;
+    size_t              miss = 0;
+    std::vector<bool>   used(vertex_num, false);
+    for (size_t i = 0; i < index_num; ++i)
+    {
+        uint32_t v = indices[i];
+        if (time - timestamps[v] > cache_size)
+        {
+            timestamps[v] = time++;
+            miss++;
+        }
+        used[v] = true;
+    }
+
+    auto used_num = (size_t) std::count(used.begin(), used.end(), true);
+    stats.acmr    = (float) miss / (float) (index_num / 3);
+    stats.atvr    = used_num ? (float) miss / (float) used_num : 0.f;
+    return stats;
+}
+
+
+void Hiss::MeshOptimizer::optimize_vertex_cache(uint32_t* indices, size_t index_num, size_t vertex_num)
+{
+    size_t tri_num = index_num / 3;
+    if (tri_num == 0)
+        return;
+
+
+    // 每个顶点相邻的三角形列表
+    std::vector<uint32_t> remaining(vertex_num, 0);
+    for (size_t i = 0; i < index_num; ++i)
+        remaining[indices[i]]++;
+
+    std::vector<uint32_t> adj_offset(vertex_num + 1, 0);
+    for (size_t v = 0; v < vertex_num; ++v)
+        adj_offset[v + 1] = adj_offset[v] + remaining[v];
+
+    std::vector<uint32_t> adj_tris(index_num);
+    std::vector<uint32_t> adj_fill(adj_offset.begin(), adj_offset.end() - 1);
+    for (size_t t = 0; t < tri_num; ++t)
+        for (size_t k = 0; k < 3; ++k)
+            adj_tris[adj_fill[indices[t * 3 + k]]++] = (uint32_t) t;
+
+
+    // 初始的分数
+    std::vector<int>   cache_pos(vertex_num, -1);
+    std::vector<float> v_score(vertex_num);
+    for (size_t v = 0; v < vertex_num; ++v)
+        v_score[v] = vertex_score(-1, remaining[v]);
+
+    std::vector<float> t_score(tri_num);
+    for (size_t t = 0; t < tri_num; ++t)
+        t_score[t] = v_score[indices[t * 3]] + v_score[indices[t * 3 + 1]] + v_score[indices[t * 3 + 2]];
+
+
+    std::vector<bool>     emitted(tri_num, false);
+    std::vector<uint32_t> result;
+    result.reserve(index_num);
+
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> new_cache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    new_cache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    size_t   scan_cursor = 0;    // cache 中没有候选三角形时，从这里开始线性查找
+    uint32_t best_tri    = (uint32_t) std::distance(t_score.begin(), std::max_element(t_score.begin(), t_score.end()));
+
+    while (result.size() < index_num)
+    {
+        // 输出分数最高的三角形，将其从相邻列表中移除
+        emitted[best_tri] = true;
+        for (size_t k = 0; k < 3; ++k)
+        {
+            uint32_t v = indices[best_tri * 3 + k];
+            result.push_back(v);
+
+            auto begin = adj_tris.begin() + adj_offset[v];
+            auto end   = begin + remaining[v];
+            std::iter_swap(std::find(begin, end, best_tri), end - 1);
+            remaining[v]--;
+        }
+
+
+        // 更新 LRU cache：新三角形的顶点放在最前面
+        new_cache.clear();
+        for (size_t k = 0; k < 3; ++k)
+            new_cache.push_back(indices[best_tri * 3 + k]);
+        for (auto v: cache)
+            if (std::find(new_cache.begin(), new_cache.begin() + 3, v) == new_cache.begin() + 3)
+                new_cache.push_back(v);
+        cache.swap(new_cache);
+
+
+        // 更新 cache 中（以及被挤出 cache 的）顶点的分数，以及相邻三角形的分数
+        for (size_t i = 0; i < cache.size(); ++i)
+        {
+            uint32_t v   = cache[i];
+            cache_pos[v] = i < FORSYTH_CACHE_SIZE ? (int) i : -1;
+
+            float new_score = vertex_score(cache_pos[v], remaining[v]);
+            float delta     = new_score - v_score[v];
+            v_score[v]      = new_score;
+
+            for (uint32_t j = adj_offset[v]; j < adj_offset[v] + remaining[v]; ++j)
+                t_score[adj_tris[j]] += delta;
+        }
+
+        // 一个三角形的分数可能被它的多个顶点更新，所有的分数更新完之后再选择分数最高的三角形
+        float best_score = -1.f;
+        best_tri         = UINT32_MAX;
+        for (auto v: cache)
+        {
+            for (uint32_t j = adj_offset[v]; j < adj_offset[v] + remaining[v]; ++j)
+            {
+                uint32_t t = adj_tris[j];
+                if (t_score[t] > best_score)
+                {
+                    best_score = t_score[t];
+                    best_tri   = t;
+                }
+            }
+        }
+        if (cache.size() > FORSYTH_CACHE_SIZE)
+            cache.resize(FORSYTH_CACHE_SIZE);
+
+
+        // cache 中没有候选的三角形，线性查找下一个没有输出的三角形
+        if (best_tri == UINT32_MAX)
+        {
+            while (scan_cursor < tri_num && emitted[scan_cursor])
+                scan_cursor++;
+            if (scan_cursor == tri_num)
+                break;
+            best_tri = (uint32_t) scan_cursor;
+        }
+    }
+
+    std::copy(result.begin(), result.end(), indices);
+}
+
+
+void Hiss::MeshOptimizer::optimize_overdraw(uint32_t* indices, size_t index_num, const float* positions,
+                                            size_t stride, size_t vertex_num, float threshold)
+{
+    size_t tri_num = index_num / 3;
+    if (tri_num == 0)
+        return;
+
+    auto pos = [positions, stride](uint32_t v) {
+        return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + stride * v);
+    };
+
+
+    // 在所有 3 个顶点都 cache miss 的位置切分，得到多个三角形簇，簇内的 cache 命中率不受重排影响
+    std::vector<size_t> cluster_begin;
+    {
+        const uint32_t      cache_size = 16;
+        std::vector<size_t> timestamps(vertex_num, 0);
+        size_t              time = cache_size + 1;
+        for (size_t t = 0; t < tri_num; ++t)
+        {
+            uint32_t miss = 0;
+            for (size_t k = 0; k < 3; ++k)
+            {
+                uint32_t v = indices[t * 3 + k];
+                if (time - timestamps[v] > cache_size)
+                {
+                    timestamps[v] = time++;
+                    miss++;
+                }
+            }
+            if (t == 0 || miss == 3)
+                cluster_begin.push_back(t);
+        }
+    }
+    cluster_begin.push_back(tri_num);
+    size_t cluster_num = cluster_begin.size() - 1;
+    if (cluster_num < 2)
+        return;
+
+
+    // 整个 mesh 的中心
+    float mesh_center[3] = {0.f, 0.f, 0.f};
+    for (size_t v = 0; v < vertex_num; ++v)
+        for (size_t c = 0; c < 3; ++c)
+            mesh_center[c] += pos((uint32_t) v)[c] / (float) vertex_num;
+
+
+    /**
+     * 簇的排序依据：dot(簇的中心 - mesh 的中心, 簇的平均法线)
+     * 值越大，说明簇越朝向外侧，越可能遮挡其他的簇，应该先绘制
+     */
+    std::vector<float> sort_key(cluster_num);
+    for (size_t i = 0; i < cluster_num; ++i)
+    {
+        float  center[3] = {0.f, 0.f, 0.f}, normal[3] = {0.f, 0.f, 0.f};
+        float  area_sum  = 0.f;
+        for (size_t t = cluster_begin[i]; t < cluster_begin[i + 1]; ++t)
+        {
+            const float* p0 = pos(indices[t * 3]);
+            const float* p1 = pos(indices[t * 3 + 1]);
+            const float* p2 = pos(indices[t * 3 + 2]);
+
+            float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+            float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+            float n[3]  = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+            float area  = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            // 法线的长度是面积的 2 倍，直接累加即为按面积加权
+            for (size_t c = 0; c < 3; ++c)
+            {
+                center[c] += (p0[c] + p1[c] + p2[c]) / 3.f * area;
+                normal[c] += n[c];
+            }
+            area_sum += area;
+        }
+
+        float key = 0.f;
+        if (area_sum > 0.f)
+            for (size_t c = 0; c < 3; ++c)
+                key += (center[c] / area_sum - mesh_center[c]) * normal[c];
+        sort_key[i] = key;
+    }
+
+    std::vector<size_t> order(cluster_num);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&sort_key](size_t a, size_t b) { return sort_key[a] > sort_key[b]; });
+
+
+    std::vector<uint32_t> result;
+    result.reserve(index_num);
+    for (auto i: order)
+        result.insert(result.end(), indices + cluster_begin[i] * 3, indices + cluster_begin[i + 1] * 3);
+
+
+    // cache 的命中率下降太多时放弃重排
+    float acmr_before = analyze_vertex_cache(indices, index_num, vertex_num).acmr;
+    float acmr_after  = analyze_vertex_cache(result.data(), index_num, vertex_num).acmr;
+    if (acmr_after <= acmr_before * threshold)
+        std::copy(result.begin(), result.end(), indices);
+}
+
+
+std::vector<uint32_t> Hiss::MeshOptimizer::optimize_vertex_fetch(uint32_t* indices, size_t index_num,
+                                                                 size_t vertex_num)
+{
+    std::vector<uint32_t> remap(vertex_num, UINT32_MAX);
+    uint32_t              next = 0;
+    for (size_t i = 0; i < index_num; ++i)
+    {
+        uint32_t& r = remap[indices[i]];
+        if (r == UINT32_MAX)
+            r = next++;
+        indices[i] = r;
+    }
+    return remap;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+/**
+ * 离线以及导入时使用的 mesh 优化
+ *  - vertex cache：重排三角形，提高 post-transform cache 的命中率（Forsyth 的算法）
+ *  - overdraw：在不明显降低 cache 命中率的前提下，按照三角形簇的朝向重排，减少 overdraw
+ *  - vertex fetch：按照索引中第一次出现的顺序重排顶点，使得顶点的读取接近线性
+ * @details 所有的函数都只处理三角形列表（每 3 个索引是一个三角形）
+ */
+namespace Hiss::MeshOptimizer
+{
+
+struct CacheStats
+{
+    float acmr = 0.f;    // average cache miss ratio：每个三角形平均的 cache miss 次数，范围是 [0.5, 3]
+    float atvr = 0.f;    // average transformed vertex ratio：每个顶点平均被变换的次数，理想值是 1
+};
+
+
+/**
+ * 模拟 FIFO 的 post-transform cache，统计 ACMR 以及 ATVR
+ * @param cache_size 大多数 GPU 的等效大小在 16 - 32 之间
+ */
+CacheStats analyze_vertex_cache(const uint32_t* indices, size_t index_num, size_t vertex_num,
+                                uint32_t cache_size = 16);
+
+
+/**
+ * 重排三角形的顺序，提高 vertex cache 的命中率
+ * @details Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"，模拟大小为 32 的 LRU cache
+ */
+void optimize_vertex_cache(uint32_t* indices, size_t index_num, size_t vertex_num);
+
+
+/**
+ * 在 vertex cache 优化之后调用，重排三角形簇以减少 overdraw
+ * @details 在 cache miss 的位置将三角形分为多个簇，按照簇的朝向排序：朝向模型外侧的簇先绘制
+ * @details 如果重排之后的 ACMR 超过原来的 threshold 倍，就放弃重排
+ * @param positions 第一个顶点的 position（3 个 float）
+ * @param stride 相邻两个顶点之间的距离，单位是 byte
+ */
+void optimize_overdraw(uint32_t* indices, size_t index_num, const float* positions, size_t stride,
+                       size_t vertex_num, float threshold = 1.05f);
+
+
+/**
+ * 按照顶点在索引中第一次出现的顺序重新编号，并修改索引
+ * @return remap[old] = new；没有被引用的顶点为 UINT32_MAX
+ */
+std::vector<uint32_t> optimize_vertex_fetch(uint32_t* indices, size_t index_num, size_t vertex_num);
+
+
+/**
+ * 根据 remap 重排顶点，没有被引用的顶点会被去除
+ */
+template<typename VertexType>
+void remap_vertices(std::vector<VertexType>& vertices, const std::vector<uint32_t>& remap)
+{
+    size_t new_num = 0;
+    for (auto r: remap)
+        if (r != UINT32_MAX)
+            new_num++;
+
+    std::vector<VertexType> result(new_num);
+    for (size_t i = 0; i < vertices.size(); ++i)
+        if (remap[i] != UINT32_MAX)
+            result[remap[i]] = vertices[i];
+    vertices.swap(result);
+}
+
+}    // namespace Hiss::MeshOptimizer
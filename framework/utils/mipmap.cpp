@@ -0,0 +1,149 @@
+#include "utils/mipmap.hpp"
+#include "engine/image.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+
+namespace
+{
+
+/**
+ * sRGB 和线性空间之间的转换表
+ * @details decode: 8-bit sRGB -> 线性值（float）
+ * @details encode: 12-bit 线性值 -> 8-bit sRGB，精度足够用于 8-bit 的输出
+ */
+struct SrgbTable
+{
+    static constexpr uint32_t ENCODE_SIZE = 4096;
+
+    std::array<float, 256>           decode{};
+    std::array<uint8_t, ENCODE_SIZE> encode{};
+
+    SrgbTable()
+    {
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            float c   = (float) i / 255.f;
+            decode[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for (uint32_t i = 0; i < ENCODE_SIZE; ++i)
+        {
+            float l   = (float) i / (float) (ENCODE_SIZE - 1);
+            float c   = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.f / 2.4f) - 0.055f;
+            encode[i] = (uint8_t) std::clamp(c * 255.f + 0.5f, 0.f, 255.f);
+        }
+    }
+};
+
+
+const SrgbTable& srgb_table()
+{
+    static const SrgbTable table;
+    return table;
+}
+
+
+/**
+ * 2x2 box filter，将 src 缩小为 dst
+ * @details 对于奇数的尺寸，最后一列（行）会和自己取平均
+ */
+void downsample_linear(const uint8_t* src, uint32_t src_w, uint32_t src_h, uint8_t* dst, uint32_t dst_w,
+                       uint32_t dst_h)
+{
+    for (uint32_t y = 0; y < dst_h; ++y)
+    {
+        const uint8_t* row0 = src + (size_t) std::min(2 * y, src_h - 1) * src_w * 4;
+        const uint8_t* row1 = src + (size_t) std::min(2 * y + 1, src_h - 1) * src_w * 4;
+        uint8_t*       out  = dst + (size_t) y * dst_w * 4;
+
+        for (uint32_t x = 0; x < dst_w; ++x)
+        {
+            uint32_t x0 = std::min(2 * x, src_w - 1) * 4;
+            uint32_t x1 = std::min(2 * x + 1, src_w - 1) * 4;
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                uint32_t sum   = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+                out[x * 4 + c] = (uint8_t) ((sum + 2) >> 2);
+            }
+        }
+    }
+}
+
+
+void downsample_srgb(const uint8_t* src, uint32_t src_w, uint32_t src_h, uint8_t* dst, uint32_t dst_w,
+                     uint32_t dst_h)
+{
+    const auto& table = srgb_table();
+
+    for (uint32_t y = 0; y < dst_h; ++y)
+    {
+        const uint8_t* row0 = src + (size_t) std::min(2 * y, src_h - 1) * src_w * 4;
+        const uint8_t* row1 = src + (size_t) std::min(2 * y + 1, src_h - 1) * src_w * 4;
+        uint8_t*       out  = dst + (size_t) y * dst_w * 4;
+
+        for (uint32_t x = 0; x < dst_w; ++x)
+        {
+            uint32_t x0 = std::min(2 * x, src_w - 1) * 4;
+            uint32_t x1 = std::min(2 * x + 1, src_w - 1) * 4;
+
+            // rgb 在线性空间中取平均
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                float sum = table.decode[row0[x0 + c]] + table.decode[row0[x1 + c]] + table.decode[row1[x0 + c]]
+                          + table.decode[row1[x1 + c]];
+                auto idx       = (uint32_t) (sum * 0.25f * (float) (SrgbTable::ENCODE_SIZE - 1) + 0.5f);
+                out[x * 4 + c] = table.encode[std::min(idx, SrgbTable::ENCODE_SIZE - 1)];
+            }
+
+            // alpha 始终是线性的
+            uint32_t sum   = row0[x0 + 3] + row0[x1 + 3] + row1[x0 + 3] + row1[x1 + 3];
+            out[x * 4 + 3] = (uint8_t) ((sum + 2) >> 2);
+        }
+    }
+}
+
+}    // namespace
+
+
+Hiss::Mipmap::Chain Hiss::Mipmap::generate_rgba8(const uint8_t* src, uint32_t width, uint32_t height, bool srgb,
+                                                 uint32_t level_num)
+{
+    uint32_t max_level = Image2D::max_mip_levels(vk::Extent2D{width, height});
+    level_num          = level_num == 0 ? max_level : std::min(level_num, max_level);
+
+
+    // 计算每一级的尺寸以及在 chain 中的位置
+    Chain  chain;
+    size_t total_size = 0;
+    chain.levels.resize(level_num);
+    for (uint32_t i = 0; i < level_num; ++i)
+    {
+        chain.levels[i] = Level{
+                .offset = total_size,
+                .width  = std::max(1u, width >> i),
+                .height = std::max(1u, height >> i),
+        };
+        total_size += (size_t) chain.levels[i].width * chain.levels[i].height * 4;
+    }
+    chain.data.resize(total_size);
+
+
+    // level 0 是原图，之后的每一级都由上一级生成
+    std::memcpy(chain.data.data(), src, (size_t) width * height * 4);
+    for (uint32_t i = 1; i < level_num; ++i)
+    {
+        const auto& pre = chain.levels[i - 1];
+        const auto& cur = chain.levels[i];
+        if (srgb)
+            downsample_srgb(chain.data.data() + pre.offset, pre.width, pre.height, chain.data.data() + cur.offset,
+                            cur.width, cur.height);
+        else
+            downsample_linear(chain.data.data() + pre.offset, pre.width, pre.height, chain.data.data() + cur.offset,
+                              cur.width, cur.height);
+    }
+
+    return chain;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace Hiss::Mipmap
+{
+
+/**
+ * mipmap 链中某一级的数据在整个 chain 中的位置
+ */
+struct Level
+{
+    size_t   offset = 0;    // 单位是 byte
+    uint32_t width  = 0;
+    uint32_t height = 0;
+};
+
+
+/**
+ * 完整的 mipmap 链，所有 level 的数据紧密地排列在一起，可以直接写入 stage buffer
+ */
+struct Chain
+{
+    std::vector<uint8_t> data;
+    std::vector<Level>   levels;
+};
+
+
+/**
+ * 在 CPU 上使用 2x2 box filter 生成 RGBA8 图片的 mipmap 链，用于 GPU 不支持 linear blit 的 format
+ * @details 奇数尺寸时，边缘的像素会被重复使用
+ * @details 内层循环没有分支，编译器可以自动向量化
+ * @param srgb 为 true 时，在线性空间进行滤波（alpha 通道始终是线性的）
+ * @param level_num 为 0 表示生成完整的链，级数参考 Image2D::max_mip_levels
+ */
+Chain generate_rgba8(const uint8_t* src, uint32_t width, uint32_t height, bool srgb, uint32_t level_num = 0);
+
+}    // namespace Hiss::Mipmap
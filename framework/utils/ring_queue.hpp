@@ -0,0 +1,72 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+
+namespace Hiss
+{
+
+
+/**
+ * 容量固定的 FIFO 队列，存储在创建（或者 reset）时一次性分配，之后的 push 和 pop 都不会分配内存
+ * @details 用于每一帧都会进出的小队列，例如已经提交的 frame，避免 std::deque 循环使用时反复分配和释放节点
+ * @details 不是线程安全的；满的时候 push 会断言
+ * @example
+ * \n - RingQueue<Frame*> queue{frame_num};
+ * \n - queue.push_back(frame); ... queue.front(); queue.pop_front();
+ */
+template<typename T>
+class RingQueue
+{
+public:
+    explicit RingQueue(size_t capacity = 0) { reset(capacity); }
+
+
+    // 清空队列，并修改容量；只有这里会分配内存
+    void reset(size_t capacity)
+    {
+        _slots.assign(capacity, T{});
+        _head = 0;
+        _size = 0;
+    }
+
+    void clear()
+    {
+        _head = 0;
+        _size = 0;
+    }
+
+
+    void push_back(const T& value)
+    {
+        assert(!full() && "ring queue is full");
+        _slots[(_head + _size) % _slots.size()] = value;
+        _size++;
+    }
+
+    void pop_front()
+    {
+        assert(!empty());
+        _slots[_head] = T{};
+        _head         = (_head + 1) % _slots.size();
+        _size--;
+    }
+
+    T&       front() { return _slots[_head]; }
+    const T& front() const { return _slots[_head]; }
+
+
+    size_t size() const { return _size; }
+    size_t capacity() const { return _slots.size(); }
+    bool   empty() const { return _size == 0; }
+    bool   full() const { return _size == _slots.size(); }
+
+
+private:
+    std::vector<T> _slots;
+    size_t         _head = 0;    // 队首元素的位置
+    size_t         _size = 0;
+};
+
+}    // namespace Hiss
@@ -0,0 +1,190 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <spdlog/spdlog.h>
+#include "utils/triple_buffer.hpp"
+
+
+namespace Hiss
+{
+
+
+struct SimulationConfig
+{
+    double   rate_hz   = 60.0;    // 固定的模拟频率
+    bool     threaded  = true;    // 在独立的线程上模拟；否则在主循环中，每一帧补上落后的步数
+    uint32_t max_steps = 8;       // 落后太多时（例如断点、窗口拖动），最多补上的步数，之后直接跳过
+};
+
+
+/**
+ * run() 通过这个接口驱动应用的模拟，参考 IApplication::simulation
+ */
+class ISimulation
+{
+public:
+    virtual ~ISimulation() = default;
+
+    virtual void start() = 0;
+    virtual void stop()  = 0;
+
+    // 不使用模拟线程时，在主循环中每一帧调用一次；使用模拟线程时什么都不做
+    virtual void advance() = 0;
+};
+
+
+/**
+ * 固定步长的模拟：step 函数每次推进 1 / rate_hz 秒，与渲染的帧率、present mode 无关，因此结果是确定的
+ * @details 每一步之后发布不可变的快照（上一步以及这一步的状态），通过 TripleBuffer 传递给渲染线程，双方都不会等待
+ * @details 渲染时根据快照发布之后经过的时间得到 alpha，在两个状态之间插值；画面会比模拟晚最多一步
+ * @details State 需要可以复制，step 函数只会在模拟线程上调用（threaded 为 false 时是主线程）
+ * @example
+ * \n - Simulation<State> sim{config, State{}, [](State& state, double dt) { ... }};
+ * \n - auto sample = sim.sample(); draw(lerp(sample.prev, sample.curr, sample.alpha));
+ */
+template<typename State>
+class Simulation : public ISimulation
+{
+public:
+    using clock    = std::chrono::steady_clock;
+    using StepFunc = std::function<void(State& state, double step_seconds)>;
+
+
+    struct Snapshot
+    {
+        State             prev;
+        State             curr;
+        uint64_t          tick = 0;    // curr 是第几步的结果
+        clock::time_point time;        // 发布的时间
+    };
+
+
+    struct Sample
+    {
+        const State& prev;
+        const State& curr;
+        float        alpha;    // 0 表示 prev，1 表示 curr
+        uint64_t     tick;
+    };
+
+
+    Simulation(const SimulationConfig& config, const State& initial, StepFunc step)
+        : _config(config),
+          _step(std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / config.rate_hz))),
+          _step_func(std::move(step)),
+          _state(initial),
+          _snapshots(Snapshot{.prev = initial, .curr = initial, .tick = 0, .time = clock::now()})
+    {}
+
+    ~Simulation() override { stop(); }
+
+
+    void start() override
+    {
+        _next_time = clock::now() + _step;
+        if (!_config.threaded)
+            return;
+
+        _running = true;
+        _thread  = std::thread([this] { _loop(); });
+        spdlog::info("[simulation] thread started, {:.1f} Hz", _config.rate_hz);
+    }
+
+
+    void stop() override
+    {
+        if (!_thread.joinable())
+            return;
+
+        _running = false;
+        _thread.join();
+        spdlog::info("[simulation] thread stopped, {} ticks, {} skipped", _tick, _skipped_num);
+    }
+
+
+    void advance() override
+    {
+        if (!_config.threaded)
+            _catch_up(clock::now());
+    }
+
+
+    /**
+     * 渲染线程调用：获取最新的快照，以及插值的系数
+     * @details 返回的引用在下一次调用 sample 之前有效
+     */
+    Sample sample()
+    {
+        _snapshots.update();
+        auto& snapshot = _snapshots.read_buffer();
+
+        auto  since = std::chrono::duration<double>(clock::now() - snapshot.time).count();
+        float alpha = (float) std::clamp(since * _config.rate_hz, 0.0, 1.0);
+        return Sample{.prev = snapshot.prev, .curr = snapshot.curr, .alpha = alpha, .tick = snapshot.tick};
+    }
+
+
+    double step_seconds() const { return 1.0 / _config.rate_hz; }
+
+
+private:
+    void _loop()
+    {
+        while (_running)
+        {
+            std::this_thread::sleep_until(_next_time);
+            _catch_up(clock::now());
+        }
+    }
+
+
+    // 执行所有已经到期的步
+    void _catch_up(clock::time_point now)
+    {
+        uint32_t steps = 0;
+        while (_next_time <= now && steps < _config.max_steps)
+        {
+            _step_once(now);
+            _next_time += _step;
+            steps++;
+        }
+
+        if (_next_time <= now)
+        {
+            _skipped_num += (now - _next_time) / _step + 1;
+            _next_time = now + _step;
+        }
+    }
+
+
+    void _step_once(clock::time_point now)
+    {
+        auto& snapshot = _snapshots.write_buffer();
+        snapshot.prev  = _state;
+        _step_func(_state, step_seconds());
+        snapshot.curr = _state;
+        snapshot.tick = ++_tick;
+        snapshot.time = now;
+        _snapshots.publish();
+    }
+
+
+    SimulationConfig _config;
+    clock::duration  _step;
+    StepFunc         _step_func;
+
+    // 只在模拟线程上访问
+    State             _state;
+    uint64_t          _tick        = 0;
+    uint64_t          _skipped_num = 0;
+    clock::time_point _next_time;
+
+    TripleBuffer<Snapshot> _snapshots;
+    std::thread            _thread;
+    std::atomic<bool>      _running{false};
+};
+
+}    // namespace Hiss
@@ -1,4 +1,5 @@
 #pragma once
+#include <mutex>
 
 
 namespace Hiss
@@ -14,26 +15,53 @@ public:
      * 注：channels_in_file 表示 image 真实的通道数
      * @param flip_vertical 是否进行 vertical flip。默认情况第一个像素为 top-left，
      *  如果进行 vertical flip，那么第一个像素是 bottom-left
+     * @details 可以在多个线程中同时解码，但是这些线程需要使用相同的 flip_vertical（stbi 的这个设置是全局的）
      */
     explicit Stbi_8Bit_RAII(const std::string& file_path, int desired_channels = 0, bool flip_vertical = false)
     {
-        stbi_set_flip_vertically_on_load(flip_vertical);
+        _set_flip_vertical(flip_vertical);
         data = stbi_load(file_path.c_str(), &width._value, &height._value, &channels_in_file._value, desired_channels);
         if (data == nullptr)
             throw std::runtime_error("error: _load image, file path: " + file_path);
+
+        channels = desired_channels == 0 ? channels_in_file._value : desired_channels;
     }
 
 
     ~Stbi_8Bit_RAII() { stbi_image_free(data); }
 
+    Stbi_8Bit_RAII(const Stbi_8Bit_RAII&)            = delete;
+    Stbi_8Bit_RAII& operator=(const Stbi_8Bit_RAII&) = delete;
+
+
+    // 解码之后的数据大小，单位是 byte
+    size_t size() const { return (size_t) width._value * height._value * channels._value; }
+
+
+private:
+    // 只在设置发生变化时写入 stbi 的全局状态，避免多个线程同时解码时反复写入
+    static void _set_flip_vertical(bool flip_vertical)
+    {
+        static std::mutex mutex;
+        static bool       current = false;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (current != flip_vertical)
+        {
+            stbi_set_flip_vertically_on_load(flip_vertical);
+            current = flip_vertical;
+        }
+    }
+
 
 public:
     Prop<int, Stbi_8Bit_RAII> width{0};
     Prop<int, Stbi_8Bit_RAII> height{0};
     Prop<int, Stbi_8Bit_RAII> channels_in_file{0};
+    Prop<int, Stbi_8Bit_RAII> channels{0};    // data 中每个 pixel 实际的通道数
 
     stbi_uc* data = nullptr;
 };
 
 
-}    // namespace Hiss
\ No newline at end of file
+}    // namespace Hiss
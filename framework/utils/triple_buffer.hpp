@@ -0,0 +1,79 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+
+namespace Hiss
+{
+
+
+/**
+ * 单个写者、单个读者之间传递最新的数据，无锁，双方都不会等待
+ * @details 三个缓冲：写者独占 back，读者独占 front，middle 用于交换。
+ *  publish 时将 back 和 middle 交换，并标记 middle 为新的数据；update 时如果 middle 是新的，和 front 交换
+ * @details 读者只会看到最新发布的数据，中间的数据会被跳过
+ * @example
+ * \n - 写者：buffer.write_buffer() = state; buffer.publish();
+ * \n - 读者：buffer.update(); use(buffer.read_buffer());
+ */
+template<typename T>
+class TripleBuffer
+{
+public:
+    explicit TripleBuffer(const T& init = {})
+        : _slots{Slot{init}, Slot{init}, Slot{init}}
+    {}
+
+
+    // 写者 ===============================================================
+
+    T& write_buffer() { return _slots[_back].value; }
+
+    /**
+     * 发布 write_buffer 中的数据，之后 write_buffer 指向另一个缓冲，其内容是旧的数据
+     */
+    void publish()
+    {
+        uint8_t old = _middle.exchange(_back | DIRTY_BIT, std::memory_order_acq_rel);
+        _back       = old & INDEX_MASK;
+    }
+
+
+    // 读者 ===============================================================
+
+    /**
+     * 获取最新发布的数据
+     * @return 是否有新的数据
+     */
+    bool update()
+    {
+        if (!(_middle.load(std::memory_order_relaxed) & DIRTY_BIT))
+            return false;
+
+        uint8_t old = _middle.exchange(_front, std::memory_order_acq_rel);
+        _front      = old & INDEX_MASK;
+        return true;
+    }
+
+    const T& read_buffer() const { return _slots[_front].value; }
+
+
+private:
+    static constexpr uint8_t INDEX_MASK = 0x3;
+    static constexpr uint8_t DIRTY_BIT  = 0x4;
+
+    // 每个缓冲独占 cache line，避免读者和写者之间的 false sharing
+    struct alignas(64) Slot
+    {
+        T value;
+    };
+
+    std::array<Slot, 3> _slots;
+
+    alignas(64) uint8_t _back = 0;
+    alignas(64) std::atomic<uint8_t> _middle{1};
+    alignas(64) uint8_t _front = 2;
+};
+
+}    // namespace Hiss
@@ -1,6 +1,7 @@
 #pragma once
 #include "core/vk_include.hpp"
 #include "engine/texture.hpp"
+#include "utils/arena.hpp"
 
 
 namespace Hiss::Initial
@@ -155,11 +156,14 @@ struct DescriptorWrite
 inline void descriptor_set_write(vk::Device device, vk::DescriptorSet descriptor_set,
                                  const std::vector<DescriptorWrite>& writes)
 {
-    std::vector<vk::WriteDescriptorSet> vk_writes;
+    // 每个 write 对应一个 buffer info 或者 image info，预先分配好，保证指针不会失效
+    SmallVector<vk::WriteDescriptorSet, 8>   vk_writes;
+    SmallVector<vk::DescriptorBufferInfo, 8> buffer_infos;
+    SmallVector<vk::DescriptorImageInfo, 8>  image_infos;
     vk_writes.resize(writes.size());
+    buffer_infos.resize(writes.size());
+    image_infos.resize(writes.size());
 
-    std::vector<vk::DescriptorBufferInfo*> buffer_infos;
-    std::vector<vk::DescriptorImageInfo*>  image_infos;
     for (uint32_t i = 0; i < writes.size(); ++i)
     {
         auto type = writes[i].type;
@@ -176,36 +180,33 @@ inline void descriptor_set_write(vk::Device device, vk::DescriptorSet descriptor
         // descriptor 是 uniform 或者 storage buffer
         if (type == vk::DescriptorType::eUniformBuffer || type == vk::DescriptorType::eStorageBuffer)
         {
-            auto p_buffer_info = new vk::DescriptorBufferInfo{
+            buffer_infos[i] = vk::DescriptorBufferInfo{
                     .buffer = writes[i].buffer->vkbuffer(),
                     .offset = 0,
                     .range  = writes[i].buffer->size(),
             };
-            buffer_infos.push_back(p_buffer_info);
-            write_set.pBufferInfo = p_buffer_info;
+            write_set.pBufferInfo = &buffer_infos[i];
         }
 
         // descriptor 是 texture：有 image 和 sampler
         else if (type == vk::DescriptorType::eCombinedImageSampler)
         {
-            auto p_image_info = new vk::DescriptorImageInfo{
+            image_infos[i] = vk::DescriptorImageInfo{
                     .sampler     = writes[i].sampler,
                     .imageView   = writes[i].image->vkview(),
                     .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
             };
-            image_infos.push_back(p_image_info);
-            write_set.pImageInfo = p_image_info;
+            write_set.pImageInfo = &image_infos[i];
         }
 
         // 是 storage image
         else if (type == vk::DescriptorType::eStorageImage)
         {
-            auto p_image_info = new vk::DescriptorImageInfo{
+            image_infos[i] = vk::DescriptorImageInfo{
                     .imageView   = writes[i].image->vkview(),
                     .imageLayout = vk::ImageLayout::eGeneral,
             };
-            image_infos.push_back(p_image_info);
-            write_set.pImageInfo = p_image_info;
+            write_set.pImageInfo = &image_infos[i];
         }
 
         // 没有匹配上
@@ -216,14 +217,7 @@ inline void descriptor_set_write(vk::Device device, vk::DescriptorSet descriptor
     }
 
     // 进行绑定
-    device.updateDescriptorSets(vk_writes, {});
-
-
-    // 销毁资源
-    for (auto image_info: image_infos)
-        delete image_info;
-    for (auto buffer_info: buffer_infos)
-        delete buffer_info;
+    device.updateDescriptorSets({(uint32_t) vk_writes.size(), vk_writes.data()}, {});
 }
 
 
@@ -255,7 +249,7 @@ inline vk::Pipeline compute_pipeline(vk::Device device, vk::PipelineLayout layou
 
 
 /**
- * 创建一个比较通用的：linear，mirrored repeat，无 mipmap
+ * 创建一个比较通用的：linear，clamp to edge，可以访问 image 所有的 mip level
  */
 inline vk::Sampler sampler(const Hiss::Device& device)
 {
@@ -280,7 +274,7 @@ inline vk::Sampler sampler(const Hiss::Device& device)
 
             // 用于 clamp LOD 级别的
             .minLod = 0.f,
-            .maxLod = static_cast<float>(1),
+            .maxLod = VK_LOD_CLAMP_NONE,
 
             .borderColor             = vk::BorderColor::eIntOpaqueBlack,
             .unnormalizedCoordinates = VK_FALSE,
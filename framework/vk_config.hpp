@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include "core/vk_common.hpp"
+#include "utils/job_system.hpp"
 
 
 namespace Hiss
@@ -89,6 +90,25 @@ inline std::vector<const char*> get_device_extensions()
 }
 
 
+/**
+ * 可选的 device extension，GPU 支持时才启用，通过 Device::is_extension_enabled 查询
+ */
+inline std::vector<const char*> get_optional_device_extensions()
+{
+    return {
+            // 驱动提供每个 heap 的 budget 以及实际的使用量，VMA 会使用
+            VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,
+
+            // 等待某一次 present 真正显示出来，用于限制 FIFO 模式下排队的帧数
+            VK_KHR_PRESENT_ID_EXTENSION_NAME,
+            VK_KHR_PRESENT_WAIT_EXTENSION_NAME,
+
+            // vkCmdPipelineBarrier2，每个 barrier 有自己的 stage mask，参考 BarrierBatch
+            VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME,
+    };
+}
+
+
 // 应用所需的 device features
 inline vk::PhysicalDeviceFeatures get_device_features()
 {
@@ -141,6 +161,73 @@ const std::vector<vk::DescriptorPoolSize> pool_size                 = {
         {vk::DescriptorType::eStorageBuffer, 1024},
         {vk::DescriptorType::eCombinedImageSampler, 1024},
         {vk::DescriptorType::eStorageImage, 1024},
+        {vk::DescriptorType::eUniformBufferDynamic, 16},
+        {vk::DescriptorType::eStorageBufferDynamic, 16},
+};
+
+
+
+// ==============================================================
+// presentation 相关的配置
+// ==============================================================
+
+/**
+ * 输入到显示的延迟与流畅度之间的取舍
+ */
+enum class LatencyMode
+{
+    Immediate,         // 不等待垂直同步，延迟最低，可能撕裂；不支持时退回到 Mailbox
+    Mailbox,           // 不撕裂，新的帧会替换队列中等待的帧；不支持时退回到 Fifo
+    Fifo,              // 垂直同步，一定支持，队列较长时延迟较高
+    FifoLowLatency,    // 垂直同步，并且限制等待显示的帧数，参考 PresentConfig::queue_depth
+};
+
+
+inline const char* to_string(LatencyMode mode)
+{
+    switch (mode)
+    {
+        case LatencyMode::Immediate: return "immediate";
+        case LatencyMode::Mailbox: return "mailbox";
+        case LatencyMode::Fifo: return "fifo";
+        default: return "fifo low latency";
+    }
+}
+
+
+struct PresentConfig
+{
+    LatencyMode mode = LatencyMode::Mailbox;
+
+    /**
+     * FifoLowLatency：最多有多少帧已经提交但是还没有显示出来
+     * 支持 VK_KHR_present_wait 时等待 present 真正显示，否则退化为等待更早的帧在 GPU 上完成
+     */
+    uint32_t queue_depth = 1;
+
+    bool present_thread = false;    // 在单独的线程中调用 vkQueuePresentKHR，不阻塞下一帧的录制
+};
+
+const PresentConfig default_present_config = {};
+const double        frame_rate_limit       = 0.0;    // CPU 端的帧率上限，0 表示不限制
+const uint64_t      alloc_warmup_frames    = 300;    // 启用 HISS_COUNT_ALLOCATIONS 时，这之后的每一帧都不应该有堆分配
+
+
+
+// ==============================================================
+// texture cache 相关的配置
+// ==============================================================
+const vk::DeviceSize texture_cache_budget = 512ull * 1024 * 1024;    // 显存预算，单位是 byte
+
+
+
+// ==============================================================
+// job system 相关的配置
+// ==============================================================
+const JobSystem::Config default_job_config = {
+        .worker_num    = 0,    // CPU 核心数 - 1
+        .pin_threads   = false,
+        .scratch_bytes = 256 * 1024,
 };
 
 }    // namespace Hiss
\ No newline at end of file
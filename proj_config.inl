@@ -26,3 +26,4 @@ const std::filesystem::path assets  = "${PROJ_ASSETS_DIR}";
 const std::filesystem::path shader  = "${PROJ_SHADER_DIR}";
 const std::filesystem::path texture = assets / "textures";
 const std::filesystem::path model   = assets / "model";
+const std::filesystem::path cooked  = assets / ".cooked";    // hiss_cook 生成的文件，结构和 assets 一致
@@ -7,7 +7,7 @@
 layout(location = 0) in VertFrag vs;
 layout(location = 0) out vec4 out_color;
 
-layout(set = 0, binding = 1, std140) uniform _2
+layout(set = 2, binding = 1, std140) uniform _2
 {
     Scene u_scene;
 };
@@ -2,44 +2,53 @@
 #version 450
 #extension GL_GOOGLE_include_directive : enable
 #include "../shader/common.glsl"
+#include "../shader/vertex_decode.glsl"
 
 
-layout(location = 0) in vec3 in_pos;
-layout(location = 1) in vec3 in_normal;
-layout(location = 2) in vec3 in_tangent;
-layout(location = 3) in vec3 in_btangent;
-layout(location = 4) in vec2 in_uv;
+// 顶点格式为 Vertex3DQuantized
+layout(location = 0) in vec4 in_pos;    // xyz: 相对于 AABB 量化的位置，w: bitangent 的方向
+layout(location = 1) in vec2 in_normal;
+layout(location = 2) in vec2 in_tangent;
+layout(location = 3) in vec2 in_uv;
 
 layout(location = 0) out VertFrag o;
 
+// engine 的 uniform ring，通过 dynamic offset 绑定
 layout(set = 0, binding = 0, std140) uniform _0
 {
     Frame u_frame;
 };
-layout(set = 0, binding = 1, std140) uniform _2
+layout(set = 2, binding = 1, std140) uniform _2
 {
     Scene u_scene;
 };
 layout(push_constant) uniform _push_constant_
 {
     mat4 u_model;
+    vec4 u_aabb_min;       // 用于还原量化的位置
+    vec4 u_aabb_extent;
 };
 
 
 void main()
 {
-    vec4 pos_world = u_model * vec4(in_pos, 1.0);
+    vec3 pos       = dequantize_position(in_pos.xyz, u_aabb_min.xyz, u_aabb_extent.xyz);
+    vec3 normal    = oct_decode(in_normal);
+    vec3 tangent   = oct_decode(in_tangent);
+    vec3 btangent  = decode_bitangent(normal, tangent, in_pos.w * 2.0 - 1.0);
+
+    vec4 pos_world = u_model * vec4(pos, 1.0);
     vec4 pos_view  = u_frame.view_matrix * pos_world;
 
     o.pos_world = pos_world.xyz;
     o.pos_view  = pos_view.xyz;
 
     // 需要正规化，才能正确插值。插值完成之后，还需要在此正规化
-    o.normal_world = normalize(inverse(transpose(mat3(u_model))) * in_normal);
+    o.normal_world = normalize(inverse(transpose(mat3(u_model))) * normal);
     o.normal_view  = normalize(inverse(transpose(mat3(u_frame.view_matrix))) * o.normal_world);
 
-    o.tangent  = normalize(in_tangent);
-    o.btangent = normalize(in_btangent);
+    o.tangent  = tangent;
+    o.btangent = btangent;
 
     o.uv = in_uv;
 
@@ -0,0 +1,43 @@
+#ifndef SHADER_VERTEX_DECODE
+#define SHADER_VERTEX_DECODE
+
+/**
+ * 压缩顶点格式的解码，与 engine/vertex_pack.cpp 中的编码对应
+ * 参考 Vertex3DPacked 以及 Vertex3DQuantized
+ */
+
+
+/**
+ * 解码 octahedral 编码的单位向量
+ * @param e snorm16 的顶点属性，已经由硬件转换到 [-1, 1]
+ */
+vec3 oct_decode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+
+/**
+ * 由 normal 和 tangent 得到 bitangent
+ * @param sign bitangent 的方向，-1 或者 1
+ */
+vec3 decode_bitangent(vec3 normal, vec3 tangent, float sign)
+{
+    return cross(normal, tangent) * sign;
+}
+
+
+/**
+ * 将相对于 AABB 量化的位置还原
+ * @param q unorm16 的顶点属性，已经由硬件转换到 [0, 1]
+ */
+vec3 dequantize_position(vec3 q, vec3 aabb_min, vec3 aabb_extent)
+{
+    return aabb_min + q * aabb_extent;
+}
+
+
+#endif    // SHADER_VERTEX_DECODE
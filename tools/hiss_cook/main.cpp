@@ -0,0 +1,406 @@
+/**
+ * hiss_cook：离线处理 assets 中的纹理和模型，生成可以直接上传到 GPU 的产物，放在 assets/.cooked 中
+ *  - 模型：通过 Assimp 导入（tangent space，合并相同的顶点，重排索引），写入 ModelDesc 的二进制文件
+ *  - 纹理：生成完整的 mipmap，写入 KTX2
+ *
+ * 纹理分为两类，KTX 中的格式记录了类别，运行时以另一种方式读取时会退回到源文件：
+ *  - 颜色纹理：被模型的材质引用的纹理，在 sRGB 空间生成 mipmap，编码为 BC1（不透明）或者 BC3（带 alpha）
+ *  - 数据纹理：其他的纹理（法线、粗糙度、高度图等），在线性空间生成 mipmap，保持 RGBA8
+ * 纹理旁边的 "<文件名>.cook" 可以覆盖推断的结果，内容是空格分隔的关键字：color / data，compress / rgba8
+ *
+ * 源文件的 hash 以及纹理的设置记录在 assets/.cooked/manifest.txt 中，只有发生变化的文件才会重新 cook
+ *
+ * 用法：hiss_cook [--force] [--rgba8] [--linear] [--jobs N]
+ *  --force   忽略 manifest，重新 cook 所有文件
+ *  --rgba8   所有纹理都不进行 block compress
+ *  --linear  所有纹理都在线性空间生成 mipmap
+ *  --jobs N  并行的线程数量（包括主线程），默认使用所有的 CPU 核心
+ */
+#include <map>
+#include <set>
+#include <cctype>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <optional>
+#include <algorithm>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include "proj_config.hpp"
+#include "utils/cook.hpp"
+#include "utils/ktx.hpp"
+#include "utils/stbi.hpp"
+#include "utils/mipmap.hpp"
+#include "utils/block_compress.hpp"
+#include "utils/job_system.hpp"
+#include "engine/model_desc.hpp"
+
+
+namespace
+{
+
+struct Options
+{
+    bool     force  = false;
+    bool     rgba8  = false;
+    bool     linear = false;
+    uint32_t jobs   = 0;
+};
+
+
+enum class AssetType
+{
+    Texture,
+    Model,
+};
+
+
+// 单个纹理的处理方式
+struct TextureSettings
+{
+    bool color    = false;    // 颜色纹理：在 sRGB 空间生成 mipmap，KTX 中使用 sRGB 格式
+    bool compress = false;    // 使用 BC1/BC3 压缩
+
+    // 混入 manifest 的 hash，设置变化时重新 cook
+    uint64_t salt() const { return ((color ? 1ull : 0ull) | (compress ? 2ull : 0ull)) + 1; }
+};
+
+
+struct Job
+{
+    std::filesystem::path source;
+    std::string           relative;    // 相对于 assets 的路径，作为 manifest 的 key
+    AssetType             type;
+    uint64_t              hash  = 0;
+    bool                  dirty = true;    // 需要重新 cook
+    bool                  ok    = false;
+
+    TextureSettings          texture;     // 只用于纹理
+    std::vector<std::string> textures;    // 只用于模型：材质引用的纹理，规范化之后的路径
+};
+
+
+std::string canonical_key(const std::filesystem::path& path)
+{
+    std::error_code ec;
+    auto            canonical_path = std::filesystem::weakly_canonical(path, ec);
+    return (ec ? path.lexically_normal() : canonical_path).generic_string();
+}
+
+
+/**
+ * 读取纹理旁边的 "<文件名>.cook"，覆盖推断出来的设置；关键字无法识别时抛出异常
+ */
+TextureSettings apply_sidecar(const std::filesystem::path& source, TextureSettings settings)
+{
+    auto          sidecar = std::filesystem::path(source.string() + ".cook");
+    std::ifstream file(sidecar);
+    std::string   word;
+    while (file >> word)
+    {
+        if (word == "color")
+            settings = TextureSettings{.color = true, .compress = true};
+        else if (word == "data")
+            settings = TextureSettings{.color = false, .compress = false};
+        else if (word == "compress")
+            settings.compress = true;
+        else if (word == "rgba8")
+            settings.compress = false;
+        else
+            throw std::runtime_error(fmt::format("unknown keyword '{}' in {}", word, sidecar.string()));
+    }
+    return settings;
+}
+
+
+std::optional<AssetType> asset_type(const std::filesystem::path& path)
+{
+    auto ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    if (ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".tga" || ext == ".bmp")
+        return AssetType::Texture;
+    if (ext == ".obj" || ext == ".fbx" || ext == ".gltf" || ext == ".glb" || ext == ".dae")
+        return AssetType::Model;
+    return std::nullopt;
+}
+
+
+// manifest 的格式：每一行是 "<hash> <relative path>"
+std::map<std::string, uint64_t> load_manifest(const std::filesystem::path& path)
+{
+    std::map<std::string, uint64_t> manifest;
+    std::ifstream                   file(path);
+    std::string                     line;
+    while (std::getline(file, line))
+    {
+        std::istringstream stream(line);
+        uint64_t           hash;
+        std::string        relative;
+        if (stream >> std::hex >> hash && std::getline(stream >> std::ws, relative))
+            manifest[relative] = hash;
+    }
+    return manifest;
+}
+
+
+void save_manifest(const std::filesystem::path& path, const std::map<std::string, uint64_t>& manifest)
+{
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream file(path, std::ios::trunc);
+    for (auto& [relative, hash]: manifest)
+        file << std::hex << hash << " " << relative << "\n";
+}
+
+
+void cook_texture(const Job& job, const Options& options)
+{
+    Hiss::Stbi_8Bit_RAII image(job.source.string(), STBI_rgb_alpha);
+    auto                 width  = (uint32_t) image.width();
+    auto                 height = (uint32_t) image.height();
+    auto                 chain  = Hiss::Mipmap::generate_rgba8(image.data, width, height, job.texture.color
+                                                                                                  && !options.linear);
+
+
+    // 有透明像素的纹理使用 BC3，否则使用 BC1；数据纹理保持 RGBA8，避免压缩破坏法线等数据
+    vk::Format format = vk::Format::eR8G8B8A8Unorm;
+    if (job.texture.compress && !options.rgba8)
+        format = Hiss::BlockCompress::has_alpha(image.data, (size_t) width * height) ? vk::Format::eBc3UnormBlock
+                                                                                       : vk::Format::eBc1RgbUnormBlock;
+
+    std::vector<std::vector<uint8_t>> levels;
+    for (auto& level: chain.levels)
+    {
+        const uint8_t* data = chain.data.data() + level.offset;
+        switch (format)
+        {
+            case vk::Format::eBc1RgbUnormBlock:
+                levels.push_back(Hiss::BlockCompress::encode_bc1(data, level.width, level.height));
+                break;
+            case vk::Format::eBc3UnormBlock:
+                levels.push_back(Hiss::BlockCompress::encode_bc3(data, level.width, level.height));
+                break;
+            default: levels.emplace_back(data, data + (size_t) level.width * level.height * 4); break;
+        }
+    }
+
+    // 编码使用 UNORM 的数据，颜色纹理在 KTX 中记录为对应的 sRGB 格式
+    Hiss::KtxFile::write_ktx2(Hiss::Cook::cooked_path(job.source, Hiss::Cook::TEXTURE_EXT),
+                              job.texture.color ? Hiss::KtxFile::to_srgb(format) : format, {width, height}, levels);
+}
+
+
+/**
+ * cook 模型，或者在模型没有变化时读取已有的产物，记录材质引用的纹理
+ * @details 已有的产物无法读取时，重新 cook
+ */
+void cook_model(Job& job, Hiss::JobSystem* job_system)
+{
+    auto                           cooked_path = Hiss::Cook::cooked_path(job.source, Hiss::Cook::MODEL_EXT);
+    std::optional<Hiss::ModelDesc> desc;
+    if (!job.dirty)
+    {
+        try
+        {
+            desc.emplace(Hiss::ModelDesc::load(cooked_path));
+        }
+        catch (const std::exception& e)
+        {
+            spdlog::warn("[cook] {}: invalid cooked model, cook again: {}", job.relative, e.what());
+            job.dirty = true;
+        }
+    }
+    if (job.dirty)
+    {
+        desc.emplace(Hiss::ModelDesc::import(job.source, true, job_system));
+        desc->save(cooked_path);
+    }
+
+    // 纹理的路径相对于模型所在的文件夹，与 MeshLoader 一致
+    auto dir = job.source.parent_path();
+    for (auto& mat: desc->materials)
+        for (auto* tex: {&mat.tex_diffuse, &mat.tex_ambient, &mat.tex_specular, &mat.tex_emissive})
+            if (!tex->empty())
+                job.textures.push_back(canonical_key(dir / *tex));
+}
+
+
+Options parse_options(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--force")
+            options.force = true;
+        else if (arg == "--rgba8")
+            options.rgba8 = true;
+        else if (arg == "--linear")
+            options.linear = true;
+        else if (arg == "--jobs" && i + 1 < argc)
+            options.jobs = (uint32_t) std::stoul(argv[++i]);
+        else
+            throw std::runtime_error("unknown argument: " + arg);
+    }
+    if (options.jobs == 0)
+        options.jobs = std::max(1u, std::thread::hardware_concurrency());
+    return options;
+}
+
+}    // namespace
+
+
+int main(int argc, char** argv)
+{
+    spdlog::set_level(default_log_config.level);
+    spdlog::set_pattern(default_log_config.pattern);
+
+    Options options;
+    try
+    {
+        options = parse_options(argc, argv);
+    }
+    catch (const std::exception& e)
+    {
+        spdlog::error("[cook] {}", e.what());
+        spdlog::info("usage: hiss_cook [--force] [--rgba8] [--linear] [--jobs N]");
+        return 1;
+    }
+
+    auto start         = std::chrono::steady_clock::now();
+    auto manifest_path = cooked / "manifest.txt";
+    auto manifest      = options.force ? std::map<std::string, uint64_t>{} : load_manifest(manifest_path);
+
+
+    // 遍历 assets，找出所有的纹理和模型
+    std::vector<Job> assets_found;
+    for (auto iter = std::filesystem::recursive_directory_iterator(assets);
+         iter != std::filesystem::recursive_directory_iterator(); ++iter)
+    {
+        if (iter->is_directory() && iter->path().filename() == cooked.filename())
+        {
+            iter.disable_recursion_pending();
+            continue;
+        }
+
+        auto type = asset_type(iter->path());
+        if (!iter->is_regular_file() || !type)
+            continue;
+
+        assets_found.push_back(Job{
+                .source   = iter->path(),
+                .relative = iter->path().lexically_relative(assets).generic_string(),
+                .type     = *type,
+        });
+    }
+
+
+    // --jobs 1 时所有的工作都在主线程上依次进行；模型内部的 mesh 也会并行处理
+    uint32_t        worker_num = std::max(1u, options.jobs);
+    Hiss::JobSystem job_system{Hiss::JobSystem::Config{.worker_num = std::max(1u, worker_num - 1)}};
+    auto*           nested   = worker_num > 1 ? &job_system : nullptr;
+    auto            for_each = [&](AssetType type, const std::function<void(Job&)>& func) {
+        std::vector<Job*> list;
+        for (auto& job: assets_found)
+            if (job.type == type)
+                list.push_back(&job);
+        job_system.parallel_for(0, list.size(), worker_num > 1 ? 1 : std::max<size_t>(1, list.size()),
+                                [&](size_t begin, size_t end) {
+                                    for (size_t i = begin; i < end; ++i)
+                                        func(*list[i]);
+                                });
+    };
+    auto cook_job = [&](Job& job, void (*cook)(Job&, const Options&, Hiss::JobSystem*)) {
+        try
+        {
+            cook(job, options, nested);
+            job.ok = true;
+            if (job.dirty)
+                spdlog::info("[cook] {}", job.relative);
+        }
+        catch (const std::exception& e)
+        {
+            spdlog::error("[cook] {}: {}", job.relative, e.what());
+        }
+    };
+
+    // 内容以及设置都没有变化，并且产物仍然存在时不需要重新 cook
+    auto check_dirty = [&](Job& job) {
+        auto ext  = job.type == AssetType::Texture ? Hiss::Cook::TEXTURE_EXT : Hiss::Cook::MODEL_EXT;
+        auto old  = manifest.find(job.relative);
+        job.dirty = old == manifest.end() || old->second != job.hash
+                 || !std::filesystem::exists(Hiss::Cook::cooked_path(job.source, ext));
+    };
+
+
+    // 先处理模型：没有变化的模型也会读取已有的产物，用于确定哪些纹理是颜色纹理
+    for_each(AssetType::Model, [&](Job& job) {
+        job.hash = Hiss::Cook::hash_file(job.source);
+        check_dirty(job);
+        cook_job(job, [](Job& job, const Options&, Hiss::JobSystem* nested) { cook_model(job, nested); });
+    });
+
+    std::set<std::string> color_textures;
+    for (auto& job: assets_found)
+        color_textures.insert(job.textures.begin(), job.textures.end());
+
+
+    // 再处理纹理：设置混入 hash，改变纹理的类别或者 sidecar 之后会重新 cook
+    for_each(AssetType::Texture, [&](Job& job) {
+        try
+        {
+            bool color  = color_textures.count(canonical_key(job.source)) > 0;
+            job.texture = apply_sidecar(job.source, TextureSettings{.color = color, .compress = color});
+        }
+        catch (const std::exception& e)
+        {
+            spdlog::error("[cook] {}: {}", job.relative, e.what());
+            return;
+        }
+        job.hash = Hiss::Cook::hash_file(job.source) ^ (job.texture.salt() * 0x9E3779B97F4A7C15ull);
+        check_dirty(job);
+        cook_job(job, [](Job& job, const Options& options, Hiss::JobSystem*) {
+            if (job.dirty)
+                cook_texture(job, options);
+        });
+    });
+    job_system.log_stats();
+
+
+    // 只记录成功的文件，失败的文件下次会重新 cook
+    std::map<std::string, uint64_t> new_manifest;
+    uint32_t                        cook_num = 0;
+    uint32_t                        skip_num = 0;
+    uint32_t                        fail_num = 0;
+    for (auto& job: assets_found)
+    {
+        if (!job.ok)
+        {
+            fail_num++;
+            continue;
+        }
+        new_manifest[job.relative] = job.hash;
+        if (job.dirty)
+        {
+            cook_num++;
+            continue;
+        }
+
+        // 运行时通过修改时间判断产物是否有效，源文件只是被 touch 时，更新产物的修改时间
+        auto ext         = job.type == AssetType::Texture ? Hiss::Cook::TEXTURE_EXT : Hiss::Cook::MODEL_EXT;
+        auto cooked_path = Hiss::Cook::cooked_path(job.source, ext);
+        if (std::filesystem::last_write_time(cooked_path) < std::filesystem::last_write_time(job.source))
+            std::filesystem::last_write_time(cooked_path, std::filesystem::file_time_type::clock::now());
+        skip_num++;
+    }
+    save_manifest(manifest_path, new_manifest);
+
+    auto duration =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    spdlog::info("[cook] cooked: {}, skipped: {}, failed: {}, threads: {}, {:.1f} ms", cook_num, skip_num, fail_num,
+                 worker_num, duration);
+    return fail_num == 0 ? 0 : 1;
+}